@@ -0,0 +1,103 @@
+#ifndef _C_ALLOCATOR_H
+#define _C_ALLOCATOR_H
+
+/*
+ * A C_ALLOCATOR supplies the memory used by the collections. By default all
+ * memory comes from malloc, realloc and free; a user-supplied C_ALLOCATOR can
+ * direct it elsewhere (an arena, a pool, a jemalloc arena, or a wrapper that
+ * counts or caps the memory used by a subsystem).
+ *
+ * Each thread has a current C_ALLOCATOR, set with c_allocator_set. Every
+ * collection records the current allocator when it is created and uses that
+ * allocator for all of its memory for the rest of its life, regardless of
+ * later calls to c_allocator_set. To create a collection with a specific
+ * allocator, set it, create the collection, and restore the previous one:
+
+    C_ALLOCATOR *previous = c_allocator_set (&arena_allocator);
+    C_MAP *map = c_map_dict_create (NULL);
+    c_allocator_set (previous);
+
+ * A C_ALLOCATOR must remain valid for as long as any collection created with
+ * it exists.
+ */
+
+#include <sys/types.h>
+
+/*
+ * Typedef   : C_ALLOCATOR
+ * Purpose   : a set of memory management callbacks
+ * Notes     :
+ *
+ * 1. The callbacks follow the rules of malloc, realloc and free, and are
+ *    passed the context as their last argument.
+ */
+typedef struct C_ALLOCATOR {
+  void *(*alloc) (size_t, void *context);
+  void *(*realloc) (void *, size_t, void *context);
+  void (*free) (void *, void *context);
+  void *context;
+} C_ALLOCATOR;
+
+/*
+ * Function  : c_allocator_default
+ * Purpose   : returns the allocator built on malloc, realloc and free
+ * Parameters: none
+ * Return    : pointer to C_ALLOCATOR
+ */
+C_ALLOCATOR *c_allocator_default (void);
+
+/*
+ * Function  : c_allocator_get
+ * Purpose   : returns the calling thread's current allocator
+ * Parameters: none
+ * Return    : pointer to C_ALLOCATOR
+ */
+C_ALLOCATOR *c_allocator_get (void);
+
+/*
+ * Function  : c_allocator_set
+ * Purpose   : sets the calling thread's current allocator
+ * Parameters: pointer to C_ALLOCATOR, or NULL for c_allocator_default
+ * Return    : the previous current allocator
+ */
+C_ALLOCATOR *c_allocator_set (C_ALLOCATOR *);
+
+/*
+ * Function  : c_allocator_alloc
+ * Purpose   : allocates memory from an allocator
+ * Parameters: pointer to C_ALLOCATOR
+ *             size
+ * Return    : pointer to memory, or NULL if out of memory
+ */
+void *c_allocator_alloc (C_ALLOCATOR *, size_t);
+
+/*
+ * Function  : c_allocator_calloc
+ * Purpose   : allocates zero-filled memory from an allocator
+ * Parameters: pointer to C_ALLOCATOR
+ *             number of elements
+ *             size of each element
+ * Return    : pointer to memory, or NULL if out of memory
+ */
+void *c_allocator_calloc (C_ALLOCATOR *, size_t, size_t);
+
+/*
+ * Function  : c_allocator_realloc
+ * Purpose   : resizes memory from an allocator
+ * Parameters: pointer to C_ALLOCATOR
+ *             pointer to memory (can be NULL)
+ *             new size
+ * Return    : pointer to memory, or NULL if out of memory
+ */
+void *c_allocator_realloc (C_ALLOCATOR *, void *, size_t);
+
+/*
+ * Function  : c_allocator_free
+ * Purpose   : returns memory to an allocator
+ * Parameters: pointer to C_ALLOCATOR
+ *             pointer to memory (can be NULL)
+ * Return    : none
+ */
+void c_allocator_free (C_ALLOCATOR *, void *);
+
+#endif
@@ -16,15 +16,29 @@
  * specified size.
  *
  * The c_array_append function adds data to the end of the array, allocating
- * memory when necessary. The array contents (c_array_get) and length
- * (c_array_length) can be inspected at any time, although these values will
- * not be preserved over the life of the array. The c_array_clear function
- * resets the length of the array to zero, but does not release any resources.
+ * memory when necessary; c_array_append_n adds several elements at once, and
+ * c_array_insert_at adds them anywhere in the array. The c_array_erase_range
+ * function removes a run of elements, and c_array_remove_if removes every
+ * element a predicate picks in a single pass, which is much cheaper than
+ * removing them one at a time with the iterator. The array contents
+ * (c_array_get) and length (c_array_length) can be inspected at any time,
+ * although these values will not be preserved over the life of the array.
+ * The c_array_clear function resets the length of the array to zero, but
+ * does not release any resources.
  *
  * The c_array_get function performs a memory-safe retrieval of an element in
  * the array by index. The c_array_set function performs a memory-safe
  * assignment of an element in the array by index.
  *
+ * The c_array_sort, c_array_stable_sort, c_array_partial_sort and
+ * c_array_nth_element functions order the elements with a comparator, and
+ * c_array_bsearch, c_array_lower_bound and c_array_upper_bound search a
+ * sorted array, for instance for all the elements in a range. When the
+ * elements are ordered by a single integer or floating point field, the
+ * c_array_sort_key, c_array_lower_bound_key and c_array_upper_bound_key
+ * functions do the same without a comparator; c_array_sort_key uses a radix
+ * sort, which is much faster than comparison sorting on large arrays.
+ *
  * The c_array_free function frees the C_ARRAY and all internal resources.
  *
 
@@ -49,6 +63,35 @@ data length; in this case you will have to manage your own bounds checking.
 
 typedef struct C_ARRAY C_ARRAY;
 
+/*
+ * Typedef   : C_ARRAY_PREDICATE
+ * Purpose   : user callback that picks elements, for c_array_remove_if
+ * Parameters: pointer to element
+ *             context supplied in c_array_remove_if
+ * Return    : nonzero to pick the element
+ */
+typedef int (*C_ARRAY_PREDICATE) (void *element, void *context);
+
+/*
+ * Typedef   : C_ARRAY_COMPARATOR
+ * Purpose   : user callback that compares two elements (as for qsort)
+ * Parameters: pointer to first element
+ *             pointer to second element
+ * Return    : less than, equal to or greater than zero as the first
+ *             element sorts before, with or after the second
+ */
+typedef int (*C_ARRAY_COMPARATOR) (const void *element1, const void *element2);
+
+/*
+ * types of key field for c_array_sort_key and the _key searches
+ */
+#define C_ARRAY_KEY_INT32  1 // int
+#define C_ARRAY_KEY_UINT32 2 // unsigned int
+#define C_ARRAY_KEY_INT64  3 // long long
+#define C_ARRAY_KEY_UINT64 4 // unsigned long long
+#define C_ARRAY_KEY_FLOAT  5 // float
+#define C_ARRAY_KEY_DOUBLE 6 // double
+
 /*
  * Function  : c_array_create_base
  * Purpose   : creates a new array
@@ -98,6 +141,75 @@ int c_array_require (C_ARRAY *, int);
  */
 int c_array_append (C_ARRAY *, void *);
 
+/*
+ * Function  : c_array_append_n
+ * Purpose   : appends several elements to the array
+ * Parameters: pointer to C_ARRAY
+ *             pointer to the first element
+ *             number of elements
+ * Return    : zero on success
+ * Notes     :
+ *
+ * 1. The elements are copied with a single memcpy, and the array grows at
+ *    most once.
+ *
+ * 2. The elements must not be in the array itself, since it may move as it
+ *    grows.
+ */
+int c_array_append_n (C_ARRAY *, void *, int);
+
+/*
+ * Function  : c_array_insert_at
+ * Purpose   : inserts several elements into the array
+ * Parameters: pointer to C_ARRAY
+ *             index of the first inserted element
+ *             pointer to the first element
+ *             number of elements
+ * Return    : zero on success; nonzero if out of memory or the index is
+ *             out-of-bounds
+ * Notes     :
+ *
+ * 1. The elements from index on move up to make room. An index equal to
+ *    the length of the array appends.
+ *
+ * 2. A negative index starts from the right (-1 inserts before the last
+ *    element).
+ *
+ * 3. (see c_array_append_n Note 2)
+ */
+int c_array_insert_at (C_ARRAY *, int, void *, int);
+
+/*
+ * Function  : c_array_erase_range
+ * Purpose   : removes a run of elements from the array
+ * Parameters: pointer to C_ARRAY
+ *             index of the first element to remove
+ *             number of elements
+ * Return    : zero on success; nonzero if the run is out-of-bounds
+ * Notes     :
+ *
+ * 1. A negative index starts from the right (-1 == length - 1).
+ *
+ * 2. The elements after the run move down with a single memmove.
+ */
+int c_array_erase_range (C_ARRAY *, int, int);
+
+/*
+ * Function  : c_array_remove_if
+ * Purpose   : removes the elements a predicate picks
+ * Parameters: pointer to C_ARRAY
+ *             predicate callback
+ *             context passed to the predicate
+ * Return    : the number of elements removed
+ * Notes     :
+ *
+ * 1. The predicate is called once for each element, in order, and the
+ *    elements left keep their order. The array is compacted in one pass, so
+ *    this takes time in proportion to the length of the array however many
+ *    elements are removed.
+ */
+int c_array_remove_if (C_ARRAY *, C_ARRAY_PREDICATE, void *);
+
 /*
  * Function  : c_array_clear
  * Purpose   : resets a C_ARRAY to have a zero length
@@ -159,6 +271,162 @@ void *c_array_set (C_ARRAY *, int, void *);
  */
 int c_array_length (C_ARRAY *);
 
+/*
+ * Function  : c_array_sort
+ * Purpose   : sorts the elements in the array
+ * Parameters: pointer to C_ARRAY
+ *             comparator callback
+ * Return    : none
+ * Notes     :
+ *
+ * 1. The sort is not stable; see c_array_stable_sort.
+ */
+void c_array_sort (C_ARRAY *, C_ARRAY_COMPARATOR);
+
+/*
+ * Function  : c_array_stable_sort
+ * Purpose   : sorts the elements in the array, keeping the order of equal
+ *             elements
+ * Parameters: pointer to C_ARRAY
+ *             comparator callback
+ * Return    : zero on success; nonzero if out of memory
+ * Notes     :
+ *
+ * 1. This is a merge sort, which needs a second array as big as this one.
+ */
+int c_array_stable_sort (C_ARRAY *, C_ARRAY_COMPARATOR);
+
+/*
+ * Function  : c_array_nth_element
+ * Purpose   : puts the element that sorts to a given index in its place
+ * Parameters: pointer to C_ARRAY
+ *             index
+ *             comparator callback
+ * Return    : zero on success; nonzero if out of memory or the index is
+ *             out-of-bounds
+ * Notes     :
+ *
+ * 1. On return the element at the index is the one that would be there if
+ *    the array were sorted; the elements before it do not sort after it,
+ *    and those after it do not sort before it, but they are not otherwise
+ *    in order.
+ *
+ * 2. This takes time in proportion to the length of the array, on
+ *    average.
+ */
+int c_array_nth_element (C_ARRAY *, int, C_ARRAY_COMPARATOR);
+
+/*
+ * Function  : c_array_partial_sort
+ * Purpose   : sorts the smallest elements to the start of the array
+ * Parameters: pointer to C_ARRAY
+ *             number of elements to sort
+ *             comparator callback
+ * Return    : zero on success; nonzero if out of memory
+ * Notes     :
+ *
+ * 1. The rest of the elements follow, in no particular order.
+ */
+int c_array_partial_sort (C_ARRAY *, int, C_ARRAY_COMPARATOR);
+
+/*
+ * Function  : c_array_bsearch
+ * Purpose   : finds an element in a sorted array
+ * Parameters: pointer to C_ARRAY
+ *             pointer to key, an element to compare the array elements
+ *             with
+ *             comparator callback
+ * Return    : index of an element equal to the key, or -1 if not found
+ * Notes     :
+ *
+ * 1. The array must be sorted by the same comparator. If several elements
+ *    are equal to the key, any of them may be found; c_array_lower_bound
+ *    finds the first.
+ */
+int c_array_bsearch (C_ARRAY *, void *, C_ARRAY_COMPARATOR);
+
+/*
+ * Function  : c_array_lower_bound
+ * Purpose   : finds the first element in a sorted array that does not sort
+ *             before a key
+ * Parameters: pointer to C_ARRAY
+ *             pointer to key (see c_array_bsearch)
+ *             comparator callback
+ * Return    : index of the element, or the length of the array if every
+ *             element sorts before the key
+ * Notes     :
+ *
+ * 1. The elements from c_array_lower_bound (key1) up to, but not
+ *    including, c_array_upper_bound (key2) are those from key1 to key2
+ *    inclusive.
+ */
+int c_array_lower_bound (C_ARRAY *, void *, C_ARRAY_COMPARATOR);
+
+/*
+ * Function  : c_array_upper_bound
+ * Purpose   : finds the first element in a sorted array that sorts after a
+ *             key
+ * Parameters: pointer to C_ARRAY
+ *             pointer to key (see c_array_bsearch)
+ *             comparator callback
+ * Return    : index of the element, or the length of the array if no
+ *             element sorts after the key
+ */
+int c_array_upper_bound (C_ARRAY *, void *, C_ARRAY_COMPARATOR);
+
+/*
+ * Function  : c_array_sort_key
+ * Purpose   : sorts the elements in the array by a numeric key field
+ * Parameters: pointer to C_ARRAY
+ *             key type (C_ARRAY_KEY_INT32 etc)
+ *             offset of the key field in the element
+ * Return    : zero on success; nonzero if out of memory, or the type is not
+ *             known or the field does not fit in an element
+ * Notes     :
+ *
+ * 1. The sort is stable, and uses no comparator: large arrays are sorted
+ *    with a radix sort, one pass per byte of the key, skipping the bytes
+ *    every key has in common.
+ *
+ * 2. Floating point keys sort by value, with -0.0 before 0.0. NaNs sort
+ *    before every other key if their sign bit is set, and after every other
+ *    key if not.
+ *
+ * 3. The field need not be aligned.
+ */
+int c_array_sort_key (C_ARRAY *, int, size_t);
+
+/*
+ * Function  : c_array_lower_bound_key
+ * Purpose   : finds the first element in an array sorted by a key field
+ *             whose key is not less than a value
+ * Parameters: pointer to C_ARRAY
+ *             key type (C_ARRAY_KEY_INT32 etc)
+ *             offset of the key field in the element
+ *             pointer to the value, of the key type
+ * Return    : index of the element, or the length of the array if every
+ *             key is less than the value; -1 if the type is not known or
+ *             the field does not fit in an element
+ * Notes     :
+ *
+ * 1. See c_array_lower_bound Note 1 and c_array_sort_key Note 2.
+ */
+int c_array_lower_bound_key (C_ARRAY *, int, size_t, void *);
+
+/*
+ * Function  : c_array_upper_bound_key
+ * Purpose   : finds the first element in an array sorted by a key field
+ *             whose key is greater than a value
+ * Parameters: pointer to C_ARRAY
+ *             key type (C_ARRAY_KEY_INT32 etc)
+ *             offset of the key field in the element
+ *             pointer to the value, of the key type
+ * Return    : index of the element, or the length of the array if no key
+ *             is greater than the value; -1 if the type is not known or
+ *             the field does not fit in an element
+ */
+int c_array_upper_bound_key (C_ARRAY *, int, size_t, void *);
+
 /*
  * Function  : c_array_iterator
  * Purpose   : initializes the C_ARRAY iterator
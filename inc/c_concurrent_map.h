@@ -0,0 +1,188 @@
+#ifndef _C_CONCURRENT_MAP_H
+#define _C_CONCURRENT_MAP_H
+
+/*
+ * A C_CONCURRENT_MAP implements a C_MAP that can be shared by any number of
+ * threads. The keys are spread over a fixed number of shards, each of which
+ * is a hash table protected by its own reader/writer lock, so threads
+ * working on keys in different shards do not contend with each other, and
+ * lookups (c_concurrent_map_find, c_concurrent_map_exists) of keys in the
+ * same shard run side by side.
+ *
+ * To create a new C_CONCURRENT_MAP, use the c_concurrent_map_create function,
+ * supplying the same hash, comparison and cleanup (garbage) callbacks as for
+ * c_map_create, and the number of shards. To add a key/value pair, use
+ * c_concurrent_map_insert (which fails if the key is present) or
+ * c_concurrent_map_add (which replaces the value of a present key). Use
+ * c_concurrent_map_find and c_concurrent_map_remove to locate and remove an
+ * entry.
+ *
+ * A C_CONCURRENT_MAP has no iterator, since an iterator can't hold the shard
+ * locks between calls; use c_concurrent_map_foreach instead.
+ *
+ * Each call hashes its key once. The shard is picked from the high bits of
+ * the key's hash, and the table in the shard uses the low bits, so the
+ * C_MAP_CALCULATOR should spread its values over all 32 bits (the hash_func
+ * calculators do).
+ */
+
+#include "c_map.h"
+
+#define C_CONCURRENT_MAP_ERROR_MEMORY -1
+#define C_CONCURRENT_MAP_ERROR_DUPLICATE -2
+
+typedef struct C_CONCURRENT_MAP C_CONCURRENT_MAP;
+
+/*
+ * Typedef   : C_CONCURRENT_MAP_VISITOR
+ * Purpose   : user callback called for each entry by c_concurrent_map_foreach
+ * Parameters: pointer to key
+ *             pointer to value
+ *             context (supplied to c_concurrent_map_foreach)
+ * Return    : 0 to continue, non-zero to stop
+ */
+typedef int (*C_CONCURRENT_MAP_VISITOR) (void *key, void *value,
+  void *context);
+
+/*
+ * Function  : c_concurrent_map_create
+ * Purpose   : creates a new c_concurrent_map
+ * Parameters: key hash calculator callback
+ *             key comparison callback
+ *             garbage collector (see c_map_create Note 1)
+ *             number of shards, or zero for the default (Note 1)
+ * Return    : C_CONCURRENT_MAP or NULL if out of memory
+ * Notes     :
+ *
+ * 1. The number of shards is rounded up to a power of two. A few shards per
+ *    thread that uses the map keeps the chance of two threads wanting the
+ *    same lock low.
+ *
+ * 2. The garbage collector is called with the shard's lock held, so it must
+ *    not call back into the C_CONCURRENT_MAP.
+ */
+C_CONCURRENT_MAP *c_concurrent_map_create (C_MAP_CALCULATOR, C_MAP_COMPARATOR,
+  C_MAP_GARBAGE, int shards);
+
+/*
+ * Function  : c_concurrent_map_dict_create
+ * Purpose   : creates a new c_concurrent_map with a null-terminated string key
+ * Parameters: garbage collector (see c_map_create Note 1)
+ *             number of shards, or zero for the default
+ * Return    : C_CONCURRENT_MAP or NULL if out of memory
+ */
+C_CONCURRENT_MAP *c_concurrent_map_dict_create (C_MAP_GARBAGE, int shards);
+
+/*
+ * Function  : c_concurrent_map_free
+ * Purpose   : frees a C_CONCURRENT_MAP and every key-value pair in it
+ * Parameters: pointer to C_CONCURRENT_MAP
+ * Return    : none
+ * Notes     :
+ *
+ * 1. No other thread may be using the C_CONCURRENT_MAP.
+ */
+void c_concurrent_map_free (C_CONCURRENT_MAP *);
+
+/*
+ * Function  : c_concurrent_map_clear
+ * Purpose   : removes every key-value pair
+ * Parameters: pointer to C_CONCURRENT_MAP
+ * Return    : none
+ * Notes     :
+ *
+ * 1. The shards are cleared one at a time; entries added to a shard that
+ *    has already been cleared survive the call.
+ */
+void c_concurrent_map_clear (C_CONCURRENT_MAP *);
+
+/*
+ * Function  : c_concurrent_map_insert
+ * Purpose   : adds a key-value pair if the key is not already present
+ * Parameters: pointer to C_CONCURRENT_MAP
+ *             pointer to key
+ *             pointer to value
+ * Return    : 0 on success
+ *             C_CONCURRENT_MAP_ERROR_DUPLICATE if the key is present
+ *             C_CONCURRENT_MAP_ERROR_MEMORY
+ */
+int c_concurrent_map_insert (C_CONCURRENT_MAP *, void *key, void *value);
+
+/*
+ * Function  : c_concurrent_map_add
+ * Purpose   : adds a key-value pair, replacing the value of a present key
+ * Parameters: pointer to C_CONCURRENT_MAP
+ *             pointer to key
+ *             pointer to value
+ * Return    : 0 on success
+ *             C_CONCURRENT_MAP_ERROR_MEMORY
+ * Notes     : see c_map_create Note 2
+ */
+int c_concurrent_map_add (C_CONCURRENT_MAP *, void *key, void *value);
+
+/*
+ * Function  : c_concurrent_map_find
+ * Purpose   : finds the value associated with a key
+ * Parameters: pointer to C_CONCURRENT_MAP
+ *             pointer to key
+ * Return    : pointer to value, or NULL if not found (see c_map_find Note 1)
+ * Notes     :
+ *
+ * 1. The value is returned after the shard's lock is released, so another
+ *    thread may remove (and garbage collect) it at any time. Values that can
+ *    be removed while in use must be protected by the caller, for instance
+ *    with a reference count.
+ */
+void *c_concurrent_map_find (C_CONCURRENT_MAP *, void *key);
+
+/*
+ * Function  : c_concurrent_map_exists
+ * Purpose   : indicates if a key exists in the c_concurrent_map
+ * Parameters: pointer to C_CONCURRENT_MAP
+ *             pointer to key
+ * Return    : non-zero if the key is found
+ */
+int c_concurrent_map_exists (C_CONCURRENT_MAP *, void *key);
+
+/*
+ * Function  : c_concurrent_map_remove
+ * Purpose   : removes a key-value pair
+ * Parameters: pointer to C_CONCURRENT_MAP
+ *             pointer to key
+ * Return    : none
+ */
+void c_concurrent_map_remove (C_CONCURRENT_MAP *, void *key);
+
+/*
+ * Function  : c_concurrent_map_foreach
+ * Purpose   : calls a C_CONCURRENT_MAP_VISITOR for each key-value pair
+ * Parameters: pointer to C_CONCURRENT_MAP
+ *             C_CONCURRENT_MAP_VISITOR
+ *             context (supplied to the visitor; can be NULL)
+ * Return    : the non-zero value that stopped the visit, or 0
+ * Notes     :
+ *
+ * 1. Each shard is read-locked while it is visited, so finds and other
+ *    visits can run alongside; the visitor must not call back into the
+ *    C_CONCURRENT_MAP.
+ */
+int c_concurrent_map_foreach (C_CONCURRENT_MAP *, C_CONCURRENT_MAP_VISITOR,
+  void *context);
+
+/*
+ * Function  : c_concurrent_map_size
+ * Purpose   : returns the number of key-value pairs
+ * Parameters: pointer to C_CONCURRENT_MAP
+ * Return    : the number of key-value pairs
+ */
+int c_concurrent_map_size (C_CONCURRENT_MAP *);
+
+/*
+ * Function  : c_concurrent_map_shards
+ * Purpose   : returns the number of shards
+ * Parameters: pointer to C_CONCURRENT_MAP
+ * Return    : the number of shards
+ */
+int c_concurrent_map_shards (C_CONCURRENT_MAP *);
+
+#endif
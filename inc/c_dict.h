@@ -16,12 +16,20 @@
  * times (with iterator_reset or by re-calling c_dict_iterator) without using
  * additional resources. The c_dict_free function will release any resources
  * associated with the iterator.
+ *
+ * Keys are interned, and each key's value is kept with its symbol (see
+ * c_symbol_value), so c_dict_find is a single probe of the symbol table; the
+ * key-value map, used for iteration and removal, works on the hash stored
+ * with each key and compares keys by pointer. A caller that looks up the
+ * same key repeatedly can fetch the interned key once with c_dict_key and
+ * then use c_dict_find_symbol, which does no hashing or probing at all.
  */
 
 #include "c_map.h"
 #include "c_iterator.h"
 
 typedef struct C_DICT C_DICT;
+typedef struct C_FROZEN_DICT C_FROZEN_DICT;
 
 /*
  * Typedef   : C_DICTITEM
@@ -37,6 +45,31 @@ typedef C_MAPITEM C_DICTITEM;
  */
 C_DICT *c_dict_create (void);
 
+/*
+ * Function  : c_dict_create_size
+ * Purpose   : creates a new c_dict sized for an expected number of entries
+ * Parameters: expected number of key-value pairs
+ * Return    : C_DICT or NULL if out of memory
+ * Notes     :
+ *
+ * 1. Room is made for twice as many strings as key-value pairs, since each
+ *    pair can add two distinct strings.
+ */
+C_DICT *c_dict_create_size (int expected);
+
+/*
+ * Function  : c_dict_create_keyed
+ * Purpose   : creates a new c_dict for keys and values from untrusted
+ *             sources
+ * Parameters: expected number of key-value pairs (or zero)
+ * Return    : C_DICT or NULL if out of memory
+ * Notes     :
+ *
+ * 1. Keys and values are hashed with SipHash under a secret chosen for this
+ *    c_dict alone; see c_symbol_create_keyed.
+ */
+C_DICT *c_dict_create_keyed (int expected);
+
 /*
  * Function  : c_dict_free
  * Purpose   : frees a C_DICT and all internal resources
@@ -63,6 +96,22 @@ void c_dict_clear (C_DICT *);
  */
 int c_dict_add (C_DICT *, char *key, char *value);
 
+/*
+ * Function  : c_dict_add_n
+ * Purpose   : adds a key-value pair of counted strings to a c_dict
+ * Parameters: pointer to C_DICT
+ *             pointer to key string (need not be null-terminated)
+ *             length of key (cannot be 0)
+ *             pointer to value string (need not be null-terminated)
+ *             length of value (cannot be 0)
+ * Return    : 0 on success; otherwise, out of memory or 0 length key/value
+ * Notes     :
+ *
+ * 1. The strings are copied into the c_dict, and are null-terminated there.
+ */
+int c_dict_add_n (C_DICT *, const char *key, size_t key_length,
+  const char *value, size_t value_length);
+
 /*
  * Function  : c_dict_find
  * Purpose   : finds the value associated with a key
@@ -72,6 +121,39 @@ int c_dict_add (C_DICT *, char *key, char *value);
  */
 char *c_dict_find (C_DICT *, char *key);
 
+/*
+ * Function  : c_dict_find_n
+ * Purpose   : finds the value associated with a counted key string
+ * Parameters: pointer to C_DICT
+ *             pointer to key (need not be null-terminated)
+ *             length of key
+ * Return    : pointer to value, or NULL if not found
+ */
+char *c_dict_find_n (C_DICT *, const char *key, size_t length);
+
+/*
+ * Function  : c_dict_key
+ * Purpose   : finds the interned copy of a key
+ * Parameters: pointer to C_DICT
+ *             pointer to key (need not be null-terminated)
+ *             length of key
+ * Return    : pointer to the interned key, or NULL if the key was never added
+ * Notes     :
+ *
+ * 1. The interned key stays valid until c_dict_clear or c_dict_free, even if
+ *    its key-value pair is removed.
+ */
+const char *c_dict_key (C_DICT *, const char *key, size_t length);
+
+/*
+ * Function  : c_dict_find_symbol
+ * Purpose   : finds the value associated with an interned key
+ * Parameters: pointer to C_DICT
+ *             interned key, as returned by c_dict_key on the same C_DICT
+ * Return    : pointer to value, or NULL if not found
+ */
+char *c_dict_find_symbol (C_DICT *, const char *symbol);
+
 /*
  * Function  : c_dict_remove
  * Purpose   : removes a key-value pair
@@ -104,6 +186,24 @@ void c_dict_remove (C_DICT *, char *key);
  */
 C_ITERATOR *c_dict_iterator (C_DICT *);
 
+/*
+ * Function  : c_dict_reserve
+ * Purpose   : makes room for a number of key-value pairs without rehashing
+ * Parameters: pointer to C_DICT
+ *             number of key-value pairs
+ * Return    : 0 on success; otherwise, out of memory
+ * Notes     : see c_dict_create_size Note 1
+ */
+int c_dict_reserve (C_DICT *, int count);
+
+/*
+ * Function  : c_dict_shrink_to_fit
+ * Purpose   : shrinks the internal tables to suit the current contents
+ * Parameters: pointer to C_DICT
+ * Return    : 0 on success; otherwise, out of memory
+ */
+int c_dict_shrink_to_fit (C_DICT *);
+
 /*
  * Function  : c_dict_size
  * Purpose   : returns the number of key-value pairs in the c_dict
@@ -112,4 +212,135 @@ C_ITERATOR *c_dict_iterator (C_DICT *);
  */
 int c_dict_size (C_DICT *);
 
+
+/*
+ * Function  : c_dict_freeze
+ * Purpose   : turns a C_DICT into an immutable C_FROZEN_DICT
+ * Parameters: pointer to C_DICT
+ * Return    : C_FROZEN_DICT or NULL if out of memory
+ * Notes     :
+ *
+ * 1. On success the C_DICT is freed; on failure it is unchanged.
+ * 2. A C_FROZEN_DICT copies the keys and values into a single block and
+ *    indexes the pairs with a minimal perfect hash (see c_mph.h), so a
+ *    lookup examines a single entry. It is meant for dictionaries that are
+ *    built once and then only read, by any number of threads at once.
+ * 3. The keys of a C_FROZEN_DICT made from a c_dict_create_keyed C_DICT
+ *    are hashed with SipHash under a new secret key.
+ */
+C_FROZEN_DICT *c_dict_freeze (C_DICT *);
+
+/*
+ * Function  : c_frozen_dict_create
+ * Purpose   : creates a C_FROZEN_DICT from arrays of keys and values
+ * Parameters: array of keys
+ *             array of key lengths (or NULL if the keys are null-terminated)
+ *             array of values
+ *             array of value lengths (or NULL if the values are
+ *             null-terminated)
+ *             number of key-value pairs
+ *             nonzero to hash the keys with SipHash under a secret key
+ * Return    : C_FROZEN_DICT or NULL if out of memory
+ * Notes     :
+ *
+ * 1. The keys must be distinct; the keys and values are copied.
+ * 2. Where a value is the same pointer as its key, the copy of the key
+ *    serves as the value too.
+ */
+C_FROZEN_DICT *c_frozen_dict_create (const char **keys,
+  const size_t *key_lengths, const char **values, const size_t *value_lengths,
+  int count, int keyed);
+
+/*
+ * Function  : c_dict_save
+ * Purpose   : writes a C_DICT to a file that c_frozen_dict_load can map
+ * Parameters: pointer to C_DICT
+ *             path of the file
+ * Return    : 0 on success; otherwise, out of memory or an I/O error
+ * Notes     : see c_frozen_dict_save
+ */
+int c_dict_save (C_DICT *, const char *path);
+
+/*
+ * Function  : c_frozen_dict_save
+ * Purpose   : writes a C_FROZEN_DICT to a file that c_frozen_dict_load can
+ *             map
+ * Parameters: pointer to C_FROZEN_DICT
+ *             path of the file
+ * Return    : 0 on success; otherwise, out of memory or an I/O error
+ * Notes     :
+ *
+ * 1. The file holds the keys, values and minimal perfect hash, with offsets
+ *    in place of pointers. It is in the machine's own byte order, and is
+ *    refused by c_frozen_dict_load on a machine with another one.
+ * 2. An existing file is overwritten in place, which would disturb any
+ *    process that has it mapped; to replace a file in use, save to a new
+ *    path and rename it over the old one.
+ * 3. For a keyed C_FROZEN_DICT, the secret key is saved in the file.
+ */
+int c_frozen_dict_save (C_FROZEN_DICT *, const char *path);
+
+/*
+ * Function  : c_frozen_dict_load
+ * Purpose   : maps a file written by c_frozen_dict_save, c_dict_save or
+ *             c_symbol_save
+ * Parameters: path of the file
+ * Return    : C_FROZEN_DICT, or NULL if the file can't be mapped or is not
+ *             valid
+ * Notes     :
+ *
+ * 1. The file is mapped read-only and lookups read it in place, so loading
+ *    takes time in proportion to the number of pairs (to check the file)
+ *    rather than to its size, and processes that load the same file share
+ *    its pages.
+ * 2. The file must not be changed while it is loaded (see
+ *    c_frozen_dict_save Note 2).
+ */
+C_FROZEN_DICT *c_frozen_dict_load (const char *path);
+
+/*
+ * Function  : c_frozen_dict_free
+ * Purpose   : frees a C_FROZEN_DICT and all internal resources
+ * Parameters: pointer to C_FROZEN_DICT
+ * Return    : none
+ */
+void c_frozen_dict_free (C_FROZEN_DICT *);
+
+/*
+ * Function  : c_frozen_dict_find
+ * Purpose   : finds the value associated with a key
+ * Parameters: pointer to C_FROZEN_DICT
+ *             pointer to key
+ * Return    : pointer to value, or NULL if not found
+ */
+char *c_frozen_dict_find (C_FROZEN_DICT *, char *key);
+
+/*
+ * Function  : c_frozen_dict_find_n
+ * Purpose   : finds the value associated with a counted key string
+ * Parameters: pointer to C_FROZEN_DICT
+ *             pointer to key (need not be null-terminated)
+ *             length of key
+ * Return    : pointer to value, or NULL if not found
+ */
+char *c_frozen_dict_find_n (C_FROZEN_DICT *, const char *key, size_t length);
+
+/*
+ * Function  : c_frozen_dict_item
+ * Purpose   : returns a key-value pair by position, for traversal
+ * Parameters: pointer to C_FROZEN_DICT
+ *             position, from 0 to c_frozen_dict_size - 1
+ * Return    : C_DICTITEM, with a NULL key and value if the position is out of
+ *             range
+ */
+C_DICTITEM c_frozen_dict_item (C_FROZEN_DICT *, int index);
+
+/*
+ * Function  : c_frozen_dict_size
+ * Purpose   : returns the number of key-value pairs in a C_FROZEN_DICT
+ * Parameters: pointer to C_FROZEN_DICT
+ * Return    : the number of key-value pairs
+ */
+int c_frozen_dict_size (C_FROZEN_DICT *);
+
 #endif
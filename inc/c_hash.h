@@ -26,16 +26,73 @@
  *
  * Several convenience hash and comparison functions are provided in
  * u_hash_func.
+ *
+ * By default, a C_HASH chains the items in each bucket of the table. The
+ * c_hash_create_base function can instead create an open-addressed C_HASH
+ * (C_HASH_OPEN), which stores each item inline in a single flat array of
+ * slots alongside its hash value. An open-addressed C_HASH does not malloc
+ * per item, and a lookup touches contiguous memory instead of following a
+ * chain of pointers. A group-probed C_HASH (C_HASH_GROUP) adds a control
+ * byte per slot holding seven bits of the slot's hash; a lookup compares a
+ * whole group of control bytes at once (with SSE2 or AVX2 when available)
+ * and calls the comparator only for slots whose fragment matches, so most
+ * lookups of absent items never call the comparator at all. A Robin Hood
+ * C_HASH (C_HASH_ROBIN_HOOD) is open-addressed as well, but an inserted item
+ * takes over any slot whose resident is closer to its home slot, and removal
+ * shifts the following items back instead of leaving deleted slots behind.
+ * Probe lengths stay short and even, a lookup for an absent item stops early,
+ * and the table runs at a load factor of 0.9 instead of 0.75. The public
+ * interface is the same for every type.
+ *
+ * A chained C_HASH normally rehashes all at once, moving every item into a
+ * table twice the size during the insert that crosses the load limit. If
+ * C_HASH_INCREMENTAL is or'ed into the type, the old and new tables are
+ * instead kept side by side and a few buckets are migrated on each
+ * subsequent insert, replace or remove, spreading the cost of the rehash
+ * across later operations.
+ *
+ * The load factor at which a C_HASH grows, the factor by which it grows,
+ * whether it shrinks when items are removed, and whether a chained table
+ * uses power-of-two sizes (picking buckets with a mask) or prime sizes
+ * (picking buckets with a modulo, which suits weaker hash functions) can be
+ * chosen per table with c_hash_create_options.
+ *
+ * Looking an item up (c_hash_find, c_hash_find_many) does not modify the
+ * C_HASH, so any number of threads can search a C_HASH at once as long as
+ * none of them changes it (see c_hash_find Note 1).
  */
 
 #define C_HASH_ERROR_MEMORY -1
 #define C_HASH_ERROR_DUPLICATE -2
 #define C_HASH_ERROR_NOT_FOUND -3
+#define C_HASH_ERROR_FORMAT -4 // not a (compatible) snapshot, or cut short
+#define C_HASH_ERROR_IO -5
 
+#define C_HASH_CHAINED 0
+#define C_HASH_OPEN 1
+#define C_HASH_GROUP 2
+#define C_HASH_ROBIN_HOOD 3
+#define C_HASH_TYPE_MASK 0x0f
+#define C_HASH_INCREMENTAL 0x10
+
+#define C_HASH_SIZE_POWER2 0
+#define C_HASH_SIZE_PRIME 1
+
+#include "c_buffer.h"
 #include "c_iterator.h"
 
 typedef struct C_HASH C_HASH;
 
+/*
+ * Sizing policy for c_hash_create_options. A zero field keeps the default.
+ */
+typedef struct C_HASH_OPTIONS {
+  float max_load;   // items per bucket or slot before the table grows
+  float min_load;   // items per bucket or slot before the table shrinks
+  float growth;     // factor by which the table grows (default 2)
+  int sizing;       // C_HASH_SIZE_POWER2 (default) or C_HASH_SIZE_PRIME
+} C_HASH_OPTIONS;
+
 /*
  * Typedef   : C_HASH_CALCULATOR
  * Purpose   : user callback that calculates a hash value from an item
@@ -53,6 +110,19 @@ typedef struct C_HASH C_HASH;
  */
 typedef unsigned int (*C_HASH_CALCULATOR) (void *item, void *context);
 
+/*
+ * Typedef   : C_HASH_CALCULATOR64
+ * Purpose   : user callback that calculates a 64-bit hash value from an item
+ * Parameters: pointer to item
+ *             context supplied in c_hash_create64
+ * Return    : hash value for item
+ * Notes     :
+ *
+ * 1. See C_HASH_CALCULATOR. hash_func_calculate64 and
+ *    hash_func_accumulate64 help in generating 64-bit hash values.
+ */
+typedef unsigned long long (*C_HASH_CALCULATOR64) (void *item, void *context);
+
 /*
  * Typedef   : C_HASH_COMPARATOR
  * Purpose   : user callback that compares two item
@@ -89,6 +159,15 @@ typedef void (*C_HASH_GARBAGE) (void *item, void *context);
  */
 typedef void * (*C_HASH_ITERATOR_ITEM) (void *user_variable);
 
+/*
+ * Typedef   : C_HASH_VISITOR
+ * Purpose   : user callback that visits an item, for c_hash_walk
+ * Parameters: pointer to item
+ *             context supplied in c_hash_walk
+ * Return    : 0 to go on to the next item, nonzero to stop
+ */
+typedef int (*C_HASH_VISITOR) (void *item, void *context);
+
 /*
  * Function  : c_hash_create
  * Purpose   : creates a new c_hash
@@ -111,6 +190,91 @@ typedef void * (*C_HASH_ITERATOR_ITEM) (void *user_variable);
 C_HASH *c_hash_create (size_t, C_HASH_CALCULATOR, C_HASH_COMPARATOR,
    C_HASH_GARBAGE, void *);
 
+/*
+ * Function  : c_hash_create_base
+ * Purpose   : creates a new c_hash of a specific type
+ * Parameters: size of an item
+ *             item hash calculator callback
+ *             item comparison callback
+ *             garbage collector
+ *             context (supplied to callbacks; can be NULL)
+ *             initial number of items to hold without rehashing (or zero)
+ *             type: C_HASH_CHAINED, C_HASH_OPEN, C_HASH_GROUP or
+ *                   C_HASH_ROBIN_HOOD (Note 1), optionally or'ed with
+ *                   C_HASH_INCREMENTAL (Note 2)
+ * Return    : C_HASH or NULL if out of memory or no table can hold the
+ *             initial number of items
+ * Notes     :
+ *
+ * 1. C_HASH_OPEN and C_HASH_GROUP tables store items inline, so a pointer
+ *    returned by c_hash_find is only valid until the next c_hash_insert (an
+ *    insert can rehash the table and move every item). A C_HASH_CHAINED
+ *    table never moves an item once it is inserted. A C_HASH_ROBIN_HOOD
+ *    table moves items on every insert and remove, so its pointers are only
+ *    valid until the next insert or remove.
+ *
+ * 2. C_HASH_INCREMENTAL applies to C_HASH_CHAINED tables only, and is
+ *    ignored for the other types. Starting an iterator completes any
+ *    migration in progress.
+ *
+ * 3. See c_hash_create for the remaining parameters.
+ */
+C_HASH *c_hash_create_base (size_t, C_HASH_CALCULATOR, C_HASH_COMPARATOR,
+   C_HASH_GARBAGE, void *, int initial, int type);
+
+/*
+ * Function  : c_hash_create_options
+ * Purpose   : creates a new c_hash of a specific type with its own sizing
+ * Parameters: see c_hash_create_base
+ *             pointer to C_HASH_OPTIONS (can be NULL for the defaults)
+ * Return    : C_HASH or NULL if out of memory, the options are invalid or
+ *             no table can hold the initial number of items
+ * Notes     :
+ *
+ * 1. max_load defaults to 0.75 (0.9 for C_HASH_ROBIN_HOOD). It can be over
+ *    1 for a C_HASH_CHAINED table, and must be under 1 for the others.
+ *
+ * 2. When min_load is not zero, a c_hash_remove that leaves fewer items than
+ *    min_load allows shrinks the table, though never below the size it was
+ *    created with. min_load times growth must be under max_load, so that a
+ *    table that has just grown or shrunk is not immediately resized again.
+ *
+ * 3. growth must be over 1. A power-of-two table grows to the next power of
+ *    two at or above the table size times growth; a prime-sized table grows
+ *    to the next prime from an internal list at or above it.
+ *
+ * 4. C_HASH_SIZE_PRIME applies to C_HASH_CHAINED tables only; the other
+ *    types always use power-of-two sizes.
+ *
+ * 5. The options are copied; the C_HASH_OPTIONS need not outlive the call.
+ */
+C_HASH *c_hash_create_options (size_t, C_HASH_CALCULATOR, C_HASH_COMPARATOR,
+   C_HASH_GARBAGE, void *, int initial, int type, C_HASH_OPTIONS *);
+
+/*
+ * Function  : c_hash_create64
+ * Purpose   : creates a new c_hash with a 64-bit hash calculator
+ * Parameters: size of an item
+ *             item 64-bit hash calculator callback
+ *             item comparison callback
+ *             garbage collector
+ *             context (supplied to callbacks; can be NULL)
+ *             initial number of items to hold without rehashing (or zero)
+ *             type (see c_hash_create_base)
+ *             pointer to C_HASH_OPTIONS (can be NULL for the defaults)
+ * Return    : C_HASH or NULL if out of memory, the options are invalid or
+ *             no table can hold the initial number of items
+ * Notes     :
+ *
+ * 1. Every C_HASH stores the full hash of each item and compares it before
+ *    calling the comparator. With a 32-bit calculator, a table of a hundred
+ *    million items has many items sharing each hash value, and lookups end
+ *    up calling the comparator for them; with a 64-bit calculator, a
+ *    lookup of an absent item almost never calls the comparator.
+ */
+C_HASH *c_hash_create64 (size_t, C_HASH_CALCULATOR64, C_HASH_COMPARATOR,
+   C_HASH_GARBAGE, void *, int initial, int type, C_HASH_OPTIONS *);
+
 /*
  * Function  : c_hash_free
  * Purpose   : frees a C_HASH and all internal resources
@@ -140,6 +304,22 @@ void c_hash_clear (C_HASH *);
  */
 int c_hash_insert (C_HASH *, void *item);
 
+/*
+ * Function  : c_hash_insert_unique
+ * Purpose   : adds an item known not to be in a C_HASH
+ * Parameters: pointer to C_HASH
+ *             pointer to an item
+ * Return    : 0 on success
+ *             C_HASH_ERROR_MEMORY
+ * Notes     :
+ *
+ * 1. The item is not compared with the items already in the table, so
+ *    loading items that are known to be distinct (from a snapshot, say) is
+ *    faster than with c_hash_insert. Adding an item that is already in the
+ *    table leaves the table with two equal items.
+ */
+int c_hash_insert_unique (C_HASH *, void *item);
+
 /*
  * Function  : c_hash_replace
  * Purpose   : replaces an item already in a C_HASH with a new one
@@ -156,9 +336,32 @@ int c_hash_replace (C_HASH *, void *item);
  * Parameters: pointer to C_HASH
  *             pointer to item
  * Return    : pointer to matching item, or NULL if not found
+ * Notes     :
+ *
+ * 1. c_hash_find keeps its state on the stack and writes nothing to the
+ *    C_HASH, so it can run in several threads at once. It must not run
+ *    alongside an insert, replace, remove, clear or iterator, which change
+ *    the table; a reader/writer lock around the C_HASH is enough.
  */
 void *c_hash_find (C_HASH *, void *item);
 
+/*
+ * Function  : c_hash_find_many
+ * Purpose   : finds the matching items for a number of items at once
+ * Parameters: pointer to C_HASH
+ *             array of pointers to items
+ *             number of items
+ *             array of pointers to receive the matching items (or NULL)
+ * Return    : the number of items found
+ * Notes     :
+ *
+ * 1. The result is the same as calling c_hash_find for each item, but the
+ *    items are hashed and their table memory prefetched in batches, so the
+ *    cache misses of the lookups overlap. This pays off when the table is
+ *    much larger than the cache.
+ */
+int c_hash_find_many (C_HASH *, void **items, int count, void **results);
+
 /*
  * Function  : c_hash_remove
  * Purpose   : removes a matching item from the C_HASH
@@ -198,6 +401,62 @@ void c_hash_remove (C_HASH *, void *item);
  */
 C_ITERATOR *c_hash_iterator (C_HASH *, C_HASH_ITERATOR_ITEM);
 
+/*
+ * Function  : c_hash_walk
+ * Purpose   : calls a visitor for each item in a C_HASH
+ * Parameters: pointer to C_HASH
+ *             visitor callback
+ *             context passed to the visitor
+ * Return    : 0 if every item was visited, otherwise the nonzero value the
+ *             visitor stopped with
+ * Notes     :
+ *
+ * 1. The items are not visited in any particular order, and the visitor
+ *    must not insert, replace or remove items.
+ *
+ * 2. Unlike the iterator, a walk keeps no state in the C_HASH: it can run
+ *    while the iterator is in use without disturbing it.
+ */
+int c_hash_walk (C_HASH *, C_HASH_VISITOR, void *);
+
+/*
+ * Function  : c_hash_reserve
+ * Purpose   : makes room for a number of items without further rehashing
+ * Parameters: pointer to C_HASH
+ *             number of items
+ * Return    : 0 on success
+ *             C_HASH_ERROR_MEMORY, also if no table can hold that many items
+ * Notes     :
+ *
+ * 1. If the table is already large enough, nothing is done. Otherwise the
+ *    table is rehashed once, immediately (even for C_HASH_INCREMENTAL), into
+ *    a table that can hold the specified number of items before it needs to
+ *    grow again.
+ *
+ * 2. See c_hash_iterator Note 2.
+ */
+int c_hash_reserve (C_HASH *, int count);
+
+/*
+ * Function  : c_hash_shrink_to_fit
+ * Purpose   : shrinks the internal table to suit the current number of items
+ * Parameters: pointer to C_HASH
+ * Return    : 0 on success
+ *             C_HASH_ERROR_MEMORY
+ * Notes     :
+ *
+ * 1. The table is never shrunk below its default initial size. Deleted
+ *    slots in C_HASH_OPEN and C_HASH_GROUP tables are swept out, and any
+ *    C_HASH_INCREMENTAL migration is completed.
+ *
+ * 2. A C_HASH_CHAINED table also frees the chunks of item memory that no
+ *    longer hold any items (see c_slab_trim). Items are never moved to
+ *    empty a chunk, so after many removes some memory may stay in use.
+ *
+ * 3. See c_hash_iterator Note 2.
+ */
+int c_hash_shrink_to_fit (C_HASH *);
+
 /*
  * Function  : c_hash_size
  * Purpose   : returns the number of items in the C_HASH
@@ -213,4 +472,73 @@ int c_hash_size (C_HASH *);
  * Return    : size of an internal table
  */
 int c_hash_table_size (C_HASH *);
+
+/*
+ * Function  : c_hash_snapshot
+ * Purpose   : appends a snapshot of the items in a C_HASH to a C_BUFFER
+ * Parameters: pointer to C_HASH
+ *             pointer to C_BUFFER
+ * Return    : 0 on success
+ *             C_HASH_ERROR_MEMORY (also if the buffer would exceed 2GB)
+ * Notes     :
+ *
+ * 1. A snapshot is a short header (holding the item size and count)
+ *    followed by a copy of every item, in the machine's own byte order. It
+ *    is only meaningful to restore items that hold no pointers (or pointers
+ *    that stay valid, as within one process).
+ * 2. The items are read with c_hash_walk, so an iteration in progress is
+ *    not disturbed.
+ */
+int c_hash_snapshot (C_HASH *, C_BUFFER *);
+
+/*
+ * Function  : c_hash_restore
+ * Purpose   : adds the items in a snapshot at the start of a C_BUFFER to an
+ *             empty C_HASH
+ * Parameters: pointer to C_HASH
+ *             pointer to C_BUFFER
+ * Return    : 0 on success
+ *             C_HASH_ERROR_MEMORY
+ *             C_HASH_ERROR_DUPLICATE if the C_HASH is not empty
+ *             C_HASH_ERROR_FORMAT if the snapshot is not valid, is for
+ *               items of another size, or is cut short
+ * Notes     :
+ *
+ * 1. The table is sized once, for the number of items in the snapshot, and
+ *    the items are added with c_hash_insert_unique.
+ * 2. On success the snapshot is shifted out of the C_BUFFER, so that several
+ *    snapshots written one after another can be restored in turn. On failure
+ *    the C_BUFFER is unchanged, but the C_HASH may hold some of the items.
+ */
+int c_hash_restore (C_HASH *, C_BUFFER *);
+
+/*
+ * Function  : c_hash_snapshot_fd
+ * Purpose   : writes a snapshot of the items in a C_HASH to a file
+ *             descriptor
+ * Parameters: pointer to C_HASH
+ *             file descriptor (a file, pipe or socket)
+ * Return    : 0 on success
+ *             C_HASH_ERROR_MEMORY
+ *             C_HASH_ERROR_IO (see errno)
+ * Notes     :
+ *
+ * 1. The items are written in blocks of about 64KB. See c_hash_snapshot.
+ */
+int c_hash_snapshot_fd (C_HASH *, int fd);
+
+/*
+ * Function  : c_hash_restore_fd
+ * Purpose   : adds the items in a snapshot read from a file descriptor to an
+ *             empty C_HASH
+ * Parameters: pointer to C_HASH
+ *             file descriptor, positioned at the start of a snapshot
+ * Return    : see c_hash_restore, and C_HASH_ERROR_IO (see errno)
+ * Notes     :
+ *
+ * 1. The items are read in blocks of about 64KB, and reading stops at the
+ *    end of the snapshot. See c_hash_restore.
+ */
+int c_hash_restore_fd (C_HASH *, int fd);
+
 #endif
@@ -2,17 +2,38 @@
 #define _C_LIST_H
 
 #include "c_iterator.h"
+#include "c_slab.h"
 
 typedef struct C_LIST C_LIST;
+typedef struct C_LIST_POSITION C_LIST_POSITION; /* an item in a C_LIST */
 
-C_LIST * c_list_create (void);
+C_LIST * c_list_create (void); /* items from a C_SLAB owned by the list */
+C_LIST * c_list_create_slab (C_SLAB *); /* items from a shared C_SLAB */
+C_SLAB * c_list_slab_create (void); /* a C_SLAB sized for list items */
+
+/*
+ * the list itself comes from the second C_SLAB (see c_list_header_slab_create);
+ * lists that are never given an iterator can then be dropped, items and
+ * all, by clearing both C_SLABs instead of freeing each list
+ */
+C_LIST * c_list_create_slabs (C_SLAB *, C_SLAB *);
+C_SLAB * c_list_header_slab_create (void); /* a C_SLAB sized for lists */
 void c_list_free (C_LIST *);
 
-void c_list_add (C_LIST *, void *); /* append */
-void c_list_add_first (C_LIST *, void *);
+int c_list_add (C_LIST *, void *); /* append; 0 on success */
+int c_list_add_first (C_LIST *, void *);
 void *c_list_take (C_LIST *); /* first item (lifo) */
 void *c_list_take_last (C_LIST *);
 
+/*
+ * positions walk a list without touching it, so any number of walks can run
+ * at once; a position is valid until its item is removed
+ */
+C_LIST_POSITION *c_list_first (C_LIST *); /* NULL if empty */
+C_LIST_POSITION *c_list_next (C_LIST_POSITION *); /* NULL past the end */
+void *c_list_value (C_LIST_POSITION *);
+void c_list_remove (C_LIST *, C_LIST_POSITION *);
+
 C_ITERATOR *c_list_iterator (C_LIST *);
 
 int c_list_size (C_LIST *);
@@ -25,9 +25,11 @@
  * creates a C_MAP with a string (null terminated) key.
  */
 
+#include "c_buffer.h"
 #include "c_iterator.h"
 
 typedef struct C_MAP C_MAP;
+typedef struct C_FROZEN_MAP C_FROZEN_MAP;
 
 /*
  * Typedef   : C_MAPITEM
@@ -53,6 +55,29 @@ typedef struct C_MAPITEM {
  */
 typedef unsigned int (*C_MAP_CALCULATOR) (void *key);
 
+/*
+ * Typedef   : C_MAP_CALCULATOR64
+ * Purpose   : user callback that calculates a 64-bit hash value from a key
+ * Parameters: pointer to key
+ * Return    : hash value for key
+ * Notes     : see C_MAP_CALCULATOR and c_hash_create64 Note 1
+ */
+typedef unsigned long long (*C_MAP_CALCULATOR64) (void *key);
+
+/*
+ * Typedef   : C_MAP_KEYED_CALCULATOR
+ * Purpose   : user callback that calculates a keyed 64-bit hash from a key
+ * Parameters: pointer to key
+ *             secret hash key (HASH_FUNC_KEY_SIZE bytes)
+ * Return    : hash value for key
+ * Notes     :
+ *
+ * 1. See C_MAP_CALCULATOR. hash_func_siphash calculates a suitable keyed
+ *    hash value.
+ */
+typedef unsigned long long (*C_MAP_KEYED_CALCULATOR) (void *key,
+  const unsigned char *seed);
+
 /*
  * Typedef   : C_MAP_COMPARATOR
  * Purpose   : user callback that compares two keys
@@ -72,6 +97,42 @@ typedef int (*C_MAP_COMPARATOR) (void *k1, void *k2);
  */
 typedef void (*C_MAP_GARBAGE) (void *key, void *value);
 
+/*
+ * Typedef   : C_MAP_VISITOR
+ * Purpose   : user callback that visits a key-value pair, for c_map_walk
+ * Parameters: pointer to key
+ *             pointer to value
+ *             context supplied in c_map_walk
+ * Return    : 0 to go on to the next pair, nonzero to stop
+ */
+typedef int (*C_MAP_VISITOR) (void *key, void *value, void *context);
+
+/*
+ * Typedef   : C_MAP_WRITER
+ * Purpose   : user callback that appends a key-value pair to a C_BUFFER,
+ *             for c_map_snapshot
+ * Return    : 0 on success, nonzero on failure (out of memory)
+ */
+typedef int (*C_MAP_WRITER) (C_BUFFER *, void *key, void *value);
+
+/*
+ * Typedef   : C_MAP_READER
+ * Purpose   : user callback that rebuilds a key-value pair written by a
+ *             C_MAP_WRITER, for c_map_restore
+ * Parameters: pointer to the pair's data
+ *             number of bytes available (to the end of the snapshot)
+ *             pointer to key (out)
+ *             pointer to value (out)
+ * Return    : number of bytes used, or -1 if the data is not valid or runs
+ *             out (or on out of memory)
+ * Notes     :
+ *
+ * 1. The key and value are new, and belong to the C_MAP from then on; see
+ *    c_map_create Note 1.
+ */
+typedef int (*C_MAP_READER) (char *data, int length, void **key,
+  void **value);
+
 /*
  * Function  : c_map_create
  * Purpose   : creates a new c_map
@@ -101,6 +162,22 @@ typedef void (*C_MAP_GARBAGE) (void *key, void *value);
  */
 C_MAP *c_map_create (C_MAP_CALCULATOR, C_MAP_COMPARATOR, C_MAP_GARBAGE);
 
+/*
+ * Function  : c_map_create_size
+ * Purpose   : creates a new c_map sized for an expected number of entries
+ * Parameters: key hash calculator callback
+ *             key comparison callback
+ *             garbage collector (see c_map_create Note 1)
+ *             expected number of key-value pairs
+ * Return    : C_MAP or NULL if out of memory
+ * Notes     :
+ *
+ * 1. The c_map does not rehash until it holds more than the expected number
+ *    of key-value pairs.
+ */
+C_MAP *c_map_create_size (C_MAP_CALCULATOR, C_MAP_COMPARATOR, C_MAP_GARBAGE,
+  int expected);
+
 /*
  * Function  : c_map_dict_create
  * Purpose   : creates a new c_map with a null-terminated string key
@@ -109,6 +186,127 @@ C_MAP *c_map_create (C_MAP_CALCULATOR, C_MAP_COMPARATOR, C_MAP_GARBAGE);
  */
 C_MAP *c_map_dict_create (C_MAP_GARBAGE);
 
+/*
+ * Function  : c_map_dict_create_size
+ * Purpose   : creates a new c_map with a null-terminated string key, sized
+ *             for an expected number of entries
+ * Parameters: garbage collector (see c_map_create Note 1)
+ *             expected number of key-value pairs
+ * Return    : C_MAP or NULL if out of memory
+ * Notes     : see c_map_create_size Note 1
+ */
+C_MAP *c_map_dict_create_size (C_MAP_GARBAGE, int expected);
+
+/*
+ * Function  : c_map_length_dict_create
+ * Purpose   : creates a new c_map whose keys are HASH_STRINGs
+ * Parameters: garbage collector (see c_map_create Note 1)
+ *             expected number of key-value pairs (or zero)
+ * Return    : C_MAP or NULL if out of memory
+ * Notes     :
+ *
+ * 1. Keys, both those added and those looked up, are pointers to
+ *    HASH_STRINGs (see hash_func.h). A lookup can use a HASH_STRING on the
+ *    stack that points into a buffer, without copying or terminating the
+ *    string. A HASH_STRING added to the map must stay in place (and
+ *    unchanged) until it is removed.
+ */
+C_MAP *c_map_length_dict_create (C_MAP_GARBAGE, int expected);
+
+/*
+ * Function  : c_map_nocase_dict_create
+ * Purpose   : creates a new c_map with a null-terminated string key that is
+ *             matched without respect to case (ASCII letters only)
+ * Parameters: garbage collector (see c_map_create Note 1)
+ * Return    : C_MAP or NULL if out of memory
+ */
+C_MAP *c_map_nocase_dict_create (C_MAP_GARBAGE);
+
+/*
+ * Function  : c_map_nocase_dict_create_size
+ * Purpose   : creates a new c_map with a case-insensitive string key, sized
+ *             for an expected number of entries
+ * Parameters: garbage collector (see c_map_create Note 1)
+ *             expected number of key-value pairs
+ * Return    : C_MAP or NULL if out of memory
+ * Notes     : see c_map_create_size Note 1
+ */
+C_MAP *c_map_nocase_dict_create_size (C_MAP_GARBAGE, int expected);
+
+/*
+ * Function  : c_map_create64
+ * Purpose   : creates a new c_map with a 64-bit key hash, sized for an
+ *             expected number of entries
+ * Parameters: key 64-bit hash calculator callback
+ *             key comparison callback
+ *             garbage collector (see c_map_create Note 1)
+ *             expected number of key-value pairs (or zero)
+ * Return    : C_MAP or NULL if out of memory
+ * Notes     :
+ *
+ * 1. Meant for maps large enough that 32-bit hashes collide often; see
+ *    c_hash_create64 Note 1.
+ */
+C_MAP *c_map_create64 (C_MAP_CALCULATOR64, C_MAP_COMPARATOR, C_MAP_GARBAGE,
+  int expected);
+
+/*
+ * Function  : c_map_dict_create64
+ * Purpose   : creates a new c_map with a null-terminated string key and a
+ *             64-bit key hash
+ * Parameters: garbage collector (see c_map_create Note 1)
+ *             expected number of key-value pairs (or zero)
+ * Return    : C_MAP or NULL if out of memory
+ */
+C_MAP *c_map_dict_create64 (C_MAP_GARBAGE, int expected);
+
+/*
+ * Function  : c_map_symbol_create
+ * Purpose   : creates a new c_map whose keys are symbols from a C_SYMBOL
+ * Parameters: garbage collector (see c_map_create Note 1)
+ *             expected number of key-value pairs (or zero)
+ * Return    : C_MAP or NULL if out of memory
+ * Notes     :
+ *
+ * 1. Keys, both those added and those looked up, must be symbols returned
+ *    by c_symbol_add or c_symbol_find on one C_SYMBOL. A key is hashed by
+ *    reading the hash stored with it (c_symbol_hash) and compared by pointer,
+ *    so no key string is ever read.
+ */
+C_MAP *c_map_symbol_create (C_MAP_GARBAGE, int expected);
+
+/*
+ * Function  : c_map_create_keyed
+ * Purpose   : creates a new c_map whose key hash is keyed with a random
+ *             secret, for keys that come from untrusted sources
+ * Parameters: key keyed hash calculator callback
+ *             key comparison callback
+ *             garbage collector (see c_map_create Note 1)
+ *             expected number of key-value pairs (or zero)
+ * Return    : C_MAP or NULL if out of memory
+ * Notes     :
+ *
+ * 1. Each c_map gets its own secret, which is passed to the calculator with
+ *    every key. Someone who can choose the keys can't work out in advance
+ *    which of them collide, and so can't force lookups into long chains.
+ *
+ * 2. A keyed hash costs more to calculate than the plain hash_func ones;
+ *    maps whose keys are trusted don't need one.
+ */
+C_MAP *c_map_create_keyed (C_MAP_KEYED_CALCULATOR, C_MAP_COMPARATOR,
+  C_MAP_GARBAGE, int expected);
+
+/*
+ * Function  : c_map_dict_create_keyed
+ * Purpose   : creates a new c_map with a null-terminated string key hashed
+ *             with SipHash under a random secret
+ * Parameters: garbage collector (see c_map_create Note 1)
+ *             expected number of key-value pairs (or zero)
+ * Return    : C_MAP or NULL if out of memory
+ * Notes     : see c_map_create_keyed
+ */
+C_MAP *c_map_dict_create_keyed (C_MAP_GARBAGE, int expected);
+
 /*
  * Function  : c_map_free
  * Purpose   : frees a C_MAP and all internal resources
@@ -155,6 +353,10 @@ int c_map_add (C_MAP *, void *key, void *value);
  * 1. If NULL is supplied as the value for c_map entries, then the value 'NULL'
  *    would be indistinquishable from the 'no value found' indicator. In this
  *    case, c_map_exists must be used to tell if an entry exists.
+ *
+ * 2. c_map_find, c_map_find_key, c_map_find_many and c_map_exists do not
+ *    modify the C_MAP, so several threads can call them at once, as long as
+ *    no thread is changing the C_MAP at the same time.
  */
 void *c_map_find (C_MAP *, void *key);
 
@@ -173,6 +375,21 @@ void *c_map_find (C_MAP *, void *key);
  */
 void *c_map_find_key (C_MAP *, void *key);
 
+/*
+ * Function  : c_map_find_many
+ * Purpose   : finds the values associated with a number of keys at once
+ * Parameters: pointer to C_MAP
+ *             array of keys
+ *             number of keys
+ *             array to receive the values (NULL for a key not found)
+ * Return    : the number of keys found
+ * Notes     :
+ *
+ * 1. See c_hash_find_many. As with c_map_find, a NULL value can't be told
+ *    from a missing key, but the count of keys found still includes it.
+ */
+int c_map_find_many (C_MAP *, void **keys, int count, void **values);
+
 /*
  * Function  : c_map_exists
  * Purpose   : indicates if a key exists in the c_map
@@ -241,6 +458,41 @@ C_ITERATOR *c_map_key_iterator (C_MAP *);
  */
 C_ITERATOR *c_map_value_iterator (C_MAP *);
 
+/*
+ * Function  : c_map_walk
+ * Purpose   : calls a visitor for each key-value pair in a C_MAP
+ * Parameters: pointer to C_MAP
+ *             visitor callback
+ *             context passed to the visitor
+ * Return    : 0 if every pair was visited, otherwise the nonzero value the
+ *             visitor stopped with
+ * Notes     :
+ *
+ * 1. See c_hash_walk: a walk does not disturb the C_MAP's iterator, and
+ *    the visitor must not change the C_MAP.
+ */
+int c_map_walk (C_MAP *, C_MAP_VISITOR, void *);
+
+/*
+ * Function  : c_map_reserve
+ * Purpose   : makes room for a number of key-value pairs without rehashing
+ * Parameters: pointer to C_MAP
+ *             number of key-value pairs
+ * Return    : 0 on success; otherwise, out of memory
+ * Notes     : see c_hash_reserve
+ */
+int c_map_reserve (C_MAP *, int count);
+
+/*
+ * Function  : c_map_shrink_to_fit
+ * Purpose   : shrinks the internal table to suit the current number of
+ *             key-value pairs
+ * Parameters: pointer to C_MAP
+ * Return    : 0 on success; otherwise, out of memory
+ * Notes     : see c_hash_shrink_to_fit
+ */
+int c_map_shrink_to_fit (C_MAP *);
+
 /*
  * Function  : c_map_size
  * Purpose   : returns the number of key-value pairs in the c_map
@@ -256,4 +508,106 @@ int c_map_size (C_MAP *);
  * Return    : size of an internal table
  */
 int c_map_table_size (C_MAP *);
+
+/*
+ * Function  : c_map_snapshot
+ * Purpose   : appends a snapshot of the key-value pairs in a C_MAP to a
+ *             C_BUFFER
+ * Parameters: pointer to C_MAP
+ *             pointer to C_BUFFER
+ *             writer callback
+ * Return    : 0 on success; otherwise, out of memory
+ * Notes     :
+ *
+ * 1. The snapshot is a short header, holding the number of pairs, followed
+ *    by whatever the writer appends for each pair.
+ * 2. The pairs are read with c_hash_walk, not the C_MAP's iterator, so an
+ *    iteration in progress is not disturbed. The writer must not change
+ *    the C_MAP.
+ */
+int c_map_snapshot (C_MAP *, C_BUFFER *, C_MAP_WRITER);
+
+/*
+ * Function  : c_map_restore
+ * Purpose   : adds the key-value pairs in a snapshot at the start of a
+ *             C_BUFFER to an empty C_MAP
+ * Parameters: pointer to C_MAP
+ *             pointer to C_BUFFER
+ *             reader callback
+ * Return    : 0 on success
+ *             C_HASH_ERROR_MEMORY (see c_hash.h)
+ *             C_HASH_ERROR_DUPLICATE if the C_MAP is not empty
+ *             C_HASH_ERROR_FORMAT if the snapshot (or the reader) fails
+ * Notes     :
+ *
+ * 1. The map is sized once, for the number of pairs in the snapshot, and
+ *    the pairs are added without comparing keys (see c_hash_insert_unique),
+ *    so the keys in the snapshot must be distinct.
+ * 2. See c_hash_restore Note 2.
+ */
+int c_map_restore (C_MAP *, C_BUFFER *, C_MAP_READER);
+
+/*
+ * Function  : c_map_freeze
+ * Purpose   : turns a C_MAP into an immutable C_FROZEN_MAP
+ * Parameters: pointer to C_MAP
+ * Return    : C_FROZEN_MAP or NULL if out of memory
+ * Notes     :
+ *
+ * 1. On success the C_MAP is freed, and its key-value pairs and garbage
+ *    collector pass to the C_FROZEN_MAP, which looks keys up with the
+ *    C_MAP's calculator and comparator. On failure the C_MAP is unchanged.
+ * 2. A C_FROZEN_MAP holds the pairs in one packed array, indexed by a
+ *    minimal perfect hash (see c_mph.h), so a lookup examines a single
+ *    entry and there is no allocation per pair. It is meant for maps that
+ *    are built once and then only read.
+ * 3. A C_FROZEN_MAP is never changed, so any number of threads may look
+ *    keys up at once.
+ */
+C_FROZEN_MAP *c_map_freeze (C_MAP *);
+
+/*
+ * Function  : c_frozen_map_free
+ * Purpose   : frees a C_FROZEN_MAP and all internal resources
+ * Parameters: pointer to C_FROZEN_MAP
+ * Return    : none
+ * Notes     : the garbage collector (see c_map_create Note 1), if any, is
+ *             called on every key-value pair
+ */
+void c_frozen_map_free (C_FROZEN_MAP *);
+
+/*
+ * Function  : c_frozen_map_find
+ * Purpose   : finds the value associated with a key
+ * Parameters: pointer to C_FROZEN_MAP
+ *             pointer to key
+ * Return    : pointer to value, or NULL if not found
+ */
+void *c_frozen_map_find (C_FROZEN_MAP *, void *key);
+
+/*
+ * Function  : c_frozen_map_find_key
+ * Purpose   : finds the stored key equal to a key
+ * Parameters: pointer to C_FROZEN_MAP
+ *             pointer to key
+ * Return    : pointer to the stored key, or NULL if not found
+ */
+void *c_frozen_map_find_key (C_FROZEN_MAP *, void *key);
+
+/*
+ * Function  : c_frozen_map_item
+ * Purpose   : returns a key-value pair by position, for traversal
+ * Parameters: pointer to C_FROZEN_MAP
+ *             position, from 0 to c_frozen_map_size - 1
+ * Return    : pointer to C_MAPITEM, or NULL if the position is out of range
+ */
+C_MAPITEM *c_frozen_map_item (C_FROZEN_MAP *, int index);
+
+/*
+ * Function  : c_frozen_map_size
+ * Purpose   : returns the number of key-value pairs in a C_FROZEN_MAP
+ * Parameters: pointer to C_FROZEN_MAP
+ * Return    : the number of key-value pairs
+ */
+int c_frozen_map_size (C_FROZEN_MAP *);
 #endif
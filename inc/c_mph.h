@@ -0,0 +1,115 @@
+#ifndef _C_MPH_H
+#define _C_MPH_H
+
+/*
+ * A C_MPH is a minimal perfect hash function over a fixed set of 64-bit hash
+ * values: it maps each value in the set to its own position from 0 up to
+ * the number of values, with no gaps and no collisions, using about four
+ * bytes for every four values. It is the index behind the frozen containers
+ * (c_map_freeze and c_dict_freeze), which store their entries in a packed
+ * array in position order so that a lookup is a single probe.
+ *
+ * The function is built with the CHD (compress, hash and displace) method.
+ * The values are spread over buckets of about four values each, and the
+ * buckets, largest first, are each given the first displacement that sends
+ * all of their values to free positions. A lookup hashes the value to its
+ * bucket, reads the bucket's displacement, and hashes the value with the
+ * displacement to its position.
+ *
+ * To build a C_MPH, pass c_mph_create an array of hash values, one per entry
+ * of the container; entries may share a hash value. Along with the C_MPH,
+ * c_mph_create fills in the order in which to store the entries, so that
+ * the entries for every hash value end up next to each other, at the
+ * position c_mph_find returns for that value.
+ *
+ * A C_MPH can be copied into a flat, position-independent image with
+ * c_mph_image, for instance to be written to a file along with the entries
+ * it indexes; c_mph_map makes a C_MPH that works directly on such an image.
+ */
+
+#include <stddef.h>
+
+typedef struct C_MPH C_MPH;
+
+/*
+ * Function  : c_mph_create
+ * Purpose   : builds a minimal perfect hash over a set of hash values
+ * Parameters: array of hash values
+ *             number of hash values
+ *             array of the same size that receives the storage order
+ * Return    : C_MPH or NULL if out of memory
+ * Notes     :
+ *
+ * 1. On return, order [i] is the index (into the array of hash values) of
+ *    the entry to store at position i.
+ */
+C_MPH *c_mph_create (const unsigned long long *hashes, int count, int *order);
+
+/*
+ * Function  : c_mph_free
+ * Purpose   : frees a C_MPH
+ * Parameters: pointer to C_MPH
+ * Return    : none
+ */
+void c_mph_free (C_MPH *);
+
+/*
+ * Function  : c_mph_find
+ * Purpose   : finds the position of the entries for a hash value
+ * Parameters: pointer to C_MPH
+ *             hash value
+ *             pointer to the number of entries at the position (out)
+ * Return    : position of the first entry
+ * Notes     :
+ *
+ * 1. A hash value that was not in the set is sent to some position all the
+ *    same, so the caller must check that an entry found there matches.
+ * 2. The number of entries is 1 unless several entries share a hash value.
+ */
+int c_mph_find (C_MPH *, unsigned long long hash, int *count);
+
+/*
+ * Function  : c_mph_size
+ * Purpose   : returns the number of hash values (entries) in a C_MPH
+ * Parameters: pointer to C_MPH
+ * Return    : the number of entries
+ */
+int c_mph_size (C_MPH *);
+
+/*
+ * Function  : c_mph_image_size
+ * Purpose   : returns the size of the image of a C_MPH
+ * Parameters: pointer to C_MPH
+ * Return    : size in bytes
+ */
+size_t c_mph_image_size (C_MPH *);
+
+/*
+ * Function  : c_mph_image
+ * Purpose   : copies a C_MPH into a flat image
+ * Parameters: pointer to C_MPH
+ *             buffer of c_mph_image_size bytes, 4-byte aligned
+ * Return    : none
+ * Notes     :
+ *
+ * 1. The image holds no pointers, but it is in the machine's own byte
+ *    order.
+ */
+void c_mph_image (C_MPH *, void *image);
+
+/*
+ * Function  : c_mph_map
+ * Purpose   : makes a C_MPH that uses an image in place
+ * Parameters: image, 4-byte aligned
+ *             size of the image in bytes
+ * Return    : C_MPH, or NULL if out of memory or the image is not valid
+ * Notes     :
+ *
+ * 1. The image is not copied, and it must stay in place, unchanged, until
+ *    the C_MPH is freed. It may be read-only memory (a mapped file).
+ * 2. The image is checked, so a damaged one can't make c_mph_find return a
+ *    position outside 0 to c_mph_size.
+ */
+C_MPH *c_mph_map (const void *image, size_t size);
+
+#endif
@@ -0,0 +1,222 @@
+#ifndef _C_RCU_MAP_H
+#define _C_RCU_MAP_H
+
+/*
+ * A C_RCU_MAP implements a C_MAP for data that is read far more often than
+ * it is changed. Readers never take a lock and never write to memory shared
+ * with other threads; writers take a lock among themselves, publish their
+ * changes with atomic stores, and hold on to anything a reader might still
+ * be looking at until every reader has moved past it.
+ *
+ * Each thread that reads the map creates a C_RCU_READER with
+ * c_rcu_map_reader_create and brackets its lookups with c_rcu_map_read_lock
+ * and c_rcu_map_read_unlock. Neither call blocks; they only record, in the
+ * reader's own cache line, whether the thread is reading. Keys and values
+ * found inside the bracket stay valid until the matching unlock.
+ *
+    c_rcu_map_read_lock (reader);
+    route = c_rcu_map_find (map, destination);
+    if (route) send (route, message);
+    c_rcu_map_read_unlock (reader);
+
+ * Writers use c_rcu_map_insert, c_rcu_map_add, c_rcu_map_remove and
+ * c_rcu_map_clear from any thread, without a C_RCU_READER. Memory unlinked
+ * by a writer, together with the C_MAP_GARBAGE call for the key and value it
+ * held, is deferred until no reader can still see it. Each write reclaims
+ * what it can; c_rcu_map_reclaim does so on demand.
+ *
+ * A read-side bracket should be short: while a reader is inside one,
+ * nothing retired after it began can be reclaimed.
+ */
+
+#include "c_map.h"
+
+#define C_RCU_MAP_ERROR_MEMORY -1
+#define C_RCU_MAP_ERROR_DUPLICATE -2
+
+typedef struct C_RCU_MAP C_RCU_MAP;
+typedef struct C_RCU_READER C_RCU_READER;
+
+/*
+ * Typedef   : C_RCU_MAP_VISITOR
+ * Purpose   : user callback called for each entry by c_rcu_map_foreach
+ * Parameters: pointer to key
+ *             pointer to value
+ *             context (supplied to c_rcu_map_foreach)
+ * Return    : 0 to continue, non-zero to stop
+ */
+typedef int (*C_RCU_MAP_VISITOR) (void *key, void *value, void *context);
+
+/*
+ * Function  : c_rcu_map_create
+ * Purpose   : creates a new c_rcu_map
+ * Parameters: key hash calculator callback
+ *             key comparison callback
+ *             garbage collector (see c_map_create Note 1, and Note 1)
+ * Return    : C_RCU_MAP or NULL if out of memory
+ * Notes     :
+ *
+ * 1. The garbage collector is called when the key and value can no longer
+ *    be seen by any reader, which may be some time after the remove or add
+ *    that unlinked them. It is called by whichever writer (or
+ *    c_rcu_map_reclaim) gets there first, with the writers' lock held.
+ */
+C_RCU_MAP *c_rcu_map_create (C_MAP_CALCULATOR, C_MAP_COMPARATOR,
+  C_MAP_GARBAGE);
+
+/*
+ * Function  : c_rcu_map_dict_create
+ * Purpose   : creates a new c_rcu_map with a null-terminated string key
+ * Parameters: garbage collector (see c_rcu_map_create Note 1)
+ * Return    : C_RCU_MAP or NULL if out of memory
+ */
+C_RCU_MAP *c_rcu_map_dict_create (C_MAP_GARBAGE);
+
+/*
+ * Function  : c_rcu_map_free
+ * Purpose   : frees a C_RCU_MAP, every key-value pair and every reader
+ * Parameters: pointer to C_RCU_MAP
+ * Return    : none
+ * Notes     :
+ *
+ * 1. No other thread may be using the C_RCU_MAP or any of its readers.
+ */
+void c_rcu_map_free (C_RCU_MAP *);
+
+/*
+ * Function  : c_rcu_map_reader_create
+ * Purpose   : registers a reading thread with the C_RCU_MAP
+ * Parameters: pointer to C_RCU_MAP
+ * Return    : C_RCU_READER or NULL if out of memory
+ * Notes     :
+ *
+ * 1. A C_RCU_READER belongs to the thread that uses it; each reading thread
+ *    needs its own.
+ */
+C_RCU_READER *c_rcu_map_reader_create (C_RCU_MAP *);
+
+/*
+ * Function  : c_rcu_map_reader_free
+ * Purpose   : unregisters and frees a C_RCU_READER
+ * Parameters: pointer to C_RCU_READER (must not be inside a read lock)
+ * Return    : none
+ */
+void c_rcu_map_reader_free (C_RCU_READER *);
+
+/*
+ * Function  : c_rcu_map_read_lock
+ * Purpose   : starts a read-side section
+ * Parameters: pointer to C_RCU_READER
+ * Return    : none
+ * Notes     :
+ *
+ * 1. Read-side sections do not nest.
+ */
+void c_rcu_map_read_lock (C_RCU_READER *);
+
+/*
+ * Function  : c_rcu_map_read_unlock
+ * Purpose   : ends a read-side section
+ * Parameters: pointer to C_RCU_READER
+ * Return    : none
+ */
+void c_rcu_map_read_unlock (C_RCU_READER *);
+
+/*
+ * Function  : c_rcu_map_find
+ * Purpose   : finds the value associated with a key
+ * Parameters: pointer to C_RCU_MAP
+ *             pointer to key
+ * Return    : pointer to value, or NULL if not found (see c_map_find Note 1)
+ * Notes     :
+ *
+ * 1. Must be called inside a read-side section; the value can be used until
+ *    the section ends.
+ */
+void *c_rcu_map_find (C_RCU_MAP *, void *key);
+
+/*
+ * Function  : c_rcu_map_exists
+ * Purpose   : indicates if a key exists in the c_rcu_map
+ * Parameters: pointer to C_RCU_MAP
+ *             pointer to key
+ * Return    : non-zero if the key is found
+ * Notes     : see c_rcu_map_find Note 1
+ */
+int c_rcu_map_exists (C_RCU_MAP *, void *key);
+
+/*
+ * Function  : c_rcu_map_foreach
+ * Purpose   : calls a C_RCU_MAP_VISITOR for each key-value pair
+ * Parameters: pointer to C_RCU_MAP
+ *             C_RCU_MAP_VISITOR
+ *             context (supplied to the visitor; can be NULL)
+ * Return    : the non-zero value that stopped the visit, or 0
+ * Notes     :
+ *
+ * 1. Must be called inside a read-side section. Pairs added or removed
+ *    during the visit may or may not be seen.
+ */
+int c_rcu_map_foreach (C_RCU_MAP *, C_RCU_MAP_VISITOR, void *context);
+
+/*
+ * Function  : c_rcu_map_insert
+ * Purpose   : adds a key-value pair if the key is not already present
+ * Parameters: pointer to C_RCU_MAP
+ *             pointer to key
+ *             pointer to value
+ * Return    : 0 on success
+ *             C_RCU_MAP_ERROR_DUPLICATE if the key is present
+ *             C_RCU_MAP_ERROR_MEMORY
+ */
+int c_rcu_map_insert (C_RCU_MAP *, void *key, void *value);
+
+/*
+ * Function  : c_rcu_map_add
+ * Purpose   : adds a key-value pair, replacing the value of a present key
+ * Parameters: pointer to C_RCU_MAP
+ *             pointer to key
+ *             pointer to value
+ * Return    : 0 on success
+ *             C_RCU_MAP_ERROR_MEMORY
+ * Notes     :
+ *
+ * 1. The garbage collector is called as described in c_map_create Note 2,
+ *    except that the call for the old value is deferred.
+ */
+int c_rcu_map_add (C_RCU_MAP *, void *key, void *value);
+
+/*
+ * Function  : c_rcu_map_remove
+ * Purpose   : removes a key-value pair
+ * Parameters: pointer to C_RCU_MAP
+ *             pointer to key
+ * Return    : none
+ */
+void c_rcu_map_remove (C_RCU_MAP *, void *key);
+
+/*
+ * Function  : c_rcu_map_clear
+ * Purpose   : removes every key-value pair
+ * Parameters: pointer to C_RCU_MAP
+ * Return    : none
+ */
+void c_rcu_map_clear (C_RCU_MAP *);
+
+/*
+ * Function  : c_rcu_map_reclaim
+ * Purpose   : frees retired memory that no reader can still see
+ * Parameters: pointer to C_RCU_MAP
+ * Return    : the number of retired objects still waiting for readers
+ */
+int c_rcu_map_reclaim (C_RCU_MAP *);
+
+/*
+ * Function  : c_rcu_map_size
+ * Purpose   : returns the number of key-value pairs
+ * Parameters: pointer to C_RCU_MAP
+ * Return    : the number of key-value pairs
+ */
+int c_rcu_map_size (C_RCU_MAP *);
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef _C_SLAB_H
+#define _C_SLAB_H
+
+/*
+ * A C_SLAB implements an allocator for objects of a single, fixed size.
+ * Objects are carved out of large chunks of memory instead of being malloced
+ * one at a time; a released object goes onto a free list and is handed out
+ * again by the next allocation. This avoids most calls to malloc and free,
+ * as well as the per-allocation overhead malloc adds to small objects.
+ *
+ * To create a new C_SLAB, use the c_slab_create function, supplying the size
+ * of the objects it will allocate. Use c_slab_alloc to get an object and
+ * c_slab_release to give it back. The c_slab_clear function releases every
+ * object at once by freeing the chunks themselves, so its cost depends on the
+ * number of chunks rather than the number of objects. The c_slab_trim
+ * function gives back the chunks that no longer hold any objects in use.
+ *
+ * Chunks start small and double in size (up to a limit) as the C_SLAB grows,
+ * so a C_SLAB holding only a few objects stays small.
+ */
+
+#include <sys/types.h>
+#include "c_allocator.h"
+
+typedef struct C_SLAB C_SLAB;
+
+/*
+ * Function  : c_slab_create
+ * Purpose   : creates a new slab allocator
+ * Parameters: size of each object
+ * Return    : C_SLAB or NULL if out of memory
+ */
+C_SLAB *c_slab_create (size_t);
+
+/*
+ * Function  : c_slab_free
+ * Purpose   : frees a C_SLAB and every object allocated from it
+ * Parameters: pointer to C_SLAB
+ * Return    : none
+ */
+void c_slab_free (C_SLAB *);
+
+/*
+ * Function  : c_slab_alloc
+ * Purpose   : allocates an object
+ * Parameters: pointer to C_SLAB
+ * Return    : pointer to object, or NULL if out of memory
+ * Notes     :
+ *
+ * 1. The contents of the object are undefined.
+ */
+void *c_slab_alloc (C_SLAB *);
+
+/*
+ * Function  : c_slab_release
+ * Purpose   : returns an object to the C_SLAB for re-use
+ * Parameters: pointer to C_SLAB
+ *             pointer to object (from c_slab_alloc on the same C_SLAB)
+ * Return    : none
+ */
+void c_slab_release (C_SLAB *, void *);
+
+/*
+ * Function  : c_slab_clear
+ * Purpose   : releases every object allocated from the C_SLAB
+ * Parameters: pointer to C_SLAB
+ * Return    : none
+ * Notes     :
+ *
+ * 1. All memory held by the C_SLAB is freed; pointers to objects allocated
+ *    before the call are no longer valid.
+ */
+void c_slab_clear (C_SLAB *);
+
+/*
+ * Function  : c_slab_trim
+ * Purpose   : frees the chunks in which every object has been released
+ * Parameters: pointer to C_SLAB
+ * Return    : zero on success; nonzero if out of memory
+ * Notes     :
+ *
+ * 1. Objects still in use are never moved, so a chunk holding even one of
+ *    them is kept; how much is given back depends on how the objects in
+ *    use are spread over the chunks.
+ *
+ * 2. This takes time in proportion to the number of released objects
+ *    (times the logarithm of the number of chunks).
+ */
+int c_slab_trim (C_SLAB *);
+
+/*
+ * Function  : c_slab_allocator
+ * Purpose   : returns the C_ALLOCATOR that supplies the C_SLAB's chunks
+ * Parameters: pointer to C_SLAB
+ * Return    : pointer to C_ALLOCATOR
+ */
+C_ALLOCATOR *c_slab_allocator (C_SLAB *);
+
+/*
+ * Function  : c_slab_size
+ * Purpose   : returns the number of objects currently allocated
+ * Parameters: pointer to C_SLAB
+ * Return    : the number of objects currently allocated
+ */
+int c_slab_size (C_SLAB *);
+
+#endif
@@ -13,12 +13,39 @@
  *
  * The contents of the C_SYMBOL can be (arbitrarily) traversed using the
  * C_ITERATOR returned from the c_symbol_iterator function.
+ *
+ * Every symbol carries its hash value and length just ahead of its first
+ * byte, so c_symbol_hash and c_symbol_length are O(1). Since the table holds
+ * one instance of each string, two symbols from the same C_SYMBOL are equal
+ * exactly when they are the same pointer; c_map_symbol_create makes a C_MAP
+ * keyed on symbols that uses both facts.
+ *
+ * Every symbol also has an integer id. Ids are handed out in order, 0, 1,
+ * 2 ..., as symbols are added, so they can index an array sized by
+ * c_symbol_id_count; c_symbol_by_id maps an id back to its symbol.
+ *
+ * Every symbol also has room for one pointer of the caller's, read with
+ * c_symbol_value and written with c_symbol_set_value, so that a symbol found
+ * in the table can lead straight to data attached to it.
+ *
+ * By default every symbol is a separate allocation. A C_SYMBOL created with
+ * the C_SYMBOL_ARENA flag instead copies symbols one after another into
+ * large blocks, which saves the per-allocation overhead on short strings and
+ * keeps symbols close together in memory. Its memory is released only in
+ * bulk, by c_symbol_clear and c_symbol_free.
  */
 
+#include <stddef.h>
 #include "c_iterator.h"
 
 typedef struct C_SYMBOL C_SYMBOL;
 
+/*
+ * flags for c_symbol_create_flags
+ */
+#define C_SYMBOL_KEYED 0x01 // see c_symbol_create_keyed
+#define C_SYMBOL_ARENA 0x02 // pack symbols into blocks freed only in bulk
+
 /*
  * Function  : c_symbol_create
  * Purpose   : creates a new symbol table
@@ -27,6 +54,39 @@ typedef struct C_SYMBOL C_SYMBOL;
  */
 C_SYMBOL *c_symbol_create (void);
 
+/*
+ * Function  : c_symbol_create_size
+ * Purpose   : creates a new symbol table sized for an expected number of
+ *             symbols
+ * Parameters: expected number of symbols
+ * Return    : C_SYMBOL or NULL if out of memory
+ */
+C_SYMBOL *c_symbol_create_size (int expected);
+
+/*
+ * Function  : c_symbol_create_keyed
+ * Purpose   : creates a new symbol table for strings from untrusted sources
+ * Parameters: expected number of symbols (or zero)
+ * Return    : C_SYMBOL or NULL if out of memory
+ * Notes     : see c_map_create_keyed
+ */
+C_SYMBOL *c_symbol_create_keyed (int expected);
+
+/*
+ * Function  : c_symbol_create_flags
+ * Purpose   : creates a new symbol table with the given options
+ * Parameters: expected number of symbols (or zero)
+ *             flags (C_SYMBOL_KEYED, C_SYMBOL_ARENA or both)
+ * Return    : C_SYMBOL or NULL if out of memory
+ * Notes     :
+ *
+ * 1. With C_SYMBOL_ARENA, c_symbol_remove (and removal through the
+ *    iterator) takes a symbol out of the table but does not release its
+ *    memory, and the symbol's pointer stays valid until c_symbol_clear or
+ *    c_symbol_free. Adding the same string again makes a new copy.
+ */
+C_SYMBOL *c_symbol_create_flags (int expected, int flags);
+
 /*
  * Function  : c_symbol_free
  * Purpose   : frees a C_SYMBOL and all internal resources
@@ -41,24 +101,141 @@ void c_symbol_free (C_SYMBOL *);
  * Parameters: pointer to C_SYMBOL
  *             string
  * Return    : pointer to symbol (string) on success
- *             0 on out of memory
+ *             0 on out of memory, or if the string is 4GB or longer
  * Notes     :
  *
  * 1. If the string is already in the symbol table, then a pointer to the
  *    existing symbol is returned; otherwise a new symbol is added and a
  *    pointer to THAT symbol is returned.
+ * 2. Each new symbol is given the next id (see c_symbol_id).
  */
 char *c_symbol_add (C_SYMBOL *, char *string);
 
+/*
+ * Function  : c_symbol_add_n
+ * Purpose   : adds a counted string to a symbol table
+ * Parameters: pointer to C_SYMBOL
+ *             string (need not be null-terminated)
+ *             length of string in bytes
+ * Return    : pointer to symbol (null-terminated string) on success
+ *             0 on out of memory, or if the string is 4GB or longer
+ * Notes     : see c_symbol_add
+ */
+char *c_symbol_add_n (C_SYMBOL *, const char *string, size_t length);
+
 /*
  * Function  : c_symbol_find
  * Purpose   : finds the symbol representing a string
  * Parameters: pointer to C_SYMBOL
  *             string
  * Return    : pointer to symbol (string), or NULL if not found
+ * Notes     :
+ *
+ * 1. Several threads can call c_symbol_find at once, as long as no thread is
+ *    adding or removing symbols at the same time (see c_hash_find Note 1).
  */
 char *c_symbol_find (C_SYMBOL *, char *string);
 
+/*
+ * Function  : c_symbol_find_n
+ * Purpose   : finds the symbol representing a counted string
+ * Parameters: pointer to C_SYMBOL
+ *             string (need not be null-terminated)
+ *             length of string in bytes
+ * Return    : pointer to symbol (string), or NULL if not found
+ * Notes     : see c_symbol_find Note 1
+ */
+char *c_symbol_find_n (C_SYMBOL *, const char *string, size_t length);
+
+/*
+ * Function  : c_symbol_hash
+ * Purpose   : returns the hash value stored with a symbol
+ * Parameters: symbol (as returned by c_symbol_add or c_symbol_find)
+ * Return    : hash value
+ * Notes     :
+ *
+ * 1. The argument must be a symbol, not merely an equal string.
+ * 2. The value is the hash_func_calculate hash of the symbol, or its
+ *    hash_func_siphash under the table's secret key for a table made by
+ *    c_symbol_create_keyed.
+ */
+unsigned long long c_symbol_hash (const char *symbol);
+
+/*
+ * Function  : c_symbol_length
+ * Purpose   : returns the length of a symbol
+ * Parameters: symbol (as returned by c_symbol_add or c_symbol_find)
+ * Return    : length in bytes, not counting the terminating null
+ * Notes     : see c_symbol_hash Note 1
+ */
+size_t c_symbol_length (const char *symbol);
+
+/*
+ * Function  : c_symbol_intern_id
+ * Purpose   : adds a counted string to a symbol table and returns its id
+ * Parameters: pointer to C_SYMBOL
+ *             string (need not be null-terminated)
+ *             length of string in bytes
+ * Return    : id of the symbol on success
+ *             -1 on out of memory, or if the string is 4GB or longer
+ * Notes     : see c_symbol_add
+ */
+int c_symbol_intern_id (C_SYMBOL *, const char *string, size_t length);
+
+/*
+ * Function  : c_symbol_id
+ * Purpose   : returns the id of a symbol
+ * Parameters: symbol (as returned by c_symbol_add or c_symbol_find)
+ * Return    : id, from 0 to c_symbol_id_count - 1
+ * Notes     : see c_symbol_hash Note 1
+ */
+int c_symbol_id (const char *symbol);
+
+/*
+ * Function  : c_symbol_value
+ * Purpose   : returns the pointer attached to a symbol
+ * Parameters: symbol (as returned by c_symbol_add or c_symbol_find)
+ * Return    : the pointer last given to c_symbol_set_value, or NULL
+ * Notes     : see c_symbol_hash Note 1
+ */
+void *c_symbol_value (const char *symbol);
+
+/*
+ * Function  : c_symbol_set_value
+ * Purpose   : attaches a pointer to a symbol
+ * Parameters: symbol (as returned by c_symbol_add or c_symbol_find)
+ *             pointer to attach (can be NULL)
+ * Return    : none
+ * Notes     :
+ *
+ * 1. See c_symbol_hash Note 1.
+ * 2. The C_SYMBOL never follows or frees the pointer; a C_DICT keeps the
+ *    value of each key here.
+ */
+void c_symbol_set_value (const char *symbol, void *value);
+
+/*
+ * Function  : c_symbol_by_id
+ * Purpose   : returns the symbol with an id
+ * Parameters: pointer to C_SYMBOL
+ *             id
+ * Return    : pointer to symbol, or NULL if the id is out of range or its
+ *             symbol has been removed
+ */
+char *c_symbol_by_id (C_SYMBOL *, int id);
+
+/*
+ * Function  : c_symbol_id_count
+ * Purpose   : returns the number of ids handed out
+ * Parameters: pointer to C_SYMBOL
+ * Return    : one more than the highest id
+ * Notes     :
+ *
+ * 1. Ids are not reused when symbols are removed, so this can be larger
+ *    than c_symbol_size; c_symbol_clear starts the ids over from 0.
+ */
+int c_symbol_id_count (C_SYMBOL *);
+
 /*
  * Function  : c_symbol_remove
  * Purpose   : removes a symbol from a table
@@ -87,6 +264,24 @@ void c_symbol_clear (C_SYMBOL *);
  */
 C_ITERATOR *c_symbol_iterator (C_SYMBOL *);
 
+/*
+ * Function  : c_symbol_reserve
+ * Purpose   : makes room for a number of symbols without rehashing
+ * Parameters: pointer to C_SYMBOL
+ *             number of symbols
+ * Return    : 0 on success; otherwise, out of memory
+ */
+int c_symbol_reserve (C_SYMBOL *, int count);
+
+/*
+ * Function  : c_symbol_shrink_to_fit
+ * Purpose   : shrinks the internal table to suit the current number of
+ *             symbols
+ * Parameters: pointer to C_SYMBOL
+ * Return    : 0 on success; otherwise, out of memory
+ */
+int c_symbol_shrink_to_fit (C_SYMBOL *);
+
 /*
  * Function  : c_symbol_size
  * Purpose   : returns the number of symbols in the table
@@ -95,4 +290,20 @@ C_ITERATOR *c_symbol_iterator (C_SYMBOL *);
  */
 int c_symbol_size (C_SYMBOL *);
 
+/*
+ * Function  : c_symbol_save
+ * Purpose   : writes a symbol table to a file that c_frozen_dict_load (see
+ *             c_dict.h) can map
+ * Parameters: pointer to C_SYMBOL
+ *             path of the file
+ * Return    : 0 on success; otherwise, out of memory or an I/O error
+ * Notes     :
+ *
+ * 1. In the loaded C_FROZEN_DICT every symbol's value is its id (see
+ *    c_symbol_id) in decimal, so c_frozen_dict_find gives back the id a
+ *    string had in the table, and c_frozen_dict_item lists the symbols with
+ *    their ids.
+ * 2. See c_frozen_dict_save.
+ */
+int c_symbol_save (C_SYMBOL *, const char *path);
 #endif
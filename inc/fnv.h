@@ -103,6 +103,9 @@ typedef unsigned long Fnv32_t;
  * determine how 64 bit unsigned values are represented
  */
 /* #include "longlong.h" removed by RHC */
+#if !defined(HAVE_64BIT_LONG_LONG)
+#define HAVE_64BIT_LONG_LONG	/* every compiler we build with has one */
+#endif
 
 
 /*
@@ -14,16 +14,110 @@
  * respect to case, or an unsigned int, use the repectively named convenience
  * functions for the HASH_CALCULATOR and HASH_COMPARATOR arguments to the
  * hash_create function.
+ *
+ * A HASH_STRING key carries its own length, so it needn't be null-terminated
+ * (it can point straight into a network buffer), it is never scanned for its
+ * end, and keys of different lengths compare unequal without looking at
+ * their bytes. Its hash is calculated once and kept in the key; a key whose
+ * string changes must have its hash reset to zero.
+ *
+ * The nocase functions treat ASCII letters without respect to case, folding
+ * a whole vector of bytes per step (with SSE2 or AVX2 when available); other
+ * bytes, including those of multi-byte characters, must match exactly.
+ *
+ * The functions ending in 64 calculate 64-bit hash values, for use with the
+ * 64-bit calculators (C_HASH_CALCULATOR64, C_MAP_CALCULATOR64) of very large
+ * tables, where 32-bit hash values collide too often to be useful.
+ *
+ * By default the hash values are FNV-1, which hashes one byte at a time.
+ * hash_func_select can switch every function here (and so every table
+ * created with the string calculators) to wyhash, which hashes up to 48
+ * bytes per step and mixes all of its bits into the low bits that pick a
+ * table slot; it is several times faster on keys longer than a few bytes.
+ *
+ * Neither FNV-1 nor wyhash protects a table whose keys come from someone
+ * who may want to slow it down: colliding keys can be worked out in advance
+ * and fed to it, turning every lookup into a walk through one long chain.
+ * Tables holding such keys should use a keyed hash instead: hash_func_siphash
+ * with a secret key from hash_func_random_key, as the keyed C_MAP, C_SYMBOL
+ * and C_DICT create functions do with a fresh key for every table.
  */
 
 #include <stdlib.h>
 #include <sys/types.h>
 
+#define HASH_FUNC_FNV 0
+#define HASH_FUNC_WYHASH 1
+
+#define HASH_FUNC_KEY_SIZE 16 // bytes in a hash_func_siphash key
+
+typedef struct HASH_STRING {
+  const char *string; // need not be null-terminated
+  size_t length;
+  unsigned int hash;  // zero until calculated
+} HASH_STRING;
+
+/*
+ * Function  : hash_func_select
+ * Purpose   : selects the hash function used by the functions below
+ * Parameters: HASH_FUNC_FNV (the default) or HASH_FUNC_WYHASH
+ * Return    : the previously selected function
+ * Notes     :
+ *
+ * 1. The selection is process-wide and changes every hash value, so it must
+ *    be made before any table that uses these functions is created, and
+ *    before other threads start hashing.
+ */
+int hash_func_select (int function);
+
+/*
+ * Function  : hash_func_wyhash
+ * Purpose   : calculates a wyhash 64-bit hash value, whatever the selection
+ * Parameters: pointer to value
+ *             length of value in bytes
+ *             seed (or a previous hash value, to accumulate)
+ * Return    : hash value
+ */
+unsigned long long hash_func_wyhash (void *value, size_t length,
+  unsigned long long seed);
+
+/*
+ * Function  : hash_func_siphash
+ * Purpose   : calculates a SipHash-2-4 keyed 64-bit hash value
+ * Parameters: pointer to value
+ *             length of value in bytes
+ *             key (HASH_FUNC_KEY_SIZE bytes)
+ * Return    : hash value
+ * Notes     :
+ *
+ * 1. As long as the key stays secret, keys that collide in a table can't be
+ *    worked out in advance. The hash_func_select selection does not apply.
+ */
+unsigned long long hash_func_siphash (void *value, size_t length,
+  const unsigned char *key);
+
+/*
+ * Function  : hash_func_random_key
+ * Purpose   : fills a hash_func_siphash key with random bytes
+ * Parameters: key (HASH_FUNC_KEY_SIZE bytes)
+ * Return    : none
+ */
+void hash_func_random_key (unsigned char *key);
+
 unsigned int hash_func_calculate (void *value, size_t length);
 unsigned int hash_func_accumulate (void *value, size_t length, unsigned int hash);
+unsigned long long hash_func_calculate64 (void *value, size_t length);
+unsigned long long hash_func_accumulate64 (void *value, size_t length,
+  unsigned long long hash);
 
 int hash_string_comparator (void *s1, void *s2);
 unsigned int hash_string_calculator (void *string);
+unsigned long long hash_string_calculator64 (void *string);
+unsigned long long hash_string_keyed_calculator (void *string,
+  const unsigned char *key);
+
+int hash_length_string_comparator (void *s1, void *s2);
+unsigned int hash_length_string_calculator (void *string);
 
 int hash_nocase_string_comparator (void *s1, void *s2);
 unsigned int hash_nocase_string_calculator (void *string);
@@ -0,0 +1,62 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_allocator.h"
+
+static void *
+_alloc (size_t size, void *context) {
+  return malloc (size);
+}
+
+static void *
+_realloc (void *ptr, size_t size, void *context) {
+  return realloc (ptr, size);
+}
+
+static void
+_free (void *ptr, void *context) {
+  free (ptr);
+}
+
+static C_ALLOCATOR _default = {_alloc, _realloc, _free, NULL};
+
+static __thread C_ALLOCATOR *_current = NULL;
+
+C_ALLOCATOR *
+c_allocator_default (void) {
+  return &_default;
+}
+
+C_ALLOCATOR *
+c_allocator_get (void) {
+  return _current ? _current : &_default;
+}
+
+C_ALLOCATOR *
+c_allocator_set (C_ALLOCATOR *a) {
+  C_ALLOCATOR *previous = c_allocator_get ();
+  _current = a;
+  return previous;
+}
+
+void *
+c_allocator_alloc (C_ALLOCATOR *a, size_t size) {
+  return a -> alloc (size, a -> context);
+}
+
+void *
+c_allocator_calloc (C_ALLOCATOR *a, size_t count, size_t size) {
+  void *ptr = a -> alloc (count * size, a -> context);
+  if (ptr) memset (ptr, 0x00, count * size);
+  return ptr;
+}
+
+void *
+c_allocator_realloc (C_ALLOCATOR *a, void *ptr, size_t size) {
+  return a -> realloc (ptr, size, a -> context);
+}
+
+void
+c_allocator_free (C_ALLOCATOR *a, void *ptr) {
+  if (ptr) a -> free (ptr, a -> context);
+}
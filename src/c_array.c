@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include "c_allocator.h"
 #include "c_array.h"
 
 struct C_ARRAY {
@@ -13,6 +14,8 @@ struct C_ARRAY {
 
     int current;
     C_ITERATOR *iterator;
+
+    C_ALLOCATOR *allocator;
 };
 
 #define C_ARRAY_INITIAL_BUFFER_LENGTH 16
@@ -54,17 +57,20 @@ _itr_remove (void *ctx) {
 C_ARRAY *
 c_array_create_base (size_t element_size, int initial, int is_linear, int factor) {
   C_ARRAY *a;
+  C_ALLOCATOR *allocator = c_allocator_get ();
 
-  a = (C_ARRAY *) malloc (sizeof (C_ARRAY));
+  a = (C_ARRAY *) c_allocator_alloc (allocator, sizeof (C_ARRAY));
   if (a) {
     memset (a, 0x00, sizeof (C_ARRAY));
+    a -> allocator = allocator;
     a -> element_size = element_size;
     a -> is_linear = is_linear;
     a -> factor = factor;
     a -> buffer_length = initial;
-    a -> buffer = (char *) malloc (element_size * a -> buffer_length);
+    a -> buffer = (char *) c_allocator_alloc (allocator,
+      element_size * a -> buffer_length);
     if (!a -> buffer) {
-      free (a);
+      c_allocator_free (allocator, a);
       a = NULL;
     }
   }
@@ -80,8 +86,9 @@ c_array_create (size_t element_size) {
 void
 c_array_free (C_ARRAY *a) {
   if (a) {
-    free (a -> buffer);
-    free (a);
+    c_iterator_free (a -> iterator);
+    c_allocator_free (a -> allocator, a -> buffer);
+    c_allocator_free (a -> allocator, a);
   }
 }
 
@@ -97,7 +104,8 @@ c_array_require (C_ARRAY *a, int required) {
     }
     if (required > length) length = required;
 
-    void *new_buffer = realloc (a -> buffer, length * a -> element_size);
+    void *new_buffer = c_allocator_realloc (a -> allocator, a -> buffer,
+      length * a -> element_size);
     if (!new_buffer) return 1; // fubar
 
     a -> buffer_length = length;
@@ -118,6 +126,76 @@ c_array_append (C_ARRAY *a, void *item) {
   return 0;
 }
 
+int
+c_array_append_n (C_ARRAY *a, void *items, int count) {
+
+  if (count < 0 || c_array_require (a, a -> length + count)) return 1;
+
+  memcpy (a -> buffer + a -> length * a -> element_size, items,
+    count * a -> element_size);
+  a -> length += count;
+
+  return 0;
+}
+
+int
+c_array_insert_at (C_ARRAY *a, int index, void *items, int count) {
+
+  if (index < 0) index += a -> length;
+  if (index < 0 || index > a -> length || count < 0) return 1;
+  if (c_array_require (a, a -> length + count)) return 1;
+
+  memmove (a -> buffer + (index + count) * a -> element_size,
+    a -> buffer + index * a -> element_size,
+    (a -> length - index) * a -> element_size);
+  memcpy (a -> buffer + index * a -> element_size, items,
+    count * a -> element_size);
+  a -> length += count;
+
+  return 0;
+}
+
+int
+c_array_erase_range (C_ARRAY *a, int index, int count) {
+
+  if (index < 0) index += a -> length;
+  if (index < 0 || count < 0 || count > a -> length - index) return 1;
+
+  memmove (a -> buffer + index * a -> element_size,
+    a -> buffer + (index + count) * a -> element_size,
+    (a -> length - index - count) * a -> element_size);
+  a -> length -= count;
+
+  return 0;
+}
+
+/*
+ * kept elements are moved down a run at a time, so there is one memmove per
+ * run of kept elements rather than one per removed element
+ */
+int
+c_array_remove_if (C_ARRAY *a, C_ARRAY_PREDICATE predicate, void *context) {
+  size_t size = a -> element_size;
+  int kept = 0, run = 0, i;
+
+  for (i = 0; i < a -> length; i ++) {
+    if (!predicate (a -> buffer + i * size, context)) continue;
+    if (i > run && kept < run)
+      memmove (a -> buffer + kept * size, a -> buffer + run * size,
+        (i - run) * size);
+    kept += i - run;
+    run = i + 1;
+  }
+  if (a -> length > run && kept < run)
+    memmove (a -> buffer + kept * size, a -> buffer + run * size,
+      (a -> length - run) * size);
+  kept += a -> length - run;
+
+  i = a -> length - kept;
+  a -> length = kept;
+  return i;
+}
+
 void
 c_array_clear (C_ARRAY *a) {
     a -> length = 0;
@@ -154,11 +232,358 @@ c_array_length (C_ARRAY *a) {
   return a -> length;
 }
 
+/*
+ * sorting and searching
+ */
+
+#define C_ARRAY_SORT_RUN 16     // merge sort: insertion sorted run length
+#define C_ARRAY_RADIX_MINIMUM 64 // c_array_sort_key: shorter is insertion sorted
+
+typedef struct _KEYED {
+  unsigned long long key; // ordered as unsigned, see _key
+  int index;
+} _KEYED;
+
+static void
+_swap (char *p1, char *p2, size_t size) {
+  while (size --) {
+    char c = *p1;
+    *p1 ++ = *p2;
+    *p2 ++ = c;
+  }
+}
+
+/* insertion sorts n elements, using one element of scratch */
+static void
+_insertion (char *base, int n, size_t size, C_ARRAY_COMPARATOR cmp,
+    char *scratch) {
+  int i, j;
+
+  for (i = 1; i < n; i ++) {
+    if (cmp (base + (i - 1) * size, base + i * size) <= 0) continue;
+    memcpy (scratch, base + i * size, size);
+    for (j = i - 1; j > 0 && cmp (base + (j - 1) * size, scratch) > 0; j --) ;
+    memmove (base + (j + 1) * size, base + j * size, (i - j) * size);
+    memcpy (base + j * size, scratch, size);
+  }
+}
+
+static void
+_merge (char *from, char *to, int low, int middle, int high, size_t size,
+    C_ARRAY_COMPARATOR cmp) {
+  int i = low, j = middle, k = low;
+
+  while (i < middle && j < high) {
+    if (cmp (from + j * size, from + i * size) < 0) {
+      memcpy (to + k ++ * size, from + j ++ * size, size);
+    } else {
+      memcpy (to + k ++ * size, from + i ++ * size, size);
+    }
+  }
+  memcpy (to + k * size, from + i * size, (middle - i) * size);
+  k += middle - i;
+  memcpy (to + k * size, from + j * size, (high - j) * size);
+}
+
+void
+c_array_sort (C_ARRAY *a, C_ARRAY_COMPARATOR cmp) {
+  qsort (a -> buffer, a -> length, a -> element_size, cmp);
+}
+
+int
+c_array_stable_sort (C_ARRAY *a, C_ARRAY_COMPARATOR cmp) {
+  size_t size = a -> element_size;
+  int n = a -> length;
+  char *from = a -> buffer, *to, *other;
+  int width, low;
+
+  other = (char *) c_allocator_alloc (a -> allocator, (n + 1) * size);
+  if (!other) return 1;
+
+  for (low = 0; low < n; low += C_ARRAY_SORT_RUN)
+    _insertion (from + low * size,
+      n - low < C_ARRAY_SORT_RUN ? n - low : C_ARRAY_SORT_RUN, size, cmp,
+      other + n * size);
+
+  to = other;
+  for (width = C_ARRAY_SORT_RUN; width < n; width *= 2) {
+    char *swap;
+    for (low = 0; low < n; low += 2 * width) {
+      int middle = low + width < n ? low + width : n;
+      int high = low + 2 * width < n ? low + 2 * width : n;
+      _merge (from, to, low, middle, high, size, cmp);
+    }
+    swap = from;
+    from = to;
+    to = swap;
+  }
+  if (from != a -> buffer) memcpy (a -> buffer, from, n * size);
+
+  c_allocator_free (a -> allocator, other);
+  return 0;
+}
+
+/*
+ * Hoare's selection (as in Wirth's "find"): partition around the median of
+ * three until the partition holding the index is one element
+ */
+int
+c_array_nth_element (C_ARRAY *a, int index, C_ARRAY_COMPARATOR cmp) {
+  size_t size = a -> element_size;
+  char *base = a -> buffer, *pivot;
+  int low = 0, high = a -> length - 1;
+
+  if (index < 0 || index >= a -> length) return 1;
+  pivot = (char *) c_allocator_alloc (a -> allocator, size);
+  if (!pivot) return 1;
+
+  while (low < high) {
+    char *p1 = base + low * size;
+    char *p2 = base + (low + (high - low) / 2) * size;
+    char *p3 = base + high * size;
+    char *median;
+    int i = low, j = high;
+
+    if (cmp (p1, p2) < 0) {
+      median = cmp (p2, p3) < 0 ? p2 : cmp (p1, p3) < 0 ? p3 : p1;
+    } else {
+      median = cmp (p1, p3) < 0 ? p1 : cmp (p2, p3) < 0 ? p3 : p2;
+    }
+    memcpy (pivot, median, size);
+
+    do {
+      while (cmp (base + i * size, pivot) < 0) i ++;
+      while (cmp (pivot, base + j * size) < 0) j --;
+      if (i <= j) {
+        if (i < j) _swap (base + i * size, base + j * size, size);
+        i ++;
+        j --;
+      }
+    } while (i <= j);
+
+    if (j < index) low = i;
+    if (index < i) high = j;
+  }
+
+  c_allocator_free (a -> allocator, pivot);
+  return 0;
+}
+
+int
+c_array_partial_sort (C_ARRAY *a, int count, C_ARRAY_COMPARATOR cmp) {
+  if (count <= 0) return 0;
+  if (count < a -> length && c_array_nth_element (a, count, cmp)) return 1;
+  qsort (a -> buffer, count < a -> length ? count : a -> length,
+    a -> element_size, cmp);
+  return 0;
+}
+
+int
+c_array_lower_bound (C_ARRAY *a, void *key, C_ARRAY_COMPARATOR cmp) {
+  int low = 0, high = a -> length;
+
+  while (low < high) {
+    int middle = low + (high - low) / 2;
+    if (cmp (a -> buffer + middle * a -> element_size, key) < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return low;
+}
+
+int
+c_array_upper_bound (C_ARRAY *a, void *key, C_ARRAY_COMPARATOR cmp) {
+  int low = 0, high = a -> length;
+
+  while (low < high) {
+    int middle = low + (high - low) / 2;
+    if (cmp (key, a -> buffer + middle * a -> element_size) < 0) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+
+  return low;
+}
+
+int
+c_array_bsearch (C_ARRAY *a, void *key, C_ARRAY_COMPARATOR cmp) {
+  int index = c_array_lower_bound (a, key, cmp);
+  if (index < a -> length &&
+      0 == cmp (a -> buffer + index * a -> element_size, key)) return index;
+  return -1;
+}
+
+static size_t
+_key_width (int type) {
+  switch (type) {
+    case C_ARRAY_KEY_INT32:
+    case C_ARRAY_KEY_UINT32:
+    case C_ARRAY_KEY_FLOAT:
+      return 4;
+    case C_ARRAY_KEY_INT64:
+    case C_ARRAY_KEY_UINT64:
+    case C_ARRAY_KEY_DOUBLE:
+      return 8;
+  }
+  return 0;
+}
+
+/*
+ * maps a key to an unsigned value in the same order: signed keys have
+ * their sign bit flipped, and negative floating point keys all their bits
+ */
+static unsigned long long
+_key (int type, const void *p) {
+  unsigned long long u64;
+  unsigned int u32;
+
+  if (4 == _key_width (type)) {
+    memcpy (&u32, p, sizeof (u32));
+    if (C_ARRAY_KEY_INT32 == type) u32 ^= 0x80000000U;
+    if (C_ARRAY_KEY_FLOAT == type)
+      u32 = u32 & 0x80000000U ? ~u32 : u32 | 0x80000000U;
+    return u32;
+  }
+
+  memcpy (&u64, p, sizeof (u64));
+  if (C_ARRAY_KEY_INT64 == type) u64 ^= 0x8000000000000000ULL;
+  if (C_ARRAY_KEY_DOUBLE == type)
+    u64 = u64 & 0x8000000000000000ULL ? ~u64 : u64 | 0x8000000000000000ULL;
+  return u64;
+}
+
+/*
+ * LSD radix sort, a byte at a time, skipping bytes all the keys share;
+ * returns whichever of the two arrays ends up sorted
+ */
+static _KEYED *
+_radix (_KEYED *keyed, _KEYED *other, int n) {
+  int count [8][256];
+  int byte, i;
+
+  memset (count, 0x00, sizeof (count));
+  for (i = 0; i < n; i ++)
+    for (byte = 0; byte < 8; byte ++)
+      count [byte][(keyed [i].key >> (8 * byte)) & 0xff] ++;
+
+  for (byte = 0; byte < 8; byte ++) {
+    int shift = 8 * byte, total = 0, digit;
+    _KEYED *swap;
+
+    if (n == count [byte][(keyed [0].key >> shift) & 0xff]) continue;
+    for (digit = 0; digit < 256; digit ++) {
+      int c = count [byte][digit];
+      count [byte][digit] = total;
+      total += c;
+    }
+    for (i = 0; i < n; i ++)
+      other [count [byte][(keyed [i].key >> shift) & 0xff] ++] = keyed [i];
+    swap = keyed;
+    keyed = other;
+    other = swap;
+  }
+
+  return keyed;
+}
+
+int
+c_array_sort_key (C_ARRAY *a, int type, size_t offset) {
+  size_t size = a -> element_size, width = _key_width (type);
+  int n = a -> length, i, j;
+  _KEYED *keyed, *sorted;
+  char *buffer;
+
+  if (!width || offset + width > size) return 1;
+  if (n < 2) return 0;
+
+  keyed = (_KEYED *) c_allocator_alloc (a -> allocator, 2 * n * sizeof (_KEYED));
+  buffer = (char *) c_allocator_alloc (a -> allocator, a -> buffer_length * size);
+  if (!keyed || !buffer) {
+    c_allocator_free (a -> allocator, keyed);
+    c_allocator_free (a -> allocator, buffer);
+    return 1;
+  }
+
+  for (i = 0; i < n; i ++) {
+    keyed [i].key = _key (type, a -> buffer + i * size + offset);
+    keyed [i].index = i;
+  }
+
+  if (n < C_ARRAY_RADIX_MINIMUM) {
+    for (i = 1; i < n; i ++) {
+      _KEYED k = keyed [i];
+      for (j = i; j > 0 && keyed [j - 1].key > k.key; j --)
+        keyed [j] = keyed [j - 1];
+      keyed [j] = k;
+    }
+    sorted = keyed;
+  } else {
+    sorted = _radix (keyed, keyed + n, n);
+  }
+
+  /* the elements move once, into a new buffer */
+  for (i = 0; i < n; i ++)
+    memcpy (buffer + i * size, a -> buffer + sorted [i].index * size, size);
+  c_allocator_free (a -> allocator, a -> buffer);
+  a -> buffer = buffer;
+
+  c_allocator_free (a -> allocator, keyed);
+  return 0;
+}
+
+int
+c_array_lower_bound_key (C_ARRAY *a, int type, size_t offset, void *value) {
+  size_t width = _key_width (type);
+  unsigned long long key;
+  int low = 0, high = a -> length;
+
+  if (!width || offset + width > a -> element_size) return -1;
+
+  key = _key (type, value);
+  while (low < high) {
+    int middle = low + (high - low) / 2;
+    if (_key (type, a -> buffer + middle * a -> element_size + offset) < key) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return low;
+}
+
+int
+c_array_upper_bound_key (C_ARRAY *a, int type, size_t offset, void *value) {
+  size_t width = _key_width (type);
+  unsigned long long key;
+  int low = 0, high = a -> length;
+
+  if (!width || offset + width > a -> element_size) return -1;
+
+  key = _key (type, value);
+  while (low < high) {
+    int middle = low + (high - low) / 2;
+    if (key < _key (type, a -> buffer + middle * a -> element_size + offset)) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+
+  return low;
+}
+
 C_ITERATOR *
 c_array_iterator (C_ARRAY *a) {
     if (a -> iterator) {
         c_iterator_reset (a -> iterator);
     } else {
+        C_ALLOCATOR *previous = c_allocator_set (a -> allocator);
         a -> iterator = c_iterator_create (
             _itr_init,
             _itr_advance,
@@ -167,6 +592,7 @@ c_array_iterator (C_ARRAY *a) {
             0,
             (void *) a
         );
+        c_allocator_set (previous);
     }
     return a -> iterator;
 }
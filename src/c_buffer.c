@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include "c_allocator.h"
 #include "c_buffer.h"
 
 struct C_BUFFER {
@@ -9,6 +10,7 @@ struct C_BUFFER {
   int buffer_length;
   int length;
   char *buffer;
+  C_ALLOCATOR *allocator;
 };
 
 #define C_BUFFER_INITIAL_BUFFER_LENGTH 16
@@ -16,16 +18,18 @@ struct C_BUFFER {
 C_BUFFER *
 c_buffer_create_base (int initial, int is_linear, int factor) {
   C_BUFFER *b;
+  C_ALLOCATOR *allocator = c_allocator_get ();
 
-  b = (C_BUFFER *) malloc (sizeof (C_BUFFER));
+  b = (C_BUFFER *) c_allocator_alloc (allocator, sizeof (C_BUFFER));
   if (b) {
     memset (b, 0x00, sizeof (C_BUFFER));
+    b -> allocator = allocator;
     b -> is_linear = is_linear;
     b -> factor = factor;
     b -> buffer_length = initial;
-    b -> buffer = (char *) malloc (b -> buffer_length);
+    b -> buffer = (char *) c_allocator_alloc (allocator, b -> buffer_length);
     if (!b -> buffer) {
-      free (b);
+      c_allocator_free (allocator, b);
       b = NULL;
     }
   }
@@ -41,8 +45,8 @@ c_buffer_create (void) {
 void
 c_buffer_free (C_BUFFER *b) {
   if (b) {
-    free (b -> buffer);
-    free (b);
+    c_allocator_free (b -> allocator, b -> buffer);
+    c_allocator_free (b -> allocator, b);
   }
 }
 
@@ -58,7 +62,8 @@ c_buffer_require (C_BUFFER *b, int required) {
     }
     if (required > length) length = required;
 
-    char *new_buffer = (char *) realloc (b -> buffer, length);
+    char *new_buffer = (char *) c_allocator_realloc (b -> allocator,
+      b -> buffer, length);
     if (!new_buffer) return 1; // fubar
 
     b -> buffer_length = length;
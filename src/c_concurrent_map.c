@@ -0,0 +1,274 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_allocator.h"
+#include "c_concurrent_map.h"
+#include "c_hash.h"
+#include "hash_func.h"
+
+#define C_CONCURRENT_MAP_SHARDS 16
+#define C_CONCURRENT_MAP_LINE 64 // shards are padded to a cache line
+
+/*
+ * a shard's table holds each pair with its key's hash, so a key is hashed
+ * once per call, both to pick the shard and to probe the shard's table
+ */
+typedef struct _ENTRY {
+  void *key;
+  void *value;
+  unsigned int hash;
+} _ENTRY;
+
+typedef struct _SHARD {
+  pthread_rwlock_t lock;
+  C_HASH *table;
+  char pad [(C_CONCURRENT_MAP_LINE -
+    (sizeof (pthread_rwlock_t) + sizeof (C_HASH *)) % C_CONCURRENT_MAP_LINE) %
+    C_CONCURRENT_MAP_LINE];
+} _SHARD;
+
+struct C_CONCURRENT_MAP {
+  C_ALLOCATOR *allocator;
+  C_MAP_CALCULATOR calculator;
+  C_MAP_COMPARATOR comparator;
+  C_MAP_GARBAGE garbage;
+  _SHARD *shards;
+  int shard_count;
+  int shard_shift; // 32 - log2 (shard_count)
+};
+
+static unsigned int
+_calc (void *item, void *context) {
+  return ((_ENTRY *) item) -> hash;
+}
+
+static int
+_compare (void *item1, void *item2, void *context) {
+  C_CONCURRENT_MAP *cm = (C_CONCURRENT_MAP *) context;
+  return cm -> comparator (((_ENTRY *) item1) -> key,
+    ((_ENTRY *) item2) -> key);
+}
+
+static void
+_garbage (void *item, void *context) {
+  C_CONCURRENT_MAP *cm = (C_CONCURRENT_MAP *) context;
+  _ENTRY *e = (_ENTRY *) item;
+  if (cm -> garbage) cm -> garbage (e -> key, e -> value);
+}
+
+/*
+ * the shard comes from the top bits of a multiplicative mix, leaving the low
+ * bits (which pick the bucket inside the shard's table) independent of it
+ */
+static _SHARD *
+_shard (C_CONCURRENT_MAP *cm, _ENTRY *e, void *key, void *value) {
+  e -> key = key;
+  e -> value = value;
+  e -> hash = cm -> calculator (key);
+  if (1 == cm -> shard_count) return cm -> shards;
+  return cm -> shards + ((e -> hash * 0x9e3779b9u) >> cm -> shard_shift);
+}
+
+C_CONCURRENT_MAP *
+c_concurrent_map_create (C_MAP_CALCULATOR cal, C_MAP_COMPARATOR com,
+    C_MAP_GARBAGE garbage, int shards) {
+  int count = 1, shift = 32, i;
+
+  if (shards <= 0) shards = C_CONCURRENT_MAP_SHARDS;
+  while (count < shards) {
+    count *= 2;
+    shift -= 1;
+  }
+
+  C_ALLOCATOR *allocator = c_allocator_get ();
+  C_CONCURRENT_MAP *cm = (C_CONCURRENT_MAP *) c_allocator_alloc (allocator,
+    sizeof (C_CONCURRENT_MAP));
+  if (cm) {
+    memset (cm, 0x00, sizeof (C_CONCURRENT_MAP));
+    cm -> allocator = allocator;
+    cm -> calculator = cal;
+    cm -> comparator = com;
+    cm -> garbage = garbage;
+    cm -> shard_count = count;
+    cm -> shard_shift = shift;
+    cm -> shards = (_SHARD *) c_allocator_calloc (allocator, count,
+      sizeof (_SHARD));
+    if (!cm -> shards) {
+      c_allocator_free (allocator, cm);
+      return NULL;
+    }
+    for (i = 0; i < count; i ++) {
+      _SHARD *s = cm -> shards + i;
+      s -> table = c_hash_create_base (sizeof (_ENTRY), _calc, _compare,
+        _garbage, (void *) cm, 0, C_HASH_CHAINED);
+      if (!s -> table) {
+        while (i --) {
+          pthread_rwlock_destroy (&cm -> shards [i].lock);
+          c_hash_free (cm -> shards [i].table);
+        }
+        c_allocator_free (allocator, cm -> shards);
+        c_allocator_free (allocator, cm);
+        return NULL;
+      }
+      pthread_rwlock_init (&s -> lock, NULL);
+    }
+  }
+
+  return cm;
+}
+
+C_CONCURRENT_MAP *
+c_concurrent_map_dict_create (C_MAP_GARBAGE garbage, int shards) {
+  return c_concurrent_map_create (hash_string_calculator,
+    hash_string_comparator, garbage, shards);
+}
+
+void
+c_concurrent_map_free (C_CONCURRENT_MAP *cm) {
+  int i;
+
+  if (cm) {
+    for (i = 0; i < cm -> shard_count; i ++) {
+      pthread_rwlock_destroy (&cm -> shards [i].lock);
+      c_hash_free (cm -> shards [i].table);
+    }
+    c_allocator_free (cm -> allocator, cm -> shards);
+    c_allocator_free (cm -> allocator, cm);
+  }
+}
+
+void
+c_concurrent_map_clear (C_CONCURRENT_MAP *cm) {
+  int i;
+
+  for (i = 0; i < cm -> shard_count; i ++) {
+    _SHARD *s = cm -> shards + i;
+    pthread_rwlock_wrlock (&s -> lock);
+    c_hash_clear (s -> table);
+    pthread_rwlock_unlock (&s -> lock);
+  }
+}
+
+int
+c_concurrent_map_insert (C_CONCURRENT_MAP *cm, void *key, void *value) {
+  _ENTRY e;
+  _SHARD *s = _shard (cm, &e, key, value);
+  int rc;
+
+  pthread_rwlock_wrlock (&s -> lock);
+  rc = c_hash_insert (s -> table, &e);
+  pthread_rwlock_unlock (&s -> lock);
+
+  if (C_HASH_ERROR_DUPLICATE == rc) return C_CONCURRENT_MAP_ERROR_DUPLICATE;
+  return rc ? C_CONCURRENT_MAP_ERROR_MEMORY : 0;
+}
+
+/*
+ * as c_map_add: a present key keeps its entry and takes the new value
+ */
+int
+c_concurrent_map_add (C_CONCURRENT_MAP *cm, void *key, void *value) {
+  _ENTRY e, *found;
+  _SHARD *s = _shard (cm, &e, key, value);
+  int rc = 0;
+
+  pthread_rwlock_wrlock (&s -> lock);
+  found = (_ENTRY *) c_hash_find (s -> table, &e);
+  if (found) {
+    if (cm -> garbage) {
+      if (found -> key != key) cm -> garbage (key, NULL);
+      if (found -> value != value) cm -> garbage (NULL, found -> value);
+    }
+    found -> value = value;
+  } else if (c_hash_insert (s -> table, &e)) {
+    rc = C_CONCURRENT_MAP_ERROR_MEMORY;
+  }
+  pthread_rwlock_unlock (&s -> lock);
+
+  return rc;
+}
+
+void *
+c_concurrent_map_find (C_CONCURRENT_MAP *cm, void *key) {
+  _ENTRY e, *found;
+  _SHARD *s = _shard (cm, &e, key, NULL);
+  void *value;
+
+  pthread_rwlock_rdlock (&s -> lock);
+  found = (_ENTRY *) c_hash_find (s -> table, &e);
+  value = found ? found -> value : NULL;
+  pthread_rwlock_unlock (&s -> lock);
+
+  return value;
+}
+
+int
+c_concurrent_map_exists (C_CONCURRENT_MAP *cm, void *key) {
+  _ENTRY e;
+  _SHARD *s = _shard (cm, &e, key, NULL);
+  int exists;
+
+  pthread_rwlock_rdlock (&s -> lock);
+  exists = NULL != c_hash_find (s -> table, &e);
+  pthread_rwlock_unlock (&s -> lock);
+
+  return exists;
+}
+
+void
+c_concurrent_map_remove (C_CONCURRENT_MAP *cm, void *key) {
+  _ENTRY e;
+  _SHARD *s = _shard (cm, &e, key, NULL);
+
+  pthread_rwlock_wrlock (&s -> lock);
+  c_hash_remove (s -> table, &e);
+  pthread_rwlock_unlock (&s -> lock);
+}
+
+typedef struct _VISIT {
+  C_CONCURRENT_MAP_VISITOR visit;
+  void *context;
+} _VISIT;
+
+static int
+_visit_entry (void *item, void *context) {
+  _VISIT *v = (_VISIT *) context;
+  _ENTRY *e = (_ENTRY *) item;
+  return v -> visit (e -> key, e -> value, v -> context);
+}
+
+int
+c_concurrent_map_foreach (C_CONCURRENT_MAP *cm,
+    C_CONCURRENT_MAP_VISITOR visit, void *context) {
+  _VISIT v = { visit, context };
+  int i, rc = 0;
+
+  for (i = 0; 0 == rc && i < cm -> shard_count; i ++) {
+    _SHARD *s = cm -> shards + i;
+    pthread_rwlock_rdlock (&s -> lock); // a walk writes nothing to the table
+    rc = c_hash_walk (s -> table, _visit_entry, &v);
+    pthread_rwlock_unlock (&s -> lock);
+  }
+
+  return rc;
+}
+
+int
+c_concurrent_map_size (C_CONCURRENT_MAP *cm) {
+  int i, size = 0;
+
+  for (i = 0; i < cm -> shard_count; i ++) {
+    _SHARD *s = cm -> shards + i;
+    pthread_rwlock_rdlock (&s -> lock);
+    size += c_hash_size (s -> table);
+    pthread_rwlock_unlock (&s -> lock);
+  }
+
+  return size;
+}
+
+int
+c_concurrent_map_shards (C_CONCURRENT_MAP *cm) {
+  return cm -> shard_count;
+}
@@ -1,29 +1,111 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
+#include "c_allocator.h"
 #include "c_map.h"
+#include "c_mph.h"
 #include "c_symbol.h"
 #include "c_dict.h"
+#include "hash_func.h"
 
 struct C_DICT {
+  C_ALLOCATOR *allocator;
   C_SYMBOL *symbols;
   C_MAP *dict;
+  int keyed;
 };
 
-C_DICT *
-c_dict_create (void) {
+/*
+ * a C_FROZEN_DICT copies every key and value into one block of strings and
+ * keeps its pairs in c_mph_find order; entries hold offsets into the block
+ * rather than pointers, so that the whole thing can be saved to a file and
+ * used straight from a mapping of it
+ */
+typedef struct _FROZEN {
+  unsigned long long hash;
+  unsigned long long key;
+  unsigned long long value;
+  unsigned long long length; // of the key
+} _FROZEN;
+
+struct C_FROZEN_DICT {
+  C_ALLOCATOR *allocator;
+  int keyed;
+  unsigned char seed [HASH_FUNC_KEY_SIZE];
+  C_MPH *mph;
+  _FROZEN *entries;
+  char *strings;
+  size_t strings_size;
+  int size;
+  void *mapping;       // c_frozen_dict_load
+  size_t mapping_size;
+};
+
+/*
+ * a saved C_FROZEN_DICT is this header, the entries, the strings (padded to
+ * a multiple of 8 bytes) and the c_mph_image, all in the machine's own byte
+ * order; the order field tells if the file was written on a machine with
+ * another one
+ */
+typedef struct _FILE_HEADER {
+  char magic [8];
+  unsigned int order;
+  unsigned int keyed;
+  unsigned char seed [HASH_FUNC_KEY_SIZE];
+  unsigned long long size;
+  unsigned long long entries;      // offsets in the file
+  unsigned long long strings;
+  unsigned long long strings_size;
+  unsigned long long mph;
+  unsigned long long mph_size;
+} _FILE_HEADER;
+
+#define C_DICT_FILE_MAGIC "C_DICT\0\1"
+#define C_DICT_FILE_ORDER 0x01020304
+
+/*
+ * each key's value is also kept with the key's symbol, so that a find is a
+ * single probe of the symbol table; whatever takes a pair out of the map
+ * (c_dict_remove, c_iterator_remove, clear and free) clears it there too
+ */
+static void
+_c_dict_garbage (void *key, void *value) {
+  if (key) c_symbol_set_value ((char *) key, NULL);
+}
 
-  C_DICT *d = (C_DICT *) malloc (sizeof (C_DICT));
+/*
+ * room for the strings of a number of pairs, which can be twice as many
+ */
+static int
+_c_dict_strings (int pairs) {
+  return pairs > INT_MAX / 2 ? INT_MAX : pairs * 2;
+}
+
+static C_DICT *
+_c_dict_create (int expected, int keyed) {
+
+  C_ALLOCATOR *allocator = c_allocator_get ();
+  C_DICT *d = (C_DICT *) c_allocator_alloc (allocator, sizeof (C_DICT));
   if (d) {
     memset (d, 0x00, sizeof (C_DICT));
-    d -> symbols = c_symbol_create ();
+    d -> allocator = allocator;
+    d -> keyed = keyed;
+    d -> symbols = keyed ? c_symbol_create_keyed (_c_dict_strings (expected)) :
+      c_symbol_create_size (_c_dict_strings (expected));
     if (!d -> symbols) {
-      free (d);
+      c_allocator_free (allocator, d);
       d = NULL;
     } else {
-      d -> dict = c_map_dict_create (NULL);
+      d -> dict = c_map_symbol_create (_c_dict_garbage, expected);
       if (!d -> dict) {
         c_symbol_free (d -> symbols);
+        c_allocator_free (allocator, d);
         d = NULL;
       }
     }
@@ -32,19 +114,48 @@ c_dict_create (void) {
   return d;
 }
 
+C_DICT *
+c_dict_create_size (int expected) {
+  return _c_dict_create (expected, 0);
+}
+
+C_DICT *
+c_dict_create_keyed (int expected) {
+  return _c_dict_create (expected, 1);
+}
+
+C_DICT *
+c_dict_create (void) {
+  return c_dict_create_size (0);
+}
+
 void
 c_dict_free (C_DICT *d) {
   if (d) {
+    c_map_free (d -> dict); // before the symbols its garbage writes to
     c_symbol_free (d -> symbols);
-    c_map_free (d -> dict);
-    free (d);
+    c_allocator_free (d -> allocator, d);
   }
 }
 
 void
 c_dict_clear (C_DICT *d) {
-  c_symbol_clear (d -> symbols);
   c_map_clear (d -> dict);
+  c_symbol_clear (d -> symbols);
+}
+
+/*
+ * the map hashes and compares its keys as symbols, so it must never see
+ * NULL from a failed c_symbol_add
+ */
+static int
+_c_dict_add (C_DICT *d, char *key, char *value) {
+  int result;
+
+  if (NULL == key || NULL == value) return -5;
+  result = c_map_add (d -> dict, key, value);
+  if (0 == result) c_symbol_set_value (key, value);
+  return result;
 }
 
 int
@@ -52,23 +163,59 @@ c_dict_add (C_DICT *d, char *key, char *value) {
 
   if (NULL == key) return -1;
   if (NULL == value) return -2;
-  if (0 == strlen (key)) return -3;
-  if (0 == strlen (value)) return -4;
+  if (0x00 == key [0]) return -3;
+  if (0x00 == value [0]) return -4;
 
-  return c_map_add (d -> dict,
+  return _c_dict_add (d,
     c_symbol_add (d -> symbols, key),
     c_symbol_add (d -> symbols, value)
   );
 }
 
+int
+c_dict_add_n (C_DICT *d, const char *key, size_t key_length,
+    const char *value, size_t value_length) {
+
+  if (NULL == key) return -1;
+  if (NULL == value) return -2;
+  if (0 == key_length) return -3;
+  if (0 == value_length) return -4;
+
+  return _c_dict_add (d,
+    c_symbol_add_n (d -> symbols, key, key_length),
+    c_symbol_add_n (d -> symbols, value, value_length)
+  );
+}
+
+/*
+ * every key in the map is a symbol, so a key that isn't one can't be there;
+ * once the symbol is found, its value is stored with it
+ */
 char *
 c_dict_find (C_DICT *d, char *key) {
-  return (char *) c_map_find (d -> dict, key);
+  return c_dict_find_n (d, key, strlen (key));
+}
+
+char *
+c_dict_find_n (C_DICT *d, const char *key, size_t length) {
+  char *symbol = c_symbol_find_n (d -> symbols, key, length);
+  return symbol ? (char *) c_symbol_value (symbol) : NULL;
+}
+
+char *
+c_dict_find_symbol (C_DICT *d, const char *symbol) {
+  return (char *) c_symbol_value (symbol);
+}
+
+const char *
+c_dict_key (C_DICT *d, const char *key, size_t length) {
+  return c_symbol_find_n (d -> symbols, key, length);
 }
 
 void
 c_dict_remove (C_DICT *d, char *key) {
-  c_map_remove (d -> dict, key);
+  char *symbol = c_symbol_find (d -> symbols, key);
+  if (symbol) c_map_remove (d -> dict, symbol);
 }
 
 C_ITERATOR *
@@ -76,7 +223,327 @@ c_dict_iterator (C_DICT *d) {
   return c_map_iterator (d -> dict);
 }
 
+int
+c_dict_reserve (C_DICT *d, int count) {
+  if (c_symbol_reserve (d -> symbols, _c_dict_strings (count))) return -1;
+  return c_map_reserve (d -> dict, count);
+}
+
+int
+c_dict_shrink_to_fit (C_DICT *d) {
+  if (c_symbol_shrink_to_fit (d -> symbols)) return -1;
+  return c_map_shrink_to_fit (d -> dict);
+}
+
 int
 c_dict_size (C_DICT *d) {
   return c_map_size (d -> dict);
 }
+
+static unsigned long long
+_frozen_hash (C_FROZEN_DICT *f, const char *key, size_t length) {
+  if (f -> keyed) return hash_func_siphash ((void *) key, length, f -> seed);
+  return hash_func_wyhash ((void *) key, length, 0);
+}
+
+C_FROZEN_DICT *
+c_frozen_dict_create (const char **keys, const size_t *key_lengths,
+    const char **values, const size_t *value_lengths, int count, int keyed) {
+
+  C_ALLOCATOR *allocator = c_allocator_get ();
+  C_FROZEN_DICT *f;
+  unsigned long long *hashes;
+  int *order;
+  size_t bytes = 0, key_length, value_length;
+  char *next;
+  int i, j;
+
+  f = (C_FROZEN_DICT *) c_allocator_alloc (allocator, sizeof (C_FROZEN_DICT));
+  if (!f) return NULL;
+  memset (f, 0x00, sizeof (C_FROZEN_DICT));
+  f -> allocator = allocator;
+  f -> keyed = keyed;
+  if (keyed) hash_func_random_key (f -> seed);
+  f -> size = count;
+
+  hashes = (unsigned long long *) c_allocator_alloc (allocator,
+    (count + 1) * sizeof (unsigned long long));
+  order = (int *) c_allocator_alloc (allocator, (count + 1) * sizeof (int));
+  f -> entries = (_FROZEN *) c_allocator_alloc (allocator,
+    (count + 1) * sizeof (_FROZEN));
+
+  if (hashes && order && f -> entries) {
+    for (i = 0; i < count; i ++) {
+      key_length = key_lengths ? key_lengths [i] : strlen (keys [i]);
+      value_length = value_lengths ? value_lengths [i] : strlen (values [i]);
+      hashes [i] = _frozen_hash (f, keys [i], key_length);
+      bytes += key_length + 1;
+      if (values [i] != keys [i]) bytes += value_length + 1;
+    }
+    f -> strings_size = bytes + 1; // never empty
+    f -> strings = (char *) c_allocator_alloc (allocator, f -> strings_size);
+    if (f -> strings) f -> mph = c_mph_create (hashes, count, order);
+  }
+
+  if (f -> mph) {
+    for (next = f -> strings, i = 0; i < count; i ++) {
+      j = order [i];
+      key_length = key_lengths ? key_lengths [j] : strlen (keys [j]);
+      f -> entries [i].hash = hashes [j];
+      f -> entries [i].length = key_length;
+      f -> entries [i].key = f -> entries [i].value = next - f -> strings;
+      memcpy (next, keys [j], key_length);
+      next [key_length] = 0x00;
+      next += key_length + 1;
+      if (values [j] != keys [j]) { // a C_SYMBOL's "values" are its keys
+        value_length = value_lengths ? value_lengths [j] : strlen (values [j]);
+        f -> entries [i].value = next - f -> strings;
+        memcpy (next, values [j], value_length);
+        next [value_length] = 0x00;
+        next += value_length + 1;
+      }
+    }
+    *next = 0x00;
+  } else {
+    c_allocator_free (allocator, f -> strings);
+    c_allocator_free (allocator, f -> entries);
+    c_allocator_free (allocator, f);
+    f = NULL;
+  }
+
+  c_allocator_free (allocator, hashes);
+  c_allocator_free (allocator, order);
+
+  return f;
+}
+
+typedef struct _COLLECT {
+  const char **keys;
+  const char **values;
+  size_t *key_lengths;
+  size_t *value_lengths;
+  int count;
+} _COLLECT;
+
+static int
+_collect_pair (void *key, void *value, void *context) {
+  _COLLECT *c = (_COLLECT *) context;
+  c -> keys [c -> count] = (const char *) key;
+  c -> values [c -> count] = (const char *) value;
+  c -> key_lengths [c -> count] = c_symbol_length (key);
+  c -> value_lengths [c -> count ++] = c_symbol_length (value);
+  return 0;
+}
+
+static C_FROZEN_DICT *
+_c_dict_frozen_copy (C_DICT *d) {
+
+  C_ALLOCATOR *allocator = d -> allocator;
+  int count = c_dict_size (d);
+  C_FROZEN_DICT *f = NULL;
+  const char **keys, **values;
+  size_t *key_lengths, *value_lengths;
+
+  keys = (const char **) c_allocator_alloc (allocator,
+    (count + 1) * sizeof (char *));
+  values = (const char **) c_allocator_alloc (allocator,
+    (count + 1) * sizeof (char *));
+  key_lengths = (size_t *) c_allocator_alloc (allocator,
+    (count + 1) * sizeof (size_t));
+  value_lengths = (size_t *) c_allocator_alloc (allocator,
+    (count + 1) * sizeof (size_t));
+
+  if (keys && values && key_lengths && value_lengths) {
+    _COLLECT collect = { keys, values, key_lengths, value_lengths, 0 };
+    c_map_walk (d -> dict, _collect_pair, &collect);
+    f = c_frozen_dict_create (keys, key_lengths, values, value_lengths, count,
+      d -> keyed);
+  }
+
+  c_allocator_free (allocator, keys);
+  c_allocator_free (allocator, values);
+  c_allocator_free (allocator, key_lengths);
+  c_allocator_free (allocator, value_lengths);
+
+  return f;
+}
+
+C_FROZEN_DICT *
+c_dict_freeze (C_DICT *d) {
+  C_FROZEN_DICT *f = _c_dict_frozen_copy (d);
+  if (f) c_dict_free (d);
+  return f;
+}
+
+int
+c_dict_save (C_DICT *d, const char *path) {
+  C_FROZEN_DICT *f = _c_dict_frozen_copy (d);
+  int result = f ? c_frozen_dict_save (f, path) : -1;
+  c_frozen_dict_free (f);
+  return result;
+}
+
+int
+c_frozen_dict_save (C_FROZEN_DICT *f, const char *path) {
+  static const char pad [8];
+  _FILE_HEADER header;
+  size_t padding = (8 - f -> strings_size % 8) % 8;
+  void *image;
+  FILE *file;
+  int result = 0;
+
+  image = c_allocator_alloc (f -> allocator, c_mph_image_size (f -> mph));
+  if (!image) return -1;
+  c_mph_image (f -> mph, image);
+
+  memset (&header, 0x00, sizeof (header));
+  memcpy (header.magic, C_DICT_FILE_MAGIC, sizeof (header.magic));
+  header.order = C_DICT_FILE_ORDER;
+  header.keyed = f -> keyed;
+  memcpy (header.seed, f -> seed, HASH_FUNC_KEY_SIZE);
+  header.size = f -> size;
+  header.entries = sizeof (header);
+  header.strings = header.entries + f -> size * sizeof (_FROZEN);
+  header.strings_size = f -> strings_size;
+  header.mph = header.strings + f -> strings_size + padding;
+  header.mph_size = c_mph_image_size (f -> mph);
+
+  file = fopen (path, "wb");
+  if (!file) result = -1;
+  else {
+    if (1 != fwrite (&header, sizeof (header), 1, file) ||
+        f -> size != fwrite (f -> entries, sizeof (_FROZEN), f -> size, file) ||
+        1 != fwrite (f -> strings, f -> strings_size, 1, file) ||
+        padding != fwrite (pad, 1, padding, file) ||
+        1 != fwrite (image, header.mph_size, 1, file)) result = -1;
+    if (fclose (file)) result = -1;
+  }
+
+  c_allocator_free (f -> allocator, image);
+  return result;
+}
+
+/*
+ * everything in the file that a lookup relies on is checked, so that a
+ * damaged file is refused rather than read out of bounds; the strings end
+ * in a null, so no string can run past the end of the block
+ */
+static int
+_c_frozen_dict_check (C_FROZEN_DICT *f, const _FILE_HEADER *header,
+    size_t length) {
+  unsigned long long n = header -> size;
+  int i;
+
+  if (length < sizeof (_FILE_HEADER)) return -1;
+  if (memcmp (header -> magic, C_DICT_FILE_MAGIC, sizeof (header -> magic)) ||
+      header -> order != C_DICT_FILE_ORDER) return -1;
+  if (n > (unsigned long long) length / sizeof (_FROZEN) ||
+      header -> entries != sizeof (_FILE_HEADER) ||
+      header -> strings != header -> entries + n * sizeof (_FROZEN) ||
+      header -> strings_size < 1 || header -> strings_size > length ||
+      header -> mph < header -> strings + header -> strings_size ||
+      header -> mph % 8 || header -> mph > length ||
+      header -> mph_size != length - header -> mph) return -1;
+
+  f -> keyed = header -> keyed;
+  memcpy (f -> seed, header -> seed, HASH_FUNC_KEY_SIZE);
+  f -> size = (int) n;
+  f -> entries = (_FROZEN *) ((char *) header + header -> entries);
+  f -> strings = (char *) header + header -> strings;
+  f -> strings_size = header -> strings_size;
+  if (f -> strings [f -> strings_size - 1]) return -1;
+  for (i = 0; i < f -> size; i ++) {
+    _FROZEN *e = f -> entries + i;
+    if (e -> key >= f -> strings_size ||
+        e -> length >= f -> strings_size - e -> key ||
+        e -> value >= f -> strings_size) return -1;
+  }
+
+  f -> mph = c_mph_map ((char *) header + header -> mph, header -> mph_size);
+  if (!f -> mph || c_mph_size (f -> mph) != f -> size) return -1;
+
+  return 0;
+}
+
+C_FROZEN_DICT *
+c_frozen_dict_load (const char *path) {
+
+  C_ALLOCATOR *allocator = c_allocator_get ();
+  C_FROZEN_DICT *f;
+  struct stat st;
+  int fd;
+
+  f = (C_FROZEN_DICT *) c_allocator_alloc (allocator, sizeof (C_FROZEN_DICT));
+  if (!f) return NULL;
+  memset (f, 0x00, sizeof (C_FROZEN_DICT));
+  f -> allocator = allocator;
+
+  fd = open (path, O_RDONLY);
+  if (fd >= 0) {
+    if (0 == fstat (fd, &st) && st.st_size > 0) {
+      f -> mapping = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (MAP_FAILED == f -> mapping) f -> mapping = NULL;
+      else f -> mapping_size = st.st_size;
+    }
+    close (fd);
+  }
+
+  if (!f -> mapping ||
+      _c_frozen_dict_check (f, (_FILE_HEADER *) f -> mapping,
+        f -> mapping_size)) {
+    c_frozen_dict_free (f);
+    f = NULL;
+  }
+
+  return f;
+}
+
+void
+c_frozen_dict_free (C_FROZEN_DICT *f) {
+  if (f) {
+    c_mph_free (f -> mph);
+    if (f -> mapping) munmap (f -> mapping, f -> mapping_size);
+    else {
+      c_allocator_free (f -> allocator, f -> strings);
+      c_allocator_free (f -> allocator, f -> entries);
+    }
+    c_allocator_free (f -> allocator, f);
+  }
+}
+
+char *
+c_frozen_dict_find_n (C_FROZEN_DICT *f, const char *key, size_t length) {
+  unsigned long long hash = _frozen_hash (f, key, length);
+  int count, i = c_mph_find (f -> mph, hash, &count);
+
+  for (count += i; i < count; i ++) {
+    _FROZEN *e = f -> entries + i;
+    if (e -> hash == hash && e -> length == length &&
+        0 == memcmp (f -> strings + e -> key, key, length))
+      return f -> strings + e -> value;
+  }
+
+  return NULL;
+}
+
+char *
+c_frozen_dict_find (C_FROZEN_DICT *f, char *key) {
+  return c_frozen_dict_find_n (f, key, strlen (key));
+}
+
+C_DICTITEM
+c_frozen_dict_item (C_FROZEN_DICT *f, int index) {
+  C_DICTITEM item = {NULL, NULL};
+
+  if (index >= 0 && index < f -> size) {
+    item.key = f -> strings + f -> entries [index].key;
+    item.value = f -> strings + f -> entries [index].value;
+  }
+
+  return item;
+}
+
+int
+c_frozen_dict_size (C_FROZEN_DICT *f) {
+  return f -> size;
+}
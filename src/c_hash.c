@@ -1,63 +1,281 @@
 #include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
+#include "c_allocator.h"
+#include "c_buffer.h"
 #include "c_list.h"
 #include "c_hash.h"
+#include "c_slab.h"
+
+#if defined (__AVX2__)
+#include <immintrin.h>
+#define _GROUP_WIDTH 32
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#define _GROUP_WIDTH 16
+#else
+#define _GROUP_WIDTH 16
+#endif
+
+typedef unsigned long long _HASH; // 32-bit calculators are widened
 
 typedef struct _NODE {
-  unsigned int hash;
+  _HASH hash;
   char item [0]; // this gets properly sized in _c_hash_insert below
 } _NODE;
 
+/*
+ * An open-addressed slot. The slots live in one flat array, each one sized
+ * (h -> slot_size) to hold the header and the user item inline.
+ */
+typedef struct _SLOT {
+  _HASH hash;
+  unsigned int state;
+  unsigned int unused; // keeps the item 8-byte aligned
+  char item [0];
+} _SLOT;
+
+#define _SLOT_EMPTY 0
+#define _SLOT_FULL 1
+#define _SLOT_DELETED 2
+
+/*
+ * C_HASH_GROUP control bytes: one per slot, holding either the low seven bits
+ * of the slot's hash (high bit clear) or one of these markers (high bit set)
+ */
+#define _CTRL_EMPTY 0x80
+#define _CTRL_DELETED 0xfe
+
+/*
+ * the state of one lookup, kept on the caller's stack so that finds don't
+ * write to the C_HASH; an insert or remove picks up where its find left off
+ */
+typedef struct _FIND {
+  _HASH hash;
+  int index;                 // C_HASH_OPEN, C_HASH_GROUP, C_HASH_ROBIN_HOOD
+  C_LIST **bucket;           // C_HASH_CHAINED
+  C_LIST_POSITION *position; // C_HASH_CHAINED, the matching node
+} _FIND;
+
 struct C_HASH {
   C_HASH_CALCULATOR calculator;
+  C_HASH_CALCULATOR64 calculator64; // used instead of calculator if set
   C_HASH_COMPARATOR comparator;
   C_HASH_GARBAGE garbage;
   C_HASH_ITERATOR_ITEM extractor;
   void *context;
+  C_ALLOCATOR *allocator;
+  int type;
 
   /* hash table */
   int table_size;
   int item_size;
-  C_LIST **table;
+  C_LIST **table;    // C_HASH_CHAINED
+  C_SLAB *nodes;     // _NODEs for the chained table
+  C_SLAB *items;     // C_LIST items for the chained table
+  C_SLAB *lists;     // the C_LISTs themselves, one per occupied bucket
+  int incremental;   // C_HASH_INCREMENTAL
+
+  /* chained table being migrated into table (C_HASH_INCREMENTAL) */
+  C_LIST **old_table;
+  int old_table_size;
+  int migrate_index; // old_table buckets below this have been migrated
+
+  /* open-addressed table */
+  char *slots;       // C_HASH_OPEN, C_HASH_GROUP, C_HASH_ROBIN_HOOD
+  size_t slot_size;
+  int used;          // full plus deleted slots
+  unsigned char *ctrl; // C_HASH_GROUP
+  char *swap;        // C_HASH_ROBIN_HOOD, two slots for displacing items
 
-  /* find */
-  unsigned int fnd_hash;
-  int fnd_index;
-  C_ITERATOR *fnd_iterator;
+  /* sizing (C_HASH_OPTIONS) */
+  float max_load;
+  float min_load;
+  float growth;
+  int prime;         // C_HASH_SIZE_PRIME: chained buckets picked by modulo
+  int grow_at;       // rehash once the load passes this
+  int shrink_at;     // shrink once the size drops below this (0: never)
+  int min_table_size; // auto-shrink never goes below the initial size
 
   /* iterate */
   C_ITERATOR *iterator;
   int itr_index;
-  C_ITERATOR *itr_iterator;
-  _NODE *current;
+  int itr_start;     // C_HASH_ROBIN_HOOD, an empty slot
+  C_LIST *itr_list;  // C_HASH_CHAINED, the bucket being walked
+  C_LIST_POSITION *itr_position;
 
   int size;
 };
 
 #define C_HASH_INITIAL_TABLE_SIZE 16
 #define C_HASH_LOAD_FACTOR .75
+#define C_HASH_ROBIN_HOOD_LOAD_FACTOR .9
+#define C_HASH_MIGRATE_BUCKETS 4 // old buckets migrated per operation
+#define C_HASH_FIND_BATCH 16     // items hashed and prefetched at a time
 
-C_HASH *
-c_hash_create (size_t item_size, C_HASH_CALCULATOR cal, C_HASH_COMPARATOR com,
-    C_HASH_GARBAGE garbage, void *context) {
+#define _CHAIN_INDEX(h, hash, size) \
+  ((h) -> prime ? (int) ((hash) % (size)) : (int) ((hash) & ((size) - 1)))
+#define _SLOT_AT(h, i) ((_SLOT *) ((h) -> slots + (size_t) (i) * (h) -> slot_size))
+#define _SLOT_OF(item) ((_SLOT *) ((char *) (item) - offsetof (_SLOT, item)))
+
+/* primes just above each power of two and halfway between, from 16 up */
+static const int _primes [] = {
+  17, 29, 37, 53, 67, 97, 131, 193, 257, 389, 521, 769, 1031, 1543, 2053,
+  3079, 4099, 6151, 8209, 12289, 16411, 24593, 32771, 49157, 65537, 98317,
+  131101, 196613, 262147, 393241, 524309, 786433, 1048583, 1572869, 2097169,
+  3145739, 4194319, 6291469, 8388617, 12582917, 16777259, 25165843, 33554467,
+  50331653, 67108879, 100663319, 134217757, 201326611, 268435459, 402653189,
+  536870923, 805306457, 1073741827, 1610612741
+};
+
+static float
+_c_hash_load_factor (int type) {
+  return C_HASH_ROBIN_HOOD == type ? C_HASH_ROBIN_HOOD_LOAD_FACTOR :
+    C_HASH_LOAD_FACTOR;
+}
+
+/*
+ * the smallest table size that the C_HASH can use and that holds at least
+ * the given number of buckets or slots, or the largest size it can use
+ */
+static int
+_c_hash_next_size (C_HASH *h, int at_least) {
+  int size = C_HASH_INITIAL_TABLE_SIZE, i;
+
+  if (h -> prime) {
+    for (i = 0; i < (int) (sizeof (_primes) / sizeof (_primes [0])) - 1; i ++)
+      if (_primes [i] >= at_least) break;
+    return _primes [i];
+  }
+
+  if (C_HASH_GROUP == h -> type && size < _GROUP_WIDTH) size = _GROUP_WIDTH;
+  while (size < at_least && size <= INT_MAX / 2) size *= 2;
+  return size;
+}
+
+/*
+ * the smallest table size that holds the expected number of items within
+ * max_load, or -1 if even the largest size does not
+ */
+static int
+_c_hash_initial_size (C_HASH *h, int expected) {
+  int size = _c_hash_next_size (h, 0), next;
+
+  while (expected > size * (double) h -> max_load) {
+    next = _c_hash_next_size (h, size + 1);
+    if (next <= size) return -1;
+    size = next;
+  }
+
+  return size;
+}
+
+/*
+ * the load limits are kept as item counts, so that an insert or remove
+ * compares integers instead of dividing
+ */
+static void
+_c_hash_set_table_size (C_HASH *h, int size) {
+  h -> table_size = size;
+  h -> grow_at = size * (double) h -> max_load < INT_MAX ?
+    (int) (size * h -> max_load) : INT_MAX;
+  h -> shrink_at = (int) (size * h -> min_load);
+}
+
+static int
+_c_hash_allocate (C_HASH *h, int size) {
+  switch (h -> type) {
+    case C_HASH_GROUP:
+      h -> ctrl = (unsigned char *) c_allocator_alloc (h -> allocator, size);
+      if (!h -> ctrl) return C_HASH_ERROR_MEMORY;
+      memset (h -> ctrl, _CTRL_EMPTY, size);
+      /* fall through */
+    case C_HASH_OPEN:
+    case C_HASH_ROBIN_HOOD:
+      h -> slots = (char *) c_allocator_calloc (h -> allocator, size,
+        h -> slot_size);
+      if (C_HASH_ROBIN_HOOD == h -> type)
+        h -> swap = (char *) c_allocator_alloc (h -> allocator,
+          2 * h -> slot_size);
+      if (!h -> slots || (C_HASH_ROBIN_HOOD == h -> type && !h -> swap)) {
+        c_allocator_free (h -> allocator, h -> slots);
+        c_allocator_free (h -> allocator, h -> swap);
+        c_allocator_free (h -> allocator, h -> ctrl);
+        return C_HASH_ERROR_MEMORY;
+      }
+      break;
+    default:
+      h -> nodes = c_slab_create (sizeof (_NODE) + h -> item_size);
+      h -> items = c_list_slab_create ();
+      h -> lists = c_list_header_slab_create ();
+      h -> table = (C_LIST **) c_allocator_calloc (h -> allocator, size,
+        sizeof (C_LIST *));
+      if (!h -> nodes || !h -> items || !h -> lists || !h -> table) {
+        c_slab_free (h -> nodes);
+        c_slab_free (h -> items);
+        c_slab_free (h -> lists);
+        c_allocator_free (h -> allocator, h -> table);
+        return C_HASH_ERROR_MEMORY;
+      }
+  }
+  _c_hash_set_table_size (h, size);
+  return 0;
+}
+
+static int
+_c_hash_check_options (int type, C_HASH_OPTIONS *options) {
+  float max = options -> max_load ? options -> max_load :
+    _c_hash_load_factor (type);
+  float growth = options -> growth ? options -> growth : 2;
 
-  C_HASH *h = (C_HASH *) malloc (sizeof (C_HASH));
+  if (max < 0 || (C_HASH_CHAINED != type && max >= 1)) return 0;
+  if (options -> growth && options -> growth <= 1) return 0;
+  if (options -> min_load < 0 || options -> min_load * growth >= max) return 0;
+  return C_HASH_SIZE_POWER2 == options -> sizing ||
+    C_HASH_SIZE_PRIME == options -> sizing;
+}
+
+static C_HASH *
+_c_hash_create (size_t item_size, C_HASH_CALCULATOR cal,
+    C_HASH_CALCULATOR64 cal64, C_HASH_COMPARATOR com, C_HASH_GARBAGE garbage,
+    void *context, int initial, int type, C_HASH_OPTIONS *options) {
+
+  if (options && !_c_hash_check_options (type & C_HASH_TYPE_MASK, options))
+    return NULL;
+
+  C_ALLOCATOR *allocator = c_allocator_get ();
+  C_HASH *h = (C_HASH *) c_allocator_alloc (allocator, sizeof (C_HASH));
   if (h) {
     memset (h, 0x00, sizeof (C_HASH));
+    h -> allocator = allocator;
     h -> item_size = item_size;
     h -> calculator = cal;
+    h -> calculator64 = cal64;
     h -> comparator = com;
     h -> garbage = garbage;
     h -> context = context;
-    h -> table_size = C_HASH_INITIAL_TABLE_SIZE;
-    h -> table = (C_LIST **)
-      malloc (sizeof (C_LIST *) * h -> table_size);
-    if (h -> table) {
-      memset (h -> table, 0x00, sizeof (C_LIST *) * h -> table_size);
-    } else {
-      free (h);
+    h -> type = type & C_HASH_TYPE_MASK;
+    h -> incremental = C_HASH_CHAINED == h -> type && (type & C_HASH_INCREMENTAL);
+    h -> slot_size = (sizeof (_SLOT) + item_size + sizeof (void *) - 1) &
+      ~(sizeof (void *) - 1);
+    h -> max_load = _c_hash_load_factor (h -> type);
+    h -> growth = 2;
+    if (options) {
+      if (options -> max_load) h -> max_load = options -> max_load;
+      if (options -> growth) h -> growth = options -> growth;
+      h -> min_load = options -> min_load;
+      h -> prime = C_HASH_CHAINED == h -> type &&
+        C_HASH_SIZE_PRIME == options -> sizing;
+    }
+    h -> min_table_size = _c_hash_initial_size (h, initial);
+    if (h -> min_table_size < 0 ||
+        0 != _c_hash_allocate (h, h -> min_table_size)) {
+      c_allocator_free (allocator, h);
       h = NULL;
     }
   }
@@ -65,57 +283,139 @@ c_hash_create (size_t item_size, C_HASH_CALCULATOR cal, C_HASH_COMPARATOR com,
   return h;
 }
 
+C_HASH *
+c_hash_create_options (size_t item_size, C_HASH_CALCULATOR cal,
+    C_HASH_COMPARATOR com, C_HASH_GARBAGE garbage, void *context,
+    int initial, int type, C_HASH_OPTIONS *options) {
+  return _c_hash_create (item_size, cal, NULL, com, garbage, context,
+    initial, type, options);
+}
+
+C_HASH *
+c_hash_create64 (size_t item_size, C_HASH_CALCULATOR64 cal,
+    C_HASH_COMPARATOR com, C_HASH_GARBAGE garbage, void *context,
+    int initial, int type, C_HASH_OPTIONS *options) {
+  return _c_hash_create (item_size, NULL, cal, com, garbage, context,
+    initial, type, options);
+}
+
+C_HASH *
+c_hash_create_base (size_t item_size, C_HASH_CALCULATOR cal,
+    C_HASH_COMPARATOR com, C_HASH_GARBAGE garbage, void *context,
+    int initial, int type) {
+  return c_hash_create_options (item_size, cal, com, garbage, context,
+    initial, type, NULL);
+}
+
+C_HASH *
+c_hash_create (size_t item_size, C_HASH_CALCULATOR cal, C_HASH_COMPARATOR com,
+    C_HASH_GARBAGE garbage, void *context) {
+  return c_hash_create_base (item_size, cal, com, garbage, context, 0,
+    C_HASH_CHAINED);
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * chained table: one C_LIST of _NODEs per occupied bucket
+ * ---------------------------------------------------------------------------
+ */
+
+/*
+ * the buckets' C_LISTs, their items and the nodes all come from C_SLABs, and
+ * the buckets are walked with positions rather than c_list_iterator, so no
+ * bucket owns anything else: clearing the slabs drops every bucket at once,
+ * and only a garbage collector needs the items visited one by one
+ */
 static void
-_c_hash_clear (C_HASH *h) {
-  if (h) {
-    int i;
-    for (i = 0; i < h -> table_size; i ++) {
-      C_LIST *list = h -> table [i];
-      if (list) {
-        while (c_list_size (list)) {
-          _NODE *node = (_NODE *) c_list_take (list);
-          if (h -> garbage) h -> garbage (&node -> item, h -> context);
-          free (node);
-        }
-        c_list_free (list);
-        h -> table [i] = NULL;
-      }
+_chain_garbage (C_HASH *h, C_LIST **table, int from, int size) {
+  int i;
+  for (i = from; i < size; i ++) {
+    C_LIST_POSITION *position;
+    if (!table [i]) continue;
+    for (position = c_list_first (table [i]); position;
+        position = c_list_next (position)) {
+      _NODE *node = (_NODE *) c_list_value (position);
+      h -> garbage (&node -> item, h -> context);
     }
-    h -> size = 0;
   }
 }
 
-void
-c_hash_free (C_HASH *h) {
+static void
+_chain_clear (C_HASH *h) {
+  if (h -> garbage) {
+    _chain_garbage (h, h -> table, 0, h -> table_size);
+    if (h -> old_table)
+      _chain_garbage (h, h -> old_table, h -> migrate_index,
+        h -> old_table_size);
+  }
+  memset (h -> table, 0x00, h -> table_size * sizeof (C_LIST *));
+  if (h -> old_table) {
+    c_allocator_free (h -> allocator, h -> old_table);
+    h -> old_table = NULL;
+  }
+  c_slab_clear (h -> nodes);
+  c_slab_clear (h -> items);
+  c_slab_clear (h -> lists);
+}
 
-  if (h) {
-    _c_hash_clear (h);
-  
-    free (h -> table);
-    c_iterator_free (h -> iterator);
-    free (h);
+/*
+ * moves up to count buckets from old_table into table; old_table is released
+ * once the last bucket has moved
+ */
+static int
+_chain_migrate (C_HASH *h, int count) {
+  while (h -> old_table && count -- > 0) {
+    C_LIST *list = h -> old_table [h -> migrate_index];
+    if (list) {
+      while (c_list_size (list)) {
+        _NODE *node = (_NODE *) c_list_take (list);
+        int index = _CHAIN_INDEX (h, node -> hash, h -> table_size);
+        C_LIST *new_list = h -> table [index];
+        if (NULL == new_list) new_list = h -> table [index] =
+          c_list_create_slabs (h -> items, h -> lists);
+        if (!new_list) {
+          c_list_add_first (list, node); // try again next time
+          return C_HASH_ERROR_MEMORY;
+        }
+        c_list_add (new_list, node);
+      }
+      c_list_free (list);
+      h -> old_table [h -> migrate_index] = NULL;
+    }
+    if (++ h -> migrate_index == h -> old_table_size) {
+      c_allocator_free (h -> allocator, h -> old_table);
+      h -> old_table = NULL;
+    }
   }
+  return 0;
 }
 
-void
-c_hash_clear (C_HASH *h) {
-  _c_hash_clear (h);
+/*
+ * while a migration is under way, a hash whose old bucket has not moved yet
+ * still lives in old_table
+ */
+static C_LIST **
+_chain_bucket (C_HASH *h, _HASH hash) {
+  if (h -> old_table) {
+    int index = _CHAIN_INDEX (h, hash, h -> old_table_size);
+    if (index >= h -> migrate_index) return h -> old_table + index;
+  }
+  return h -> table + _CHAIN_INDEX (h, hash, h -> table_size);
 }
 
-static _NODE *
-_c_hash_find (C_HASH *h, void *item) {
+static void *
+_chain_find (C_HASH *h, _FIND *f, void *item) {
 
-  h -> fnd_hash = h -> calculator (item, h -> context);
-  h -> fnd_index = h -> fnd_hash % h -> table_size;
-  C_LIST *list = h -> table [h -> fnd_index];
+  f -> bucket = _chain_bucket (h, f -> hash);
+  C_LIST *list = *f -> bucket;
 
   if (list) {
-    h -> fnd_iterator = c_list_iterator (list);
-    while (c_iterator_has_next (h -> fnd_iterator)) {
-      _NODE *node = (_NODE *) c_iterator_next (h -> fnd_iterator);
-      if (node -> hash == h -> fnd_hash) {
+    for (f -> position = c_list_first (list); f -> position;
+        f -> position = c_list_next (f -> position)) {
+      _NODE *node = (_NODE *) c_list_value (f -> position);
+      if (node -> hash == f -> hash) {
         if (0 == h -> comparator (&node -> item, item, h -> context))
-          return node;
+          return &node -> item;
       }
     }
   }
@@ -123,11 +423,32 @@ _c_hash_find (C_HASH *h, void *item) {
   return NULL;
 }
 
+/*
+ * starts a migration into a table of the given size; the buckets move a few
+ * at a time from here on (C_HASH_INCREMENTAL)
+ */
 static int
-_c_hash_rehash (C_HASH *h) {
+_chain_grow (C_HASH *h, int size) {
+  C_LIST **new_table = (C_LIST **) c_allocator_calloc (h -> allocator, size,
+    sizeof (C_LIST *));
+  if (!new_table) return C_HASH_ERROR_MEMORY;
+  if (0 != _chain_migrate (h, h -> old_table_size)) {
+    c_allocator_free (h -> allocator, new_table);
+    return C_HASH_ERROR_MEMORY;
+  }
+  h -> old_table = h -> table;
+  h -> old_table_size = h -> table_size;
+  h -> migrate_index = 0;
+  h -> table = new_table;
+  _c_hash_set_table_size (h, size);
+  return 0;
+}
+
+static int
+_chain_rehash (C_HASH *h, int size) {
   int i;
-  size_t size = h -> table_size * 2;
-  C_LIST **new_table = (C_LIST **) malloc (sizeof (C_LIST *) * size);
+  C_LIST **new_table = (C_LIST **) c_allocator_alloc (h -> allocator,
+    sizeof (C_LIST *) * size);
   if (!new_table) return C_HASH_ERROR_MEMORY;
 
   memset (new_table, 0x00, sizeof (C_LIST *) * size);
@@ -136,13 +457,14 @@ _c_hash_rehash (C_HASH *h) {
     if (list) {
       while (c_list_size (list)) {
         _NODE *node = (_NODE *) c_list_take (list);
-        int index = node -> hash % size;
+        int index = _CHAIN_INDEX (h, node -> hash, size);
         C_LIST *new_list = new_table [index];
-        if (NULL == new_list) new_list = new_table [index] = c_list_create ();
+        if (NULL == new_list) new_list = new_table [index] =
+          c_list_create_slabs (h -> items, h -> lists);
         if (!new_list) {
           int j;
           for (j = 0; j < size; j ++) c_list_free (new_table [j]);
-          free (new_table);
+          c_allocator_free (h -> allocator, new_table);
           return C_HASH_ERROR_MEMORY;
         }
         c_list_add (new_list, node);
@@ -151,154 +473,1265 @@ _c_hash_rehash (C_HASH *h) {
     }
   }
 
-  free (h -> table);
+  c_allocator_free (h -> allocator, h -> table);
   h -> table = new_table;
-  h -> table_size = size;
+  _c_hash_set_table_size (h, size);
 
   return 0;
 }
 
 static int
-_c_hash_check_rehash (C_HASH *h) {
-  if ((float) h -> size / (float) h -> table_size > C_HASH_LOAD_FACTOR) {
-    return _c_hash_rehash (h);
+_chain_insert (C_HASH *h, _FIND *f, void *item) {
+  _NODE *node = (_NODE *) c_slab_alloc (h -> nodes);
+  if (!node) return C_HASH_ERROR_MEMORY;
+
+  node -> hash = f -> hash;
+  memcpy (&node -> item, item, h -> item_size);
+  C_LIST *list = *f -> bucket;
+  if (!list) list = *f -> bucket = c_list_create_slabs (h -> items, h -> lists);
+  if (!list || c_list_add (list, node)) {
+    c_slab_release (h -> nodes, node);
+    return C_HASH_ERROR_MEMORY;
   }
+
   return 0;
 }
 
-static int
-_c_hash_insert (C_HASH *h, void *item) {
-  _NODE *node = (_NODE *) malloc (sizeof (_NODE) + h -> item_size);
-  if (!node) return C_HASH_ERROR_MEMORY;
+static void
+_chain_remove (C_HASH *h, _FIND *f, void *item) {
+  c_list_remove (*f -> bucket, f -> position);
+  c_slab_release (h -> nodes, (char *) item - offsetof (_NODE, item));
+}
 
-  node -> hash = h -> fnd_hash;
-  memcpy (&node -> item, item, h -> item_size);
-  C_LIST *list = h -> table [h -> fnd_index];
-  if (!list) list = h -> table [h -> fnd_index] = c_list_create ();
-  if (!list) {
-    free (node);
-    return C_HASH_ERROR_MEMORY;
+/*
+ * ---------------------------------------------------------------------------
+ * open-addressed table: items stored inline in a flat array of _SLOTs,
+ * linear probing, deleted slots marked so that probe sequences stay intact
+ * ---------------------------------------------------------------------------
+ */
+
+static void
+_open_clear (C_HASH *h) {
+  int i;
+  if (h -> garbage) {
+    for (i = 0; i < h -> table_size; i ++) {
+      _SLOT *slot = _SLOT_AT (h, i);
+      if (_SLOT_FULL == slot -> state) h -> garbage (&slot -> item, h -> context);
+    }
   }
-  c_list_add (list, node);
+  memset (h -> slots, 0x00, (size_t) h -> table_size * h -> slot_size);
+  h -> used = 0;
+}
 
-  h -> size += 1;
-  if (h -> iterator && c_iterator_has_next (h -> iterator))
-    return 0; // don't screw with things
+/*
+ * on a miss, the find's index is left at the slot an insert should use: the first
+ * deleted slot along the probe sequence, or else the empty slot that ended it
+ */
+static void *
+_open_find (C_HASH *h, _FIND *f, void *item) {
+  int mask = h -> table_size - 1;
+  int index = f -> hash & mask;
+  int deleted = -1;
 
-  return _c_hash_check_rehash (h);
+  for (;; index = (index + 1) & mask) {
+    _SLOT *slot = _SLOT_AT (h, index);
+    if (_SLOT_EMPTY == slot -> state) break;
+    if (_SLOT_DELETED == slot -> state) {
+      if (deleted < 0) deleted = index;
+    } else if (slot -> hash == f -> hash) {
+      if (0 == h -> comparator (&slot -> item, item, h -> context)) {
+        f -> index = index;
+        return &slot -> item;
+      }
+    }
+  }
+
+  f -> index = deleted < 0 ? index : deleted;
+  return NULL;
 }
 
-int
-c_hash_insert (C_HASH *h, void *item) {
-  _NODE *find = _c_hash_find (h, item);
-  if (find) return C_HASH_ERROR_DUPLICATE;
+static int
+_open_rehash (C_HASH *h, int size) {
+  int i;
+  int mask = size - 1;
+  char *old = h -> slots;
+  char *slots = (char *) c_allocator_calloc (h -> allocator, size,
+    h -> slot_size);
+  if (!slots) return C_HASH_ERROR_MEMORY;
+
+  for (i = 0; i < h -> table_size; i ++) {
+    _SLOT *slot = (_SLOT *) (old + (size_t) i * h -> slot_size);
+    if (_SLOT_FULL == slot -> state) {
+      int index = slot -> hash & mask;
+      while (_SLOT_EMPTY != ((_SLOT *) (slots + (size_t) index * h -> slot_size)) -> state)
+        index = (index + 1) & mask;
+      memcpy (slots + (size_t) index * h -> slot_size, slot, h -> slot_size);
+    }
+  }
+
+  c_allocator_free (h -> allocator, old);
+  h -> slots = slots;
+  _c_hash_set_table_size (h, size);
+  h -> used = h -> size;
 
-  return _c_hash_insert (h, item);
+  return 0;
 }
 
-int
-c_hash_replace (C_HASH *h, void *item) {
-  _NODE *find = _c_hash_find (h, item);
-  if (!find) return C_HASH_ERROR_NOT_FOUND;
+static int
+_open_insert (C_HASH *h, _FIND *f, void *item) {
+  _SLOT *slot = _SLOT_AT (h, f -> index);
 
-  if (h -> garbage) h -> garbage (&find -> item, h -> context);
-  memcpy (&find -> item, item, h -> item_size);
+  if (_SLOT_EMPTY == slot -> state) h -> used += 1;
+  slot -> hash = f -> hash;
+  slot -> state = _SLOT_FULL;
+  memcpy (&slot -> item, item, h -> item_size);
 
   return 0;
 }
 
-void *
-c_hash_find (C_HASH *h, void *item) {
-  _NODE *found = _c_hash_find (h, item);
-  return found ? &found -> item : NULL;
+static void
+_open_remove (C_HASH *h, void *item) {
+  _SLOT_OF (item) -> state = _SLOT_DELETED;
 }
 
-void
-c_hash_remove (C_HASH *h, void *item) {
-  _NODE *find = _c_hash_find (h, item);
+/*
+ * ---------------------------------------------------------------------------
+ * group-probed table: slots as in C_HASH_OPEN, plus a parallel array of
+ * control bytes. Probing visits whole aligned groups of _GROUP_WIDTH slots;
+ * one vector compare of the control bytes against the wanted hash fragment
+ * selects the few slots worth handing to the comparator.
+ * ---------------------------------------------------------------------------
+ */
 
-  if (find) {
-    if (h -> garbage) h -> garbage (&find -> item, h -> context);
-    c_iterator_remove (h -> fnd_iterator);
-    free (find);
-    h -> size -= 1;
+#define _H1(hash) ((hash) >> 7)
+#define _H2(hash) ((unsigned char) ((hash) & 0x7f))
+
+/* bit i set if ctrl [i] == byte */
+static unsigned int
+_group_match (unsigned char *ctrl, unsigned char byte) {
+#if defined (__AVX2__)
+  __m256i group = _mm256_loadu_si256 ((__m256i *) ctrl);
+  return (unsigned int) _mm256_movemask_epi8 (
+    _mm256_cmpeq_epi8 (group, _mm256_set1_epi8 ((char) byte)));
+#elif defined (__SSE2__)
+  __m128i group = _mm_loadu_si128 ((__m128i *) ctrl);
+  return (unsigned int) _mm_movemask_epi8 (
+    _mm_cmpeq_epi8 (group, _mm_set1_epi8 ((char) byte)));
+#else
+  unsigned int mask = 0;
+  int i;
+  for (i = 0; i < _GROUP_WIDTH; i ++)
+    if (ctrl [i] == byte) mask |= 1u << i;
+  return mask;
+#endif
+}
+
+/* bit i set if ctrl [i] is empty or deleted (high bit set) */
+static unsigned int
+_group_match_free (unsigned char *ctrl) {
+#if defined (__AVX2__)
+  return (unsigned int) _mm256_movemask_epi8 (
+    _mm256_loadu_si256 ((__m256i *) ctrl));
+#elif defined (__SSE2__)
+  return (unsigned int) _mm_movemask_epi8 (
+    _mm_loadu_si128 ((__m128i *) ctrl));
+#else
+  unsigned int mask = 0;
+  int i;
+  for (i = 0; i < _GROUP_WIDTH; i ++)
+    if (ctrl [i] & 0x80) mask |= 1u << i;
+  return mask;
+#endif
+}
+
+static void
+_group_clear (C_HASH *h) {
+  int i;
+  if (h -> garbage) {
+    for (i = 0; i < h -> table_size; i ++) {
+      if (!(h -> ctrl [i] & 0x80))
+        h -> garbage (&_SLOT_AT (h, i) -> item, h -> context);
+    }
   }
+  memset (h -> ctrl, _CTRL_EMPTY, h -> table_size);
+  h -> used = 0;
 }
 
-static int
-_itr_next_item (C_HASH *h) {
+/*
+ * groups are visited in triangular order (g, g+1, g+3, g+6, ...), which
+ * reaches every group when the number of groups is a power of two; on a
+ * miss, the find's index is left at the first free slot along the way
+ */
+static void *
+_group_find (C_HASH *h, _FIND *f, void *item) {
+  int mask = h -> table_size / _GROUP_WIDTH - 1;
+  int group = _H1 (f -> hash) & mask;
+  unsigned char h2 = _H2 (f -> hash);
+  int step = 0;
 
-  while (h -> itr_index < h -> table_size) {
-    C_LIST *list = h -> table [h -> itr_index ++];
-    if (list) {
-      if (c_list_size (list)) {
-        h -> itr_iterator = c_list_iterator (list);
-        return 1;
+  f -> index = -1;
+  for (;;) {
+    unsigned char *ctrl = h -> ctrl + group * _GROUP_WIDTH;
+    unsigned int match = _group_match (ctrl, h2);
+
+    while (match) {
+      int index = group * _GROUP_WIDTH + __builtin_ctz (match);
+      _SLOT *slot = _SLOT_AT (h, index);
+      if (slot -> hash == f -> hash) {
+        if (0 == h -> comparator (&slot -> item, item, h -> context)) {
+          f -> index = index;
+          return &slot -> item;
+        }
       }
+      match &= match - 1;
+    }
+
+    if (f -> index < 0) {
+      unsigned int avail = _group_match_free (ctrl);
+      if (avail) f -> index = group * _GROUP_WIDTH + __builtin_ctz (avail);
+    }
+    if (_group_match (ctrl, _CTRL_EMPTY)) return NULL;
+
+    group = (group + ++ step) & mask;
+  }
+}
+
+static int
+_group_rehash (C_HASH *h, int size) {
+  int i;
+  int mask = size / _GROUP_WIDTH - 1;
+  char *old = h -> slots;
+  unsigned char *old_ctrl = h -> ctrl;
+  unsigned char *ctrl = (unsigned char *) c_allocator_alloc (h -> allocator,
+    size);
+  char *slots = (char *) c_allocator_alloc (h -> allocator,
+    (size_t) size * h -> slot_size);
+  if (!ctrl || !slots) {
+    c_allocator_free (h -> allocator, ctrl);
+    c_allocator_free (h -> allocator, slots);
+    return C_HASH_ERROR_MEMORY;
+  }
+  memset (ctrl, _CTRL_EMPTY, size);
+
+  for (i = 0; i < h -> table_size; i ++) {
+    if (!(old_ctrl [i] & 0x80)) {
+      _SLOT *slot = (_SLOT *) (old + (size_t) i * h -> slot_size);
+      int group = _H1 (slot -> hash) & mask;
+      int step = 0;
+      unsigned int avail;
+      while (!(avail = _group_match_free (ctrl + group * _GROUP_WIDTH)))
+        group = (group + ++ step) & mask;
+      int index = group * _GROUP_WIDTH + __builtin_ctz (avail);
+      ctrl [index] = old_ctrl [i];
+      memcpy (slots + (size_t) index * h -> slot_size, slot, h -> slot_size);
     }
   }
 
+  c_allocator_free (h -> allocator, old);
+  c_allocator_free (h -> allocator, old_ctrl);
+  h -> slots = slots;
+  h -> ctrl = ctrl;
+  _c_hash_set_table_size (h, size);
+  h -> used = h -> size;
+
   return 0;
 }
 
 static int
-_itr_init (void *ctx) {
-  C_HASH *h = (C_HASH *) ctx;
-  h -> itr_index = 0;
-  if (0 != _c_hash_check_rehash (h)) return 0; // safe time to try rehash
-  return _itr_next_item (h);
+_group_insert (C_HASH *h, _FIND *f, void *item) {
+  _SLOT *slot = _SLOT_AT (h, f -> index);
+
+  if (_CTRL_EMPTY == h -> ctrl [f -> index]) h -> used += 1;
+  h -> ctrl [f -> index] = _H2 (f -> hash);
+  slot -> hash = f -> hash;
+  memcpy (&slot -> item, item, h -> item_size);
+
+  return 0;
 }
 
-static int
-_itr_advance (void *ctx) {
-  C_HASH *h = (C_HASH *) ctx;
-  if (c_iterator_has_next (h -> itr_iterator)) return 1;
-  return _itr_next_item (h);
+/*
+ * a probe never passes a group that still has an empty slot, so a slot in
+ * such a group can go straight back to empty instead of deleted
+ */
+static void
+_group_remove_index (C_HASH *h, int index) {
+  int group = index / _GROUP_WIDTH;
+  if (_group_match (h -> ctrl + group * _GROUP_WIDTH, _CTRL_EMPTY)) {
+    h -> ctrl [index] = _CTRL_EMPTY;
+    h -> used -= 1;
+  } else {
+    h -> ctrl [index] = _CTRL_DELETED;
+  }
 }
 
-static void *
-_itr_retrieve (void *ctx) {
-  C_HASH *h = (C_HASH *) ctx;
-  h -> current = (_NODE *) c_iterator_next (h -> itr_iterator);
-  if (h -> extractor)
-    return h -> extractor ((void *) &h -> current -> item);
-  return (void *) &h -> current -> item;
+static void
+_group_remove (C_HASH *h, void *item) {
+  _group_remove_index (h, ((char *) _SLOT_OF (item) - h -> slots) /
+    h -> slot_size);
 }
 
-static int
-_itr_remove (void *ctx) {
-  C_HASH *h = (C_HASH *) ctx;
-  c_iterator_remove (h -> itr_iterator);
-  if (h -> garbage) h -> garbage (&h -> current -> item, h -> context);
-  free (h -> current);
-  h -> size -= 1;
-  return _itr_advance (h);
+/*
+ * ---------------------------------------------------------------------------
+ * Robin Hood table: _SLOTs as in C_HASH_OPEN, but an item that has probed
+ * further than a slot's resident takes the slot and the resident moves on,
+ * which keeps every item close to its home slot. The state of a slot is its
+ * item's probe distance plus one (0 is empty). Removal shifts the items that
+ * follow back by one instead of leaving a deleted marker.
+ * ---------------------------------------------------------------------------
+ */
+
+static void
+_robin_clear (C_HASH *h) {
+  int i;
+  if (h -> garbage) {
+    for (i = 0; i < h -> table_size; i ++) {
+      _SLOT *slot = _SLOT_AT (h, i);
+      if (slot -> state) h -> garbage (&slot -> item, h -> context);
+    }
+  }
+  memset (h -> slots, 0x00, (size_t) h -> table_size * h -> slot_size);
+  h -> used = 0;
 }
 
-C_ITERATOR *
-c_hash_iterator (C_HASH *h, C_HASH_ITERATOR_ITEM extract) {
-  if (h -> iterator) {
-    c_iterator_reset (h -> iterator);
-  } else {
-    h -> extractor = extract;
-    h -> iterator = c_iterator_create (
-      _itr_init,
-      _itr_advance,
-      _itr_retrieve,
-      _itr_remove,
-      0,
-      (void *) h
-    );
+/*
+ * a lookup stops as soon as it reaches a slot whose resident is closer to
+ * home than the item would be: an insert would have displaced that resident.
+ * On a miss, the find's index is left at that slot, where an insert starts.
+ */
+static void *
+_robin_find (C_HASH *h, _FIND *f, void *item) {
+  int mask = h -> table_size - 1;
+  int index = f -> hash & mask;
+  unsigned int state = 1;
+
+  for (;; index = (index + 1) & mask, state ++) {
+    _SLOT *slot = _SLOT_AT (h, index);
+    if (slot -> state < state) break;
+    if (slot -> hash == f -> hash) {
+      if (0 == h -> comparator (&slot -> item, item, h -> context)) {
+        f -> index = index;
+        return &slot -> item;
+      }
+    }
   }
-  return h -> iterator;
+
+  f -> index = index;
+  return NULL;
 }
 
-int
-c_hash_size (C_HASH *h) {
-  return h -> size;
+/*
+ * places the item in carry (whose state is its probe distance at index),
+ * displacing richer residents along the way; carry is one of the two swap
+ * slots and is overwritten
+ */
+static void
+_robin_place (C_HASH *h, char *slots, int mask, int index, _SLOT *carry) {
+  _SLOT *spare = (_SLOT *) (h -> swap == (char *) carry ?
+    h -> swap + h -> slot_size : h -> swap);
+
+  for (;; index = (index + 1) & mask, carry -> state ++) {
+    _SLOT *slot = (_SLOT *) (slots + (size_t) index * h -> slot_size);
+    if (0 == slot -> state) {
+      memcpy (slot, carry, h -> slot_size);
+      return;
+    }
+    if (slot -> state < carry -> state) {
+      _SLOT *swap = spare;
+      memcpy (spare, slot, h -> slot_size);
+      memcpy (slot, carry, h -> slot_size);
+      spare = carry;
+      carry = swap;
+    }
+  }
 }
 
-int
-c_hash_table_size (C_HASH *h) {
-  return h -> table_size;
+static int
+_robin_rehash (C_HASH *h, int size) {
+  int i;
+  char *old = h -> slots;
+  char *slots = (char *) c_allocator_calloc (h -> allocator, size,
+    h -> slot_size);
+  if (!slots) return C_HASH_ERROR_MEMORY;
+
+  for (i = 0; i < h -> table_size; i ++) {
+    _SLOT *slot = (_SLOT *) (old + (size_t) i * h -> slot_size);
+    if (slot -> state) {
+      _SLOT *carry = (_SLOT *) h -> swap;
+      memcpy (carry, slot, h -> slot_size);
+      carry -> state = 1;
+      _robin_place (h, slots, size - 1, slot -> hash & (size - 1), carry);
+    }
+  }
+
+  c_allocator_free (h -> allocator, old);
+  h -> slots = slots;
+  _c_hash_set_table_size (h, size);
+  h -> used = h -> size;
+
+  return 0;
+}
+
+static int
+_robin_insert (C_HASH *h, _FIND *f, void *item) {
+  int mask = h -> table_size - 1;
+  _SLOT *carry = (_SLOT *) h -> swap;
+
+  carry -> hash = f -> hash;
+  carry -> state = ((f -> index - (f -> hash & mask)) & mask) + 1;
+  memcpy (&carry -> item, item, h -> item_size);
+  _robin_place (h, h -> slots, mask, f -> index, carry);
+  h -> used += 1;
+
+  return 0;
+}
+
+/*
+ * backward-shift deletion: the run of displaced items after the slot moves
+ * back one place, ending at an empty slot or an item already at home
+ */
+static void
+_robin_remove_index (C_HASH *h, int index) {
+  int mask = h -> table_size - 1;
+  _SLOT *slot = _SLOT_AT (h, index);
+
+  for (;;) {
+    _SLOT *next = _SLOT_AT (h, (index + 1) & mask);
+    if (next -> state <= 1) break;
+    memcpy (slot, next, h -> slot_size);
+    slot -> state -= 1;
+    slot = next;
+    index = (index + 1) & mask;
+  }
+
+  slot -> state = 0;
+  h -> used -= 1;
+}
+
+static void
+_robin_remove (C_HASH *h, void *item) {
+  _robin_remove_index (h, ((char *) _SLOT_OF (item) - h -> slots) /
+    h -> slot_size);
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * common
+ * ---------------------------------------------------------------------------
+ */
+
+static void
+_c_hash_clear (C_HASH *h) {
+  if (h) {
+    switch (h -> type) {
+      case C_HASH_OPEN: _open_clear (h); break;
+      case C_HASH_GROUP: _group_clear (h); break;
+      case C_HASH_ROBIN_HOOD: _robin_clear (h); break;
+      default: _chain_clear (h);
+    }
+    h -> size = 0;
+  }
+}
+
+void
+c_hash_free (C_HASH *h) {
+
+  if (h) {
+    _c_hash_clear (h);
+
+    c_allocator_free (h -> allocator, h -> table);
+    c_allocator_free (h -> allocator, h -> slots);
+    c_allocator_free (h -> allocator, h -> ctrl);
+    c_allocator_free (h -> allocator, h -> swap);
+    c_slab_free (h -> nodes);
+    c_slab_free (h -> items);
+    c_slab_free (h -> lists);
+    c_iterator_free (h -> iterator);
+    c_allocator_free (h -> allocator, h);
+  }
+}
+
+void
+c_hash_clear (C_HASH *h) {
+  _c_hash_clear (h);
+}
+
+static void *
+_c_hash_find_hash (C_HASH *h, _FIND *f, void *item) {
+  switch (h -> type) {
+    case C_HASH_OPEN: return _open_find (h, f, item);
+    case C_HASH_GROUP: return _group_find (h, f, item);
+    case C_HASH_ROBIN_HOOD: return _robin_find (h, f, item);
+    default: return _chain_find (h, f, item);
+  }
+}
+
+static _HASH
+_c_hash_calculate (C_HASH *h, void *item) {
+  if (h -> calculator64) return h -> calculator64 (item, h -> context);
+  return h -> calculator (item, h -> context);
+}
+
+static void *
+_c_hash_find (C_HASH *h, _FIND *f, void *item) {
+  f -> hash = _c_hash_calculate (h, item);
+  return _c_hash_find_hash (h, f, item);
+}
+
+static int
+_c_hash_resize (C_HASH *h, int size) {
+  switch (h -> type) {
+    case C_HASH_OPEN: return _open_rehash (h, size);
+    case C_HASH_GROUP: return _group_rehash (h, size);
+    case C_HASH_ROBIN_HOOD: return _robin_rehash (h, size);
+    default:
+      if (0 != _chain_migrate (h, h -> old_table_size))
+        return C_HASH_ERROR_MEMORY;
+      return _chain_rehash (h, size);
+  }
+}
+
+static int
+_c_hash_rehash (C_HASH *h) {
+  double grown = h -> table_size * (double) h -> growth;
+  int size = grown < INT_MAX ? (int) grown : INT_MAX;
+
+  size = _c_hash_next_size (h, size > h -> table_size ? size :
+    h -> table_size + 1);
+
+  /*
+   * deleted slots make up enough of the load that the live items fill at
+   * most three quarters of max_load: sweep them out in place rather than
+   * grow, which leaves room for a quarter of max_load of inserts before the
+   * next rehash (robin hood tables remove by shifting back, so they never
+   * have deleted slots)
+   */
+  if ((C_HASH_OPEN == h -> type || C_HASH_GROUP == h -> type) &&
+      h -> used > h -> size && h -> size * 4 <= h -> grow_at * 3)
+    size = h -> table_size;
+
+  /*
+   * at the largest size, a chained table takes longer chains from here on;
+   * the other types would run out of empty slots
+   */
+  else if (size <= h -> table_size) {
+    if (C_HASH_CHAINED != h -> type) return C_HASH_ERROR_MEMORY;
+    h -> grow_at = INT_MAX;
+    return 0;
+  }
+
+  if (h -> incremental) return _chain_grow (h, size);
+  return _c_hash_resize (h, size);
+}
+
+static int
+_c_hash_check_rehash (C_HASH *h) {
+  int load = C_HASH_CHAINED == h -> type ? h -> size : h -> used;
+  if (load > h -> grow_at) return _c_hash_rehash (h);
+  return 0;
+}
+
+/*
+ * with a min_load, a remove that leaves the table too sparse shrinks it to
+ * the smallest size that holds the items within max_load
+ */
+static void
+_c_hash_check_shrink (C_HASH *h) {
+  int size;
+
+  if (h -> size >= h -> shrink_at || h -> old_table) return;
+  if (h -> iterator && c_iterator_has_next (h -> iterator)) return;
+
+  size = _c_hash_initial_size (h, h -> size);
+  if (size < 0) return;
+  if (size < h -> min_table_size) size = h -> min_table_size;
+  if (size < h -> table_size) _c_hash_resize (h, size);
+}
+
+static int
+_c_hash_insert (C_HASH *h, _FIND *f, void *item) {
+  int rc;
+  switch (h -> type) {
+    case C_HASH_OPEN: rc = _open_insert (h, f, item); break;
+    case C_HASH_GROUP: rc = _group_insert (h, f, item); break;
+    case C_HASH_ROBIN_HOOD: rc = _robin_insert (h, f, item); break;
+    default: rc = _chain_insert (h, f, item);
+  }
+  if (rc) return rc;
+
+  h -> size += 1;
+  if (h -> iterator && c_iterator_has_next (h -> iterator)) {
+
+    /* an open table always needs an empty slot to end a probe sequence */
+    if (C_HASH_CHAINED == h -> type || h -> used + 1 < h -> table_size)
+      return 0; // don't screw with things
+  }
+
+  return _c_hash_check_rehash (h);
+}
+
+int
+c_hash_insert (C_HASH *h, void *item) {
+  _FIND f;
+  void *find;
+
+  if (h -> old_table) _chain_migrate (h, C_HASH_MIGRATE_BUCKETS);
+  find = _c_hash_find (h, &f, item);
+  if (find) return C_HASH_ERROR_DUPLICATE;
+
+  return _c_hash_insert (h, &f, item);
+}
+
+static int
+_never_equal (void *item1, void *item2, void *context) {
+  return 1;
+}
+
+/*
+ * with a comparator that never matches, a find only works out where the
+ * item goes
+ */
+int
+c_hash_insert_unique (C_HASH *h, void *item) {
+  C_HASH_COMPARATOR comparator = h -> comparator;
+  int result;
+
+  h -> comparator = _never_equal;
+  result = c_hash_insert (h, item);
+  h -> comparator = comparator;
+
+  return result;
+}
+
+int
+c_hash_replace (C_HASH *h, void *item) {
+  _FIND f;
+  void *find;
+
+  if (h -> old_table) _chain_migrate (h, C_HASH_MIGRATE_BUCKETS);
+  find = _c_hash_find (h, &f, item);
+  if (!find) return C_HASH_ERROR_NOT_FOUND;
+
+  if (h -> garbage) h -> garbage (find, h -> context);
+  memcpy (find, item, h -> item_size);
+
+  return 0;
+}
+
+void *
+c_hash_find (C_HASH *h, void *item) {
+  _FIND f;
+  return _c_hash_find (h, &f, item);
+}
+
+/*
+ * touches the memory a find for the hash will start with, so that the cache
+ * misses for a batch of finds overlap instead of following one another
+ */
+static void
+_c_hash_prefetch (C_HASH *h, _HASH hash) {
+  switch (h -> type) {
+    case C_HASH_OPEN:
+    case C_HASH_ROBIN_HOOD:
+      __builtin_prefetch (_SLOT_AT (h, hash & (h -> table_size - 1)));
+      break;
+    case C_HASH_GROUP: {
+      int group = _H1 (hash) & (h -> table_size / _GROUP_WIDTH - 1);
+      __builtin_prefetch (h -> ctrl + group * _GROUP_WIDTH);
+      __builtin_prefetch (_SLOT_AT (h, group * _GROUP_WIDTH));
+      break;
+    }
+    default:
+      __builtin_prefetch (_chain_bucket (h, hash));
+  }
+}
+
+int
+c_hash_find_many (C_HASH *h, void **items, int count, void **results) {
+  _HASH hash [C_HASH_FIND_BATCH];
+  int found = 0;
+  int base, n, i;
+
+  for (base = 0; base < count; base += n) {
+    n = count - base < C_HASH_FIND_BATCH ? count - base : C_HASH_FIND_BATCH;
+
+    for (i = 0; i < n; i ++) {
+      hash [i] = _c_hash_calculate (h, items [base + i]);
+      _c_hash_prefetch (h, hash [i]);
+    }
+
+    /* a chained find goes on to the bucket's list, so fetch that too */
+    if (C_HASH_CHAINED == h -> type) {
+      for (i = 0; i < n; i ++) {
+        C_LIST *list = *_chain_bucket (h, hash [i]);
+        if (list) __builtin_prefetch (list);
+      }
+    }
+
+    for (i = 0; i < n; i ++) {
+      _FIND f;
+      void *find;
+      f.hash = hash [i];
+      find = _c_hash_find_hash (h, &f, items [base + i]);
+      results [base + i] = find;
+      if (find) found += 1;
+    }
+  }
+
+  return found;
+}
+
+void
+c_hash_remove (C_HASH *h, void *item) {
+  _FIND f;
+  void *find;
+
+  if (h -> old_table) _chain_migrate (h, C_HASH_MIGRATE_BUCKETS);
+  find = _c_hash_find (h, &f, item);
+
+  if (find) {
+    if (h -> garbage) h -> garbage (find, h -> context);
+    switch (h -> type) {
+      case C_HASH_OPEN: _open_remove (h, find); break;
+      case C_HASH_GROUP: _group_remove (h, find); break;
+      case C_HASH_ROBIN_HOOD: _robin_remove (h, find); break;
+      default: _chain_remove (h, &f, find);
+    }
+    h -> size -= 1;
+    if (h -> shrink_at) _c_hash_check_shrink (h);
+  }
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * iterator
+ * ---------------------------------------------------------------------------
+ */
+
+static int
+_itr_next_item (C_HASH *h) {
+
+  while (h -> itr_index < h -> table_size) {
+    C_LIST *list = h -> table [h -> itr_index ++];
+    if (list && c_list_first (list)) {
+      h -> itr_list = list;
+      h -> itr_position = c_list_first (list);
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static int
+_itr_init (void *ctx) {
+  C_HASH *h = (C_HASH *) ctx;
+  h -> itr_index = 0;
+  if (0 != _c_hash_check_rehash (h)) return 0; // safe time to try rehash
+  if (0 != _chain_migrate (h, h -> old_table_size)) return 0; // and finish
+  return _itr_next_item (h);
+}
+
+static int
+_itr_advance (void *ctx) {
+  C_HASH *h = (C_HASH *) ctx;
+  h -> itr_position = c_list_next (h -> itr_position);
+  if (h -> itr_position) return 1;
+  return _itr_next_item (h);
+}
+
+static void *
+_itr_retrieve (void *ctx) {
+  C_HASH *h = (C_HASH *) ctx;
+  _NODE *node = (_NODE *) c_list_value (h -> itr_position);
+  if (h -> extractor)
+    return h -> extractor ((void *) &node -> item);
+  return (void *) &node -> item;
+}
+
+static int
+_itr_remove (void *ctx) {
+  C_HASH *h = (C_HASH *) ctx;
+  C_LIST_POSITION *next = c_list_next (h -> itr_position);
+  _NODE *node = (_NODE *) c_list_value (h -> itr_position);
+
+  c_list_remove (h -> itr_list, h -> itr_position);
+  if (h -> garbage) h -> garbage (&node -> item, h -> context);
+  c_slab_release (h -> nodes, node);
+  h -> size -= 1;
+  h -> itr_position = next;
+  if (next) return 1;
+  return _itr_next_item (h);
+}
+
+/*
+ * open table iterator: itr_index is the slot most recently retrieved
+ */
+
+static int
+_itr_open_next_item (C_HASH *h) {
+
+  while (++ h -> itr_index < h -> table_size) {
+    if (_SLOT_FULL == _SLOT_AT (h, h -> itr_index) -> state) return 1;
+  }
+
+  return 0;
+}
+
+static int
+_itr_open_init (void *ctx) {
+  C_HASH *h = (C_HASH *) ctx;
+  h -> itr_index = -1;
+  if (0 != _c_hash_check_rehash (h)) return 0; // safe time to try rehash
+  return _itr_open_next_item (h);
+}
+
+static int
+_itr_open_advance (void *ctx) {
+  return _itr_open_next_item ((C_HASH *) ctx);
+}
+
+static void *
+_itr_open_retrieve (void *ctx) {
+  C_HASH *h = (C_HASH *) ctx;
+  _SLOT *slot = _SLOT_AT (h, h -> itr_index);
+  if (h -> extractor)
+    return h -> extractor ((void *) &slot -> item);
+  return (void *) &slot -> item;
+}
+
+static int
+_itr_open_remove (void *ctx) {
+  C_HASH *h = (C_HASH *) ctx;
+  _SLOT *slot = _SLOT_AT (h, h -> itr_index);
+  if (h -> garbage) h -> garbage (&slot -> item, h -> context);
+  slot -> state = _SLOT_DELETED;
+  h -> size -= 1;
+  return _itr_open_next_item (h);
+}
+
+/*
+ * group table iterator: as for the open table, but slot state is in ctrl
+ */
+
+static int
+_itr_group_next_item (C_HASH *h) {
+
+  while (++ h -> itr_index < h -> table_size) {
+    if (!(h -> ctrl [h -> itr_index] & 0x80)) return 1;
+  }
+
+  return 0;
+}
+
+static int
+_itr_group_init (void *ctx) {
+  C_HASH *h = (C_HASH *) ctx;
+  h -> itr_index = -1;
+  if (0 != _c_hash_check_rehash (h)) return 0; // safe time to try rehash
+  return _itr_group_next_item (h);
+}
+
+static int
+_itr_group_advance (void *ctx) {
+  return _itr_group_next_item ((C_HASH *) ctx);
+}
+
+static int
+_itr_group_remove (void *ctx) {
+  C_HASH *h = (C_HASH *) ctx;
+  _SLOT *slot = _SLOT_AT (h, h -> itr_index);
+  if (h -> garbage) h -> garbage (&slot -> item, h -> context);
+  _group_remove_index (h, h -> itr_index);
+  h -> size -= 1;
+  return _itr_group_next_item (h);
+}
+
+/*
+ * Robin Hood table iterator: a removal pulls the following items back one
+ * slot, possibly wrapping around the end of the table. The walk therefore
+ * starts just after an empty slot (there always is one) and ends there;
+ * no shift crosses an empty slot, and after a removal the same slot is
+ * looked at again, since it now holds the next item.
+ */
+
+static int
+_itr_robin_next_item (C_HASH *h) {
+  int mask = h -> table_size - 1;
+
+  while ((h -> itr_index = (h -> itr_index + 1) & mask) != h -> itr_start) {
+    if (_SLOT_AT (h, h -> itr_index) -> state) return 1;
+  }
+
+  return 0;
+}
+
+static int
+_itr_robin_init (void *ctx) {
+  C_HASH *h = (C_HASH *) ctx;
+  if (0 != _c_hash_check_rehash (h)) return 0; // safe time to try rehash
+  h -> itr_start = 0;
+  while (_SLOT_AT (h, h -> itr_start) -> state) h -> itr_start += 1;
+  h -> itr_index = h -> itr_start;
+  return _itr_robin_next_item (h);
+}
+
+static int
+_itr_robin_advance (void *ctx) {
+  return _itr_robin_next_item ((C_HASH *) ctx);
+}
+
+static int
+_itr_robin_remove (void *ctx) {
+  C_HASH *h = (C_HASH *) ctx;
+  _SLOT *slot = _SLOT_AT (h, h -> itr_index);
+  if (h -> garbage) h -> garbage (&slot -> item, h -> context);
+  _robin_remove_index (h, h -> itr_index);
+  h -> size -= 1;
+  if (slot -> state) return 1;
+  return _itr_robin_next_item (h);
+}
+
+C_ITERATOR *
+c_hash_iterator (C_HASH *h, C_HASH_ITERATOR_ITEM extract) {
+  C_ALLOCATOR *previous;
+
+  if (h -> iterator) {
+    c_iterator_reset (h -> iterator);
+    return h -> iterator;
+  }
+
+  h -> extractor = extract;
+  previous = c_allocator_set (h -> allocator);
+  if (C_HASH_GROUP == h -> type) {
+    h -> iterator = c_iterator_create (
+      _itr_group_init,
+      _itr_group_advance,
+      _itr_open_retrieve,
+      _itr_group_remove,
+      0,
+      (void *) h
+    );
+  } else if (C_HASH_ROBIN_HOOD == h -> type) {
+    h -> iterator = c_iterator_create (
+      _itr_robin_init,
+      _itr_robin_advance,
+      _itr_open_retrieve,
+      _itr_robin_remove,
+      0,
+      (void *) h
+    );
+  } else if (C_HASH_OPEN == h -> type) {
+    h -> iterator = c_iterator_create (
+      _itr_open_init,
+      _itr_open_advance,
+      _itr_open_retrieve,
+      _itr_open_remove,
+      0,
+      (void *) h
+    );
+  } else {
+    h -> iterator = c_iterator_create (
+      _itr_init,
+      _itr_advance,
+      _itr_retrieve,
+      _itr_remove,
+      0,
+      (void *) h
+    );
+  }
+  c_allocator_set (previous);
+  return h -> iterator;
+}
+
+/*
+ * walks leave the iterator (and the extractor it was created with) alone,
+ * so they can run while the caller is part way through an iteration
+ */
+static int
+_chain_walk (C_LIST **table, int from, int size, C_HASH_VISITOR visit,
+    void *context) {
+  int i, result;
+
+  for (i = from; i < size; i ++) {
+    C_LIST_POSITION *position;
+    if (!table [i]) continue;
+    for (position = c_list_first (table [i]); position;
+        position = c_list_next (position)) {
+      _NODE *node = (_NODE *) c_list_value (position);
+      result = visit (&node -> item, context);
+      if (result) return result;
+    }
+  }
+
+  return 0;
+}
+
+int
+c_hash_walk (C_HASH *h, C_HASH_VISITOR visit, void *context) {
+  int i, result;
+
+  if (C_HASH_CHAINED == h -> type) {
+    result = _chain_walk (h -> table, 0, h -> table_size, visit, context);
+    if (0 == result && h -> old_table)
+      result = _chain_walk (h -> old_table, h -> migrate_index,
+        h -> old_table_size, visit, context);
+    return result;
+  }
+
+  for (i = 0; i < h -> table_size; i ++) {
+    _SLOT *slot = _SLOT_AT (h, i);
+    switch (h -> type) {
+      case C_HASH_GROUP: if (h -> ctrl [i] & 0x80) continue; break;
+      case C_HASH_ROBIN_HOOD: if (!slot -> state) continue; break;
+      default: if (_SLOT_FULL != slot -> state) continue;
+    }
+    result = visit (&slot -> item, context);
+    if (result) return result;
+  }
+
+  return 0;
+}
+
+int
+c_hash_reserve (C_HASH *h, int count) {
+  int size = _c_hash_initial_size (h, count);
+  if (size < 0) return C_HASH_ERROR_MEMORY;
+  if (size <= h -> table_size) return 0;
+  return _c_hash_resize (h, size);
+}
+
+int
+c_hash_shrink_to_fit (C_HASH *h) {
+  int size = _c_hash_initial_size (h, h -> size);
+
+  if (size < 0) size = h -> table_size; // grown as far as it can
+  if (size < h -> table_size || h -> used > h -> size || h -> old_table)
+    if (_c_hash_resize (h, size)) return C_HASH_ERROR_MEMORY;
+
+  /* and give back the chained table's emptied slab chunks */
+  if (C_HASH_CHAINED == h -> type)
+    if (c_slab_trim (h -> nodes) || c_slab_trim (h -> items) ||
+        c_slab_trim (h -> lists)) return C_HASH_ERROR_MEMORY;
+
+  return 0;
+}
+
+int
+c_hash_size (C_HASH *h) {
+  return h -> size;
+}
+
+int
+c_hash_table_size (C_HASH *h) {
+  return h -> table_size;
+}
+
+/*
+ * a snapshot is this header followed by the items, each item_size bytes,
+ * in the machine's own byte order
+ */
+typedef struct _SNAPSHOT {
+  char magic [8];
+  unsigned int order;
+  unsigned int item_size;
+  unsigned long long count;
+  unsigned long long reserved;
+} _SNAPSHOT;
+
+#define C_HASH_SNAPSHOT_MAGIC "C_HASH\0\1"
+#define C_HASH_SNAPSHOT_ORDER 0x01020304
+#define C_HASH_SNAPSHOT_BLOCK 65536 // bytes staged per write or read
+
+typedef int (*_WRITE) (void *context, char *data, size_t length);
+typedef long (*_READ) (void *context, char *data, size_t length);
+
+typedef struct _STAGE {
+  C_HASH *h;
+  _WRITE output;
+  void *context;
+  char *block;
+  size_t used;
+  size_t per_block;
+} _STAGE;
+
+static int
+_snapshot_item (void *item, void *context) {
+  _STAGE *stage = (_STAGE *) context;
+  size_t item_size = stage -> h -> item_size;
+  int result = 0;
+
+  memcpy (stage -> block + stage -> used * item_size, item, item_size);
+  if (++ stage -> used == stage -> per_block) {
+    result = stage -> output (stage -> context, stage -> block,
+      stage -> used * item_size);
+    stage -> used = 0;
+  }
+  return result;
+}
+
+/*
+ * items are copied into a block of whole items, written out whenever full
+ */
+static int
+_c_hash_snapshot (C_HASH *h, _WRITE output, void *context) {
+  _SNAPSHOT header;
+  _STAGE stage;
+  int result;
+
+  memset (&header, 0x00, sizeof (header));
+  memcpy (header.magic, C_HASH_SNAPSHOT_MAGIC, sizeof (header.magic));
+  header.order = C_HASH_SNAPSHOT_ORDER;
+  header.item_size = h -> item_size;
+  header.count = h -> size;
+  result = output (context, (char *) &header, sizeof (header));
+  if (result) return result;
+
+  stage.h = h;
+  stage.output = output;
+  stage.context = context;
+  stage.used = 0;
+  stage.per_block = C_HASH_SNAPSHOT_BLOCK / h -> item_size + 1;
+  stage.block = (char *) c_allocator_alloc (h -> allocator,
+    stage.per_block * h -> item_size);
+  if (!stage.block) return C_HASH_ERROR_MEMORY;
+
+  result = c_hash_walk (h, _snapshot_item, &stage);
+  if (0 == result && stage.used)
+    result = output (context, stage.block, stage.used * h -> item_size);
+
+  c_allocator_free (h -> allocator, stage.block);
+  return result;
+}
+
+/*
+ * reads exactly length bytes unless the input ends first
+ */
+static long
+_read_full (_READ input, void *context, char *data, size_t length) {
+  size_t total = 0;
+  long n;
+
+  while (total < length) {
+    n = input (context, data + total, length - total);
+    if (n < 0) return n;
+    if (0 == n) break;
+    total += n;
+  }
+
+  return total;
+}
+
+static int
+_c_hash_restore (C_HASH *h, _READ input, void *context) {
+  size_t per_block = C_HASH_SNAPSHOT_BLOCK / h -> item_size + 1;
+  unsigned long long remaining;
+  _SNAPSHOT header;
+  char *block;
+  long n;
+  int result = 0;
+  size_t i;
+
+  if (h -> size) return C_HASH_ERROR_DUPLICATE;
+
+  n = _read_full (input, context, (char *) &header, sizeof (header));
+  if (n < 0) return C_HASH_ERROR_IO;
+  if (n != sizeof (header) ||
+      memcmp (header.magic, C_HASH_SNAPSHOT_MAGIC, sizeof (header.magic)) ||
+      header.order != C_HASH_SNAPSHOT_ORDER ||
+      header.item_size != h -> item_size ||
+      header.count > 0x7fffffff) return C_HASH_ERROR_FORMAT;
+
+  if (c_hash_reserve (h, (int) header.count)) return C_HASH_ERROR_MEMORY;
+  block = (char *) c_allocator_alloc (h -> allocator,
+    per_block * h -> item_size);
+  if (!block) return C_HASH_ERROR_MEMORY;
+
+  for (remaining = header.count; 0 == result && remaining; ) {
+    size_t count = remaining < per_block ? remaining : per_block;
+    n = _read_full (input, context, block, count * h -> item_size);
+    if (n < 0) result = C_HASH_ERROR_IO;
+    else if ((size_t) n != count * h -> item_size) result = C_HASH_ERROR_FORMAT;
+    for (i = 0; 0 == result && i < count; i ++)
+      result = c_hash_insert_unique (h, block + i * h -> item_size);
+    remaining -= count;
+  }
+
+  c_allocator_free (h -> allocator, block);
+  return result;
+}
+
+static int
+_buffer_write (void *context, char *data, size_t length) {
+  return c_buffer_append ((C_BUFFER *) context, data, (int) length) ?
+    C_HASH_ERROR_MEMORY : 0;
+}
+
+typedef struct _BUFFER_READ {
+  C_BUFFER *buffer;
+  int offset;
+} _BUFFER_READ;
+
+static long
+_buffer_read (void *context, char *data, size_t length) {
+  _BUFFER_READ *r = (_BUFFER_READ *) context;
+  size_t available = c_buffer_length (r -> buffer) - r -> offset;
+
+  if (length > available) length = available;
+  memcpy (data, c_buffer_get (r -> buffer) + r -> offset, length);
+  r -> offset += length;
+  return length;
+}
+
+static int
+_fd_write (void *context, char *data, size_t length) {
+  int fd = *(int *) context;
+  ssize_t n;
+
+  while (length) {
+    n = write (fd, data, length);
+    if (n < 0 && EINTR == errno) continue;
+    if (n <= 0) return C_HASH_ERROR_IO;
+    data += n;
+    length -= n;
+  }
+
+  return 0;
+}
+
+static long
+_fd_read (void *context, char *data, size_t length) {
+  int fd = *(int *) context;
+  ssize_t n;
+
+  do n = read (fd, data, length); while (n < 0 && EINTR == errno);
+  return n;
+}
+
+int
+c_hash_snapshot (C_HASH *h, C_BUFFER *b) {
+  size_t total = sizeof (_SNAPSHOT) + (size_t) h -> size * h -> item_size;
+
+  if (total + c_buffer_length (b) > 0x7fffffff) return C_HASH_ERROR_MEMORY;
+  if (c_buffer_require (b, c_buffer_length (b) + (int) total))
+    return C_HASH_ERROR_MEMORY;
+  return _c_hash_snapshot (h, _buffer_write, b);
+}
+
+int
+c_hash_restore (C_HASH *h, C_BUFFER *b) {
+  _BUFFER_READ r = {b, 0};
+  int result = _c_hash_restore (h, _buffer_read, &r);
+
+  if (0 == result) c_buffer_shift (b, r.offset);
+  return result;
+}
+
+int
+c_hash_snapshot_fd (C_HASH *h, int fd) {
+  return _c_hash_snapshot (h, _fd_write, &fd);
+}
+
+int
+c_hash_restore_fd (C_HASH *h, int fd) {
+  return _c_hash_restore (h, _fd_read, &fd);
 }
@@ -1,8 +1,10 @@
 #include "stdlib.h"
 #include "string.h"
+#include "c_allocator.h"
 #include "c_iterator.h"
 
 struct C_ITERATOR {
+  C_ALLOCATOR *allocator;
   void *context;
   unsigned char init;
   unsigned char ready;
@@ -23,8 +25,12 @@ C_ITERATOR *c_iterator_create (
     void (*free) (void *),
     void *context
     ){
-  C_ITERATOR *i = (C_ITERATOR *) malloc (sizeof (C_ITERATOR));
+  C_ALLOCATOR *allocator = c_allocator_get ();
+  C_ITERATOR *i = (C_ITERATOR *) c_allocator_alloc (allocator,
+    sizeof (C_ITERATOR));
+  if (!i) return NULL;
   memset (i, 0x00, sizeof (C_ITERATOR));
+  i -> allocator = allocator;
   i -> initialize = init;
   i -> advance = advance;
   i -> retrieve = retrieve;
@@ -39,7 +45,7 @@ c_iterator_free (C_ITERATOR *i) {
   if (i) {
     if (i -> free)
       (*i -> free) (i -> context);
-    free (i);
+    c_allocator_free (i -> allocator, i);
   }
 }
 
@@ -1,12 +1,14 @@
 #include <string.h>
 #include <stdlib.h>
 
+#include "c_allocator.h"
 #include "c_hash.h"
 #include "c_keyedset.h"
 
 #include "hash_func.h"
 
 struct C_KEYEDSET {
+  C_ALLOCATOR *allocator;
   unsigned int key; // next available key value
   C_HASH *table;    // underlying hash table
 };
@@ -42,9 +44,11 @@ c_keyedset_create (void) {
   C_HASH *h = c_hash_create (sizeof (_C_ITEM), _calc, _compare, NULL, NULL);
 
   if (h) {
-    k = (C_KEYEDSET *) malloc (sizeof (C_KEYEDSET));
+    C_ALLOCATOR *allocator = c_allocator_get ();
+    k = (C_KEYEDSET *) c_allocator_alloc (allocator, sizeof (C_KEYEDSET));
     if (k) {
       memset (k, 0x00, sizeof (C_KEYEDSET));
+      k -> allocator = allocator;
       k -> key = 1;
       k -> table = h;
     } else {
@@ -59,7 +63,7 @@ void
 c_keyedset_free (C_KEYEDSET *k) {
   if (k) {
     c_hash_free (k -> table);
-    free (k);
+    c_allocator_free (k -> allocator, k);
   }
 }
 
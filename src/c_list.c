@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "c_list.h"
+#include "c_slab.h"
 
 typedef struct LISTITEM LISTITEM;
 struct LISTITEM {
@@ -16,6 +17,9 @@ struct C_LIST {
   int size;
   C_ITERATOR *iterator;
   LISTITEM *current;
+  C_SLAB *slab;      // LISTITEMs come from here
+  int own_slab;
+  C_SLAB *lists;     // the C_LIST came from here (c_list_create_slabs)
 };
 
 static int
@@ -38,11 +42,10 @@ _itr_retrieve (void *ctx) {
   return l -> current -> value;
 }
 
-static int
-_itr_remove (void *ctx) {
-  C_LIST *l = (C_LIST *) ctx;
-  LISTITEM *next = l -> current -> next;
-  LISTITEM *prev = l -> current -> prev;
+static void
+_list_unlink (C_LIST *l, LISTITEM *i) {
+  LISTITEM *next = i -> next;
+  LISTITEM *prev = i -> prev;
   
   if (!prev) {
     l -> head = next;
@@ -56,15 +59,24 @@ _itr_remove (void *ctx) {
     next -> prev = prev;
   }
 
-  free (l -> current);
-  l -> current = next;
+  c_slab_release (l -> slab, i);
   l -> size -= 1;
+}
+
+static int
+_itr_remove (void *ctx) {
+  C_LIST *l = (C_LIST *) ctx;
+  LISTITEM *next = l -> current -> next;
+
+  _list_unlink (l, l -> current);
+  l -> current = next;
   return l -> current ? 1 : 0;
 }
 
-static void
+static int
 _list_add (C_LIST *l, void *value, int append) {
-  LISTITEM *i = (LISTITEM *) malloc (sizeof (LISTITEM));
+  LISTITEM *i = (LISTITEM *) c_slab_alloc (l -> slab);
+  if (!i) return -1;
 
   memset (i, 0x00, sizeof (LISTITEM));
   i -> value = value;
@@ -82,6 +94,7 @@ _list_add (C_LIST *l, void *value, int append) {
     }
   }
   l -> size += 1;
+  return 0;
 }
 
 static void *
@@ -102,17 +115,55 @@ _list_take (C_LIST *l, int first) {
   }
 
   value = i -> value;
-  free (i);
+  c_slab_release (l -> slab, i);
   l -> size -= 1;
 
   return value;
 }
 
+C_SLAB *
+c_list_slab_create (void) {
+  return c_slab_create (sizeof (LISTITEM));
+}
+
 C_LIST *
-c_list_create (void) {
-  C_LIST *l = (C_LIST *) malloc (sizeof (C_LIST));
+c_list_create_slab (C_SLAB *slab) {
+  C_LIST *l = (C_LIST *) c_allocator_alloc (c_slab_allocator (slab),
+    sizeof (C_LIST));
+  if (l) {
+    memset (l, 0x00, sizeof (C_LIST));
+    l -> slab = slab;
+  }
+  return l;
+}
+
+C_SLAB *
+c_list_header_slab_create (void) {
+  return c_slab_create (sizeof (C_LIST));
+}
+
+C_LIST *
+c_list_create_slabs (C_SLAB *slab, C_SLAB *lists) {
+  C_LIST *l = (C_LIST *) c_slab_alloc (lists);
   if (l) {
     memset (l, 0x00, sizeof (C_LIST));
+    l -> slab = slab;
+    l -> lists = lists;
+  }
+  return l;
+}
+
+C_LIST *
+c_list_create (void) {
+  C_SLAB *slab = c_list_slab_create ();
+  C_LIST *l = NULL;
+  if (slab) {
+    l = c_list_create_slab (slab);
+    if (l) {
+      l -> own_slab = 1;
+    } else {
+      c_slab_free (slab);
+    }
   }
   return l;
 }
@@ -122,24 +173,33 @@ c_list_free (C_LIST *l) {
   LISTITEM *i;
 
   if (l) {
-    for (i = l -> head; i; i = l -> head) {
-      l -> head = i -> next;
-      free (i);
+    C_SLAB *slab = l -> slab;
+    int own_slab = l -> own_slab;
+    if (!own_slab) {
+      for (i = l -> head; i; i = l -> head) {
+        l -> head = i -> next;
+        c_slab_release (slab, i);
+      }
     }
     c_iterator_free (l -> iterator);
-    free (l);
+    if (l -> lists) {
+      c_slab_release (l -> lists, l);
+    } else {
+      c_allocator_free (c_slab_allocator (slab), l);
+    }
+    if (own_slab) c_slab_free (slab);
   }
 
 }
 
-void
+int
 c_list_add (C_LIST *l, void *value) {
-  _list_add (l, value, 1);
+  return _list_add (l, value, 1);
 }
 
-void
+int
 c_list_add_first (C_LIST *l, void *value) {
-  _list_add (l, value, 0);
+  return _list_add (l, value, 0);
 }
 
 void *
@@ -152,11 +212,32 @@ c_list_take_last (C_LIST *l) {
   return _list_take (l, 0);
 }
 
+C_LIST_POSITION *
+c_list_first (C_LIST *l) {
+  return (C_LIST_POSITION *) l -> head;
+}
+
+C_LIST_POSITION *
+c_list_next (C_LIST_POSITION *p) {
+  return (C_LIST_POSITION *) ((LISTITEM *) p) -> next;
+}
+
+void *
+c_list_value (C_LIST_POSITION *p) {
+  return ((LISTITEM *) p) -> value;
+}
+
+void
+c_list_remove (C_LIST *l, C_LIST_POSITION *p) {
+  _list_unlink (l, (LISTITEM *) p);
+}
+
 C_ITERATOR *
 c_list_iterator (C_LIST *l) {
   if (l -> iterator) {
     c_iterator_reset (l -> iterator);
   } else {
+    C_ALLOCATOR *previous = c_allocator_set (c_slab_allocator (l -> slab));
     l -> iterator = c_iterator_create (
       _itr_init,
       _itr_advance,
@@ -165,6 +246,7 @@ c_list_iterator (C_LIST *l) {
       0,
       (void *) l
     );
+    c_allocator_set (previous);
   }
   return l -> iterator;
 }
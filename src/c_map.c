@@ -1,17 +1,48 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "c_allocator.h"
 #include "c_hash.h"
 #include "c_map.h"
+#include "c_mph.h"
+#include "c_symbol.h"
 #include "hash_func.h"
 
 struct C_MAP {
+  C_ALLOCATOR *allocator;
   C_MAP_CALCULATOR calculator;
+  C_MAP_CALCULATOR64 calculator64;
+  C_MAP_KEYED_CALCULATOR keyed;
+  unsigned char seed [HASH_FUNC_KEY_SIZE]; // secret key for keyed
   C_MAP_COMPARATOR comparator;
   C_MAP_GARBAGE garbage;
   C_HASH *table;
 };
 
+/*
+ * a C_FROZEN_MAP keeps its pairs in c_mph_find order, each with the hash
+ * value of its key so that most misses never reach the comparator
+ */
+typedef struct _FROZEN {
+  unsigned long long hash;
+  C_MAPITEM item;
+} _FROZEN;
+
+struct C_FROZEN_MAP {
+  C_ALLOCATOR *allocator;
+  C_MAP_CALCULATOR calculator;
+  C_MAP_CALCULATOR64 calculator64;
+  C_MAP_KEYED_CALCULATOR keyed;
+  unsigned char seed [HASH_FUNC_KEY_SIZE];
+  C_MAP_COMPARATOR comparator;
+  C_MAP_GARBAGE garbage;
+  C_MPH *mph;
+  _FROZEN *entries;
+  int size;
+};
+
+#define C_MAP_FIND_BATCH 64 // keys handed to c_hash_find_many at a time
+
 static unsigned int
 _calc (void *item, void *context) {
   C_MAP *m = (C_MAP *) context;
@@ -19,6 +50,31 @@ _calc (void *item, void *context) {
   return m -> calculator (i -> key); // C_MAPITEM to key
 }
 
+static unsigned long long
+_calc64 (void *item, void *context) {
+  C_MAP *m = (C_MAP *) context;
+  C_MAPITEM *i = (C_MAPITEM *) item;
+  return m -> calculator64 (i -> key);
+}
+
+static unsigned long long
+_calc_keyed (void *item, void *context) {
+  C_MAP *m = (C_MAP *) context;
+  C_MAPITEM *i = (C_MAPITEM *) item;
+  return m -> keyed (i -> key, m -> seed);
+}
+
+/*
+ * the hash value a C_MAP (or C_FROZEN_MAP) gives a key
+ */
+static unsigned long long
+_key_hash (C_MAP_CALCULATOR cal, C_MAP_CALCULATOR64 cal64,
+    C_MAP_KEYED_CALCULATOR keyed, const unsigned char *seed, void *key) {
+  if (keyed) return keyed (key, seed);
+  if (cal64) return cal64 (key);
+  return cal (key);
+}
+
 static int
 _compare (void *item1, void *item2, void *context) {
   C_MAP *m = (C_MAP *) context;
@@ -52,39 +108,133 @@ _value_extractor (void *item) {
   return i -> value;
 }
 
-C_MAP *
-c_map_create (C_MAP_CALCULATOR cal, C_MAP_COMPARATOR com,
-    C_MAP_GARBAGE garbage) {
+static C_MAP *
+_c_map_create (C_MAP_CALCULATOR cal, C_MAP_CALCULATOR64 cal64,
+    C_MAP_KEYED_CALCULATOR keyed, C_MAP_COMPARATOR com, C_MAP_GARBAGE garbage,
+    int expected) {
 
-  C_MAP *m = (C_MAP *) malloc (sizeof (C_MAP));
+  C_ALLOCATOR *allocator = c_allocator_get ();
+  C_MAP *m = (C_MAP *) c_allocator_alloc (allocator, sizeof (C_MAP));
   if (m) {
     memset (m, 0x00, sizeof (C_MAP));
+    m -> allocator = allocator;
     m -> calculator = cal;
+    m -> calculator64 = cal64;
+    m -> keyed = keyed;
     m -> comparator = com;
     m -> garbage = garbage;
-    m -> table = c_hash_create (
-      sizeof (C_MAPITEM),
-      _calc,
-      _compare,
-      _garbage,
-      (void *) m
-    );
+    if (keyed) {
+      hash_func_random_key (m -> seed);
+      m -> table = c_hash_create64 (sizeof (C_MAPITEM), _calc_keyed, _compare,
+        _garbage, (void *) m, expected, C_HASH_CHAINED, NULL);
+    } else if (cal64) {
+      m -> table = c_hash_create64 (sizeof (C_MAPITEM), _calc64, _compare,
+        _garbage, (void *) m, expected, C_HASH_CHAINED, NULL);
+    } else {
+      m -> table = c_hash_create_base (
+        sizeof (C_MAPITEM),
+        _calc,
+        _compare,
+        _garbage,
+        (void *) m,
+        expected,
+        C_HASH_CHAINED
+      );
+    }
+    if (!m -> table) {
+      c_allocator_free (allocator, m);
+      m = NULL;
+    }
   }
 
   return m;
 }
 
+C_MAP *
+c_map_create_size (C_MAP_CALCULATOR cal, C_MAP_COMPARATOR com,
+    C_MAP_GARBAGE garbage, int expected) {
+  return _c_map_create (cal, NULL, NULL, com, garbage, expected);
+}
+
+C_MAP *
+c_map_create64 (C_MAP_CALCULATOR64 cal, C_MAP_COMPARATOR com,
+    C_MAP_GARBAGE garbage, int expected) {
+  return _c_map_create (NULL, cal, NULL, com, garbage, expected);
+}
+
+C_MAP *
+c_map_create_keyed (C_MAP_KEYED_CALCULATOR cal, C_MAP_COMPARATOR com,
+    C_MAP_GARBAGE garbage, int expected) {
+  return _c_map_create (NULL, NULL, cal, com, garbage, expected);
+}
+
+C_MAP *
+c_map_create (C_MAP_CALCULATOR cal, C_MAP_COMPARATOR com,
+    C_MAP_GARBAGE garbage) {
+  return c_map_create_size (cal, com, garbage, 0);
+}
+
+C_MAP *
+c_map_dict_create_size (C_MAP_GARBAGE garbage, int expected) {
+  return c_map_create_size (hash_string_calculator, hash_string_comparator,
+    garbage, expected);
+}
+
+C_MAP *
+c_map_dict_create64 (C_MAP_GARBAGE garbage, int expected) {
+  return c_map_create64 (hash_string_calculator64, hash_string_comparator,
+    garbage, expected);
+}
+
+static unsigned long long
+_symbol_calculator (void *key) {
+  return c_symbol_hash ((const char *) key);
+}
+
+static int
+_symbol_comparator (void *k1, void *k2) {
+  return k1 != k2;
+}
+
+C_MAP *
+c_map_symbol_create (C_MAP_GARBAGE garbage, int expected) {
+  return c_map_create64 (_symbol_calculator, _symbol_comparator, garbage,
+    expected);
+}
+
+C_MAP *
+c_map_dict_create_keyed (C_MAP_GARBAGE garbage, int expected) {
+  return c_map_create_keyed (hash_string_keyed_calculator,
+    hash_string_comparator, garbage, expected);
+}
+
+C_MAP *
+c_map_length_dict_create (C_MAP_GARBAGE garbage, int expected) {
+  return c_map_create_size (hash_length_string_calculator,
+    hash_length_string_comparator, garbage, expected);
+}
+
+C_MAP *
+c_map_nocase_dict_create_size (C_MAP_GARBAGE garbage, int expected) {
+  return c_map_create_size (hash_nocase_string_calculator,
+    hash_nocase_string_comparator, garbage, expected);
+}
+
+C_MAP *
+c_map_nocase_dict_create (C_MAP_GARBAGE garbage) {
+  return c_map_nocase_dict_create_size (garbage, 0);
+}
+
 C_MAP *
 c_map_dict_create (C_MAP_GARBAGE garbage) {
-  return c_map_create (hash_string_calculator, hash_string_comparator,
-    garbage);
+  return c_map_dict_create_size (garbage, 0);
 }
 
 void
 c_map_free (C_MAP *m) {
   if (m) {
     c_hash_free (m -> table);
-    free (m);
+    c_allocator_free (m -> allocator, m);
   }
 }
 
@@ -133,6 +283,31 @@ c_map_find_key (C_MAP *m, void *key) {
   return item ? item -> key : NULL;
 }
 
+int
+c_map_find_many (C_MAP *m, void **keys, int count, void **values) {
+  C_MAPITEM find [C_MAP_FIND_BATCH];
+  void *items [C_MAP_FIND_BATCH];
+  void *results [C_MAP_FIND_BATCH];
+  int found = 0;
+  int base, n, i;
+
+  for (base = 0; base < count; base += n) {
+    n = count - base < C_MAP_FIND_BATCH ? count - base : C_MAP_FIND_BATCH;
+    for (i = 0; i < n; i ++) {
+      find [i].key = keys [base + i];
+      find [i].value = NULL;
+      items [i] = &find [i];
+    }
+    found += c_hash_find_many (m -> table, items, n, results);
+    for (i = 0; i < n; i ++) {
+      C_MAPITEM *item = (C_MAPITEM *) results [i];
+      values [base + i] = item ? item -> value : NULL;
+    }
+  }
+
+  return found;
+}
+
 int
 c_map_exists (C_MAP *m, void *key) {
   return NULL != _c_map_find (m, key);
@@ -159,7 +334,247 @@ c_map_value_iterator (C_MAP *m) {
   return c_hash_iterator (m -> table, _value_extractor);
 }
 
+typedef struct _VISIT {
+  C_MAP_VISITOR visit;
+  void *context;
+} _VISIT;
+
+static int
+_visit_pair (void *item, void *context) {
+  _VISIT *v = (_VISIT *) context;
+  C_MAPITEM *pair = (C_MAPITEM *) item;
+  return v -> visit (pair -> key, pair -> value, v -> context);
+}
+
+int
+c_map_walk (C_MAP *m, C_MAP_VISITOR visit, void *context) {
+  _VISIT v;
+  v.visit = visit;
+  v.context = context;
+  return c_hash_walk (m -> table, _visit_pair, &v);
+}
+
+int
+c_map_reserve (C_MAP *m, int count) {
+  return c_hash_reserve (m -> table, count);
+}
+
+int
+c_map_shrink_to_fit (C_MAP *m) {
+  return c_hash_shrink_to_fit (m -> table);
+}
+
 int
 c_map_size (C_MAP *m) {
   return c_hash_size (m -> table);
 }
+
+int
+c_map_table_size (C_MAP *m) {
+  return c_hash_table_size (m -> table);
+}
+
+/*
+ * a C_MAP snapshot is this header followed by the pairs, as the C_MAP_WRITER
+ * wrote them
+ */
+typedef struct _SNAPSHOT {
+  char magic [8];
+  unsigned int order;
+  unsigned int unused;
+  unsigned long long count;
+} _SNAPSHOT;
+
+#define C_MAP_SNAPSHOT_MAGIC "C_MAP\0\0\1"
+#define C_MAP_SNAPSHOT_ORDER 0x01020304
+
+typedef struct _WRITE {
+  C_BUFFER *b;
+  C_MAP_WRITER writer;
+} _WRITE;
+
+static int
+_snapshot_pair (void *item, void *context) {
+  _WRITE *w = (_WRITE *) context;
+  C_MAPITEM *pair = (C_MAPITEM *) item;
+  return w -> writer (w -> b, pair -> key, pair -> value);
+}
+
+int
+c_map_snapshot (C_MAP *m, C_BUFFER *b, C_MAP_WRITER writer) {
+  _SNAPSHOT header;
+  _WRITE w;
+
+  memset (&header, 0x00, sizeof (header));
+  memcpy (header.magic, C_MAP_SNAPSHOT_MAGIC, sizeof (header.magic));
+  header.order = C_MAP_SNAPSHOT_ORDER;
+  header.count = c_map_size (m);
+  if (c_buffer_append (b, (char *) &header, sizeof (header)))
+    return C_HASH_ERROR_MEMORY;
+
+  w.b = b;
+  w.writer = writer;
+  if (c_hash_walk (m -> table, _snapshot_pair, &w)) return C_HASH_ERROR_MEMORY;
+
+  return 0;
+}
+
+int
+c_map_restore (C_MAP *m, C_BUFFER *b, C_MAP_READER reader) {
+  int length = c_buffer_length (b);
+  char *data = c_buffer_get (b);
+  int offset = sizeof (_SNAPSHOT);
+  unsigned long long i;
+  _SNAPSHOT header;
+  C_MAPITEM item;
+  int used;
+
+  if (c_map_size (m)) return C_HASH_ERROR_DUPLICATE;
+  if (length < (int) sizeof (header)) return C_HASH_ERROR_FORMAT;
+  memcpy (&header, data, sizeof (header));
+  if (memcmp (header.magic, C_MAP_SNAPSHOT_MAGIC, sizeof (header.magic)) ||
+      header.order != C_MAP_SNAPSHOT_ORDER ||
+      header.count > (unsigned long long) length) return C_HASH_ERROR_FORMAT;
+
+  if (c_map_reserve (m, (int) header.count)) return C_HASH_ERROR_MEMORY;
+  for (i = 0; i < header.count; i ++) {
+    used = reader (data + offset, length - offset, &item.key, &item.value);
+    if (used < 0 || used > length - offset) return C_HASH_ERROR_FORMAT;
+    offset += used;
+    if (c_hash_insert_unique (m -> table, &item)) {
+      if (m -> garbage) m -> garbage (item.key, item.value);
+      return C_HASH_ERROR_MEMORY;
+    }
+  }
+
+  c_buffer_shift (b, offset);
+  return 0;
+}
+
+typedef struct _COLLECT {
+  C_MAP *m;
+  C_MAPITEM *items;
+  unsigned long long *hashes;
+  int count;
+} _COLLECT;
+
+static int
+_collect_pair (void *item, void *context) {
+  _COLLECT *c = (_COLLECT *) context;
+  C_MAPITEM *pair = (C_MAPITEM *) item;
+  c -> items [c -> count] = *pair;
+  c -> hashes [c -> count ++] = _key_hash (c -> m -> calculator,
+    c -> m -> calculator64, c -> m -> keyed, c -> m -> seed, pair -> key);
+  return 0;
+}
+
+C_FROZEN_MAP *
+c_map_freeze (C_MAP *m) {
+
+  C_ALLOCATOR *allocator = m -> allocator; // m is freed on success
+  int count = c_map_size (m);
+  C_FROZEN_MAP *f;
+  unsigned long long *hashes;
+  C_MAPITEM *items;
+  int *order;
+  int i;
+
+  f = (C_FROZEN_MAP *) c_allocator_alloc (allocator,
+    sizeof (C_FROZEN_MAP));
+  if (!f) return NULL;
+  memset (f, 0x00, sizeof (C_FROZEN_MAP));
+  f -> allocator = allocator;
+  f -> calculator = m -> calculator;
+  f -> calculator64 = m -> calculator64;
+  f -> keyed = m -> keyed;
+  memcpy (f -> seed, m -> seed, HASH_FUNC_KEY_SIZE);
+  f -> comparator = m -> comparator;
+  f -> size = count;
+
+  hashes = (unsigned long long *) c_allocator_alloc (allocator,
+    (count + 1) * sizeof (unsigned long long));
+  items = (C_MAPITEM *) c_allocator_alloc (allocator,
+    (count + 1) * sizeof (C_MAPITEM));
+  order = (int *) c_allocator_alloc (allocator, (count + 1) * sizeof (int));
+  f -> entries = (_FROZEN *) c_allocator_alloc (allocator,
+    (count + 1) * sizeof (_FROZEN));
+
+  if (hashes && items && order && f -> entries) {
+    _COLLECT collect = { m, items, hashes, 0 };
+    c_hash_walk (m -> table, _collect_pair, &collect);
+    f -> mph = c_mph_create (hashes, count, order);
+  }
+
+  if (f -> mph) {
+    for (i = 0; i < count; i ++) {
+      f -> entries [i].hash = hashes [order [i]];
+      f -> entries [i].item = items [order [i]];
+    }
+
+    /* the pairs now belong to the C_FROZEN_MAP */
+    f -> garbage = m -> garbage;
+    m -> garbage = NULL;
+    c_map_free (m);
+  } else {
+    c_allocator_free (f -> allocator, f -> entries);
+    c_allocator_free (f -> allocator, f);
+    f = NULL;
+  }
+
+  c_allocator_free (allocator, hashes);
+  c_allocator_free (allocator, items);
+  c_allocator_free (allocator, order);
+
+  return f;
+}
+
+void
+c_frozen_map_free (C_FROZEN_MAP *f) {
+  int i;
+
+  if (f) {
+    if (f -> garbage)
+      for (i = 0; i < f -> size; i ++)
+        f -> garbage (f -> entries [i].item.key, f -> entries [i].item.value);
+    c_mph_free (f -> mph);
+    c_allocator_free (f -> allocator, f -> entries);
+    c_allocator_free (f -> allocator, f);
+  }
+}
+
+static C_MAPITEM *
+_c_frozen_map_find (C_FROZEN_MAP *f, void *key) {
+  unsigned long long hash = _key_hash (f -> calculator, f -> calculator64,
+    f -> keyed, f -> seed, key);
+  int count, i = c_mph_find (f -> mph, hash, &count);
+
+  for (count += i; i < count; i ++) {
+    _FROZEN *e = f -> entries + i;
+    if (e -> hash == hash && 0 == f -> comparator (e -> item.key, key))
+      return &e -> item;
+  }
+
+  return NULL;
+}
+
+void *
+c_frozen_map_find (C_FROZEN_MAP *f, void *key) {
+  C_MAPITEM *item = _c_frozen_map_find (f, key);
+  return item ? item -> value : NULL;
+}
+
+void *
+c_frozen_map_find_key (C_FROZEN_MAP *f, void *key) {
+  C_MAPITEM *item = _c_frozen_map_find (f, key);
+  return item ? item -> key : NULL;
+}
+
+C_MAPITEM *
+c_frozen_map_item (C_FROZEN_MAP *f, int index) {
+  return index >= 0 && index < f -> size ? &f -> entries [index].item : NULL;
+}
+
+int
+c_frozen_map_size (C_FROZEN_MAP *f) {
+  return f -> size;
+}
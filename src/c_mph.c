@@ -0,0 +1,336 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_allocator.h"
+#include "c_mph.h"
+
+struct C_MPH {
+  C_ALLOCATOR *allocator;
+  int mapped;                 // arrays belong to an image, see c_mph_map
+  int size;                   // entries
+  int slots;                  // distinct hash values, one position each
+  int buckets;
+  unsigned int *displacement; // one per bucket
+  int *first;                 // NULL unless hash values repeat, see _order
+};
+
+#define C_MPH_BUCKET_SIZE 4 // average values per bucket
+#define C_MPH_ATTEMPTS 4    // doubling the buckets each time
+
+/*
+ * an image is this header followed by the displacements and, if the
+ * header says so, the first array
+ */
+typedef struct _IMAGE {
+  int size;
+  int slots;
+  int buckets;
+  int first;
+} _IMAGE;
+
+typedef struct _PAIR {
+  unsigned long long hash;
+  int index;
+} _PAIR;
+
+/*
+ * hash values from 32-bit calculators have nothing in their high half, so
+ * every value is mixed (with the splitmix64 finalizer, a bijection) first
+ */
+static unsigned long long
+_mix (unsigned long long x) {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+static int
+_bucket (int buckets, unsigned long long mixed) {
+  return (int) (((mixed >> 32) * (unsigned long long) buckets) >> 32);
+}
+
+static int
+_slot (int slots, unsigned long long mixed, unsigned int displacement) {
+  unsigned long long x = _mix (mixed + displacement * 0x9e3779b97f4a7c15ULL);
+  return (int) (((x & 0xffffffffULL) * (unsigned long long) slots) >> 32);
+}
+
+static int
+_compare (const void *p1, const void *p2) {
+  const _PAIR *a = (const _PAIR *) p1;
+  const _PAIR *b = (const _PAIR *) p2;
+  if (a -> hash != b -> hash) return a -> hash < b -> hash ? -1 : 1;
+  return a -> index - b -> index;
+}
+
+/*
+ * places the distinct (mixed) values, returning 0 on success or -1 if some
+ * bucket finds no displacement (the caller then tries more buckets)
+ */
+static int
+_place (C_MPH *mph, const unsigned long long *values, int *slot_of,
+    int *members, int *start, int *by_size, unsigned char *taken) {
+  int m = mph -> slots, r = mph -> buckets;
+  unsigned long long limit = 16ULL * m + 1024, d;
+  int largest = 0, b, i, j, k, n;
+  int slot [64];
+
+  /* group the values by bucket */
+  memset (start, 0x00, (r + 1) * sizeof (int));
+  for (i = 0; i < m; i ++) start [_bucket (r, values [i]) + 1] ++;
+  for (b = 0; b < r; b ++) {
+    if (start [b + 1] > largest) largest = start [b + 1];
+    start [b + 1] += start [b];
+  }
+  if (largest > 64) return -1;
+  for (i = 0; i < m; i ++) {
+    b = _bucket (r, values [i]);
+    members [start [b] ++] = i;
+  }
+  for (b = r; b > 0; b --) start [b] = start [b - 1];
+  start [0] = 0;
+
+  /* buckets largest first */
+  for (n = 0, k = largest; k > 0; k --)
+    for (b = 0; b < r; b ++)
+      if (start [b + 1] - start [b] == k) by_size [n ++] = b;
+
+  memset (taken, 0x00, m);
+  memset (mph -> displacement, 0x00, r * sizeof (unsigned int));
+  for (i = 0; i < n; i ++) {
+    b = by_size [i];
+    k = start [b + 1] - start [b];
+    for (d = 0; d < limit; d ++) {
+      for (j = 0; j < k; j ++) {
+        int s = _slot (m, values [members [start [b] + j]], (unsigned int) d);
+        int l;
+        if (taken [s]) break;
+        for (l = 0; l < j && slot [l] != s; l ++) ;
+        if (l < j) break;
+        slot [j] = s;
+      }
+      if (j == k) break;
+    }
+    if (d == limit) return -1;
+
+    mph -> displacement [b] = (unsigned int) d;
+    for (j = 0; j < k; j ++) {
+      taken [slot [j]] = 1;
+      slot_of [members [start [b] + j]] = slot [j];
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * entries sharing a hash value are stored together, so when there are any
+ * first [slot] is where the slot's entries start and first [slot + 1] where
+ * they end; otherwise a slot is the position of its one entry
+ */
+static int
+_order (C_MPH *mph, _PAIR *pairs, int *group, int *slot_of, int *order) {
+  int m = mph -> slots, n = mph -> size;
+  int i, j, k;
+
+  if (m == n) {
+    for (k = 0; k < m; k ++) order [slot_of [k]] = pairs [k].index;
+    return 0;
+  }
+
+  mph -> first = (int *) c_allocator_alloc (mph -> allocator,
+    (m + 1) * sizeof (int));
+  if (!mph -> first) return -1;
+
+  memset (mph -> first, 0x00, (m + 1) * sizeof (int));
+  for (k = 0; k < m; k ++)
+    mph -> first [slot_of [k] + 1] = group [k + 1] - group [k];
+  for (i = 0; i < m; i ++) mph -> first [i + 1] += mph -> first [i];
+  for (k = 0; k < m; k ++)
+    for (j = group [k]; j < group [k + 1]; j ++)
+      order [mph -> first [slot_of [k]] + j - group [k]] = pairs [j].index;
+
+  return 0;
+}
+
+C_MPH *
+c_mph_create (const unsigned long long *hashes, int count, int *order) {
+
+  C_ALLOCATOR *allocator = c_allocator_get ();
+  C_MPH *mph = NULL;
+  _PAIR *pairs;
+  unsigned long long *values;
+  int *group, *slot_of, *members, *start, *by_size;
+  unsigned char *taken;
+  int attempt, i, m;
+
+  pairs = (_PAIR *) c_allocator_alloc (allocator, (count + 1) * sizeof (_PAIR));
+  values = (unsigned long long *) c_allocator_alloc (allocator,
+    (count + 1) * sizeof (unsigned long long));
+  group = (int *) c_allocator_alloc (allocator, (count + 1) * sizeof (int));
+  slot_of = (int *) c_allocator_alloc (allocator, (count + 1) * sizeof (int));
+  members = (int *) c_allocator_alloc (allocator, (count + 1) * sizeof (int));
+  taken = (unsigned char *) c_allocator_alloc (allocator, count + 1);
+  if (!pairs || !values || !group || !slot_of || !members || !taken)
+    goto done;
+
+  /* sort to find the distinct values and the entries that share them */
+  for (i = 0; i < count; i ++) {
+    pairs [i].hash = _mix (hashes [i]);
+    pairs [i].index = i;
+  }
+  qsort (pairs, count, sizeof (_PAIR), _compare);
+  for (i = 0, m = 0; i < count; i ++) {
+    if (i == 0 || pairs [i].hash != pairs [i - 1].hash) {
+      group [m] = i;
+      values [m ++] = pairs [i].hash;
+    }
+  }
+  group [m] = count;
+
+  mph = (C_MPH *) c_allocator_alloc (allocator, sizeof (C_MPH));
+  if (!mph) goto done;
+  memset (mph, 0x00, sizeof (C_MPH));
+  mph -> allocator = allocator;
+  mph -> size = count;
+  mph -> slots = m;
+  mph -> buckets = m / C_MPH_BUCKET_SIZE + 1;
+
+  for (attempt = 0; attempt < C_MPH_ATTEMPTS; attempt ++) {
+    int r = mph -> buckets;
+    int placed;
+
+    mph -> displacement = (unsigned int *) c_allocator_alloc (allocator,
+      r * sizeof (unsigned int));
+    start = (int *) c_allocator_alloc (allocator, (r + 1) * sizeof (int));
+    by_size = (int *) c_allocator_alloc (allocator, r * sizeof (int));
+    placed = mph -> displacement && start && by_size ?
+      _place (mph, values, slot_of, members, start, by_size, taken) : -2;
+    c_allocator_free (allocator, start);
+    c_allocator_free (allocator, by_size);
+    if (0 == placed) break;
+
+    c_allocator_free (allocator, mph -> displacement);
+    mph -> displacement = NULL;
+    if (-2 == placed) break;
+    mph -> buckets *= 2;
+  }
+
+  if (!mph -> displacement || _order (mph, pairs, group, slot_of, order)) {
+    c_mph_free (mph);
+    mph = NULL;
+  }
+
+done:
+  c_allocator_free (allocator, pairs);
+  c_allocator_free (allocator, values);
+  c_allocator_free (allocator, group);
+  c_allocator_free (allocator, slot_of);
+  c_allocator_free (allocator, members);
+  c_allocator_free (allocator, taken);
+
+  return mph;
+}
+
+void
+c_mph_free (C_MPH *mph) {
+  if (mph) {
+    if (!mph -> mapped) {
+      c_allocator_free (mph -> allocator, mph -> displacement);
+      c_allocator_free (mph -> allocator, mph -> first);
+    }
+    c_allocator_free (mph -> allocator, mph);
+  }
+}
+
+int
+c_mph_find (C_MPH *mph, unsigned long long hash, int *count) {
+  unsigned long long mixed = _mix (hash);
+  int slot;
+
+  if (0 == mph -> slots) {
+    *count = 0;
+    return 0;
+  }
+
+  slot = _slot (mph -> slots, mixed,
+    mph -> displacement [_bucket (mph -> buckets, mixed)]);
+  if (mph -> first) {
+    *count = mph -> first [slot + 1] - mph -> first [slot];
+    return mph -> first [slot];
+  }
+
+  *count = 1;
+  return slot;
+}
+
+int
+c_mph_size (C_MPH *mph) {
+  return mph -> size;
+}
+
+size_t
+c_mph_image_size (C_MPH *mph) {
+  return sizeof (_IMAGE) + mph -> buckets * sizeof (unsigned int) +
+    (mph -> first ? (mph -> slots + 1) * sizeof (int) : 0);
+}
+
+void
+c_mph_image (C_MPH *mph, void *image) {
+  _IMAGE *header = (_IMAGE *) image;
+  char *next = (char *) (header + 1);
+
+  header -> size = mph -> size;
+  header -> slots = mph -> slots;
+  header -> buckets = mph -> buckets;
+  header -> first = NULL != mph -> first;
+  memcpy (next, mph -> displacement, mph -> buckets * sizeof (unsigned int));
+  next += mph -> buckets * sizeof (unsigned int);
+  if (mph -> first)
+    memcpy (next, mph -> first, (mph -> slots + 1) * sizeof (int));
+}
+
+/*
+ * the image may come from a file, so everything a lookup relies on is
+ * checked: sizes, and that every position it can return is in range
+ */
+C_MPH *
+c_mph_map (const void *image, size_t length) {
+
+  C_ALLOCATOR *allocator = c_allocator_get ();
+  const _IMAGE *header = (const _IMAGE *) image;
+  C_MPH *mph;
+  size_t expected;
+  int i;
+
+  if (length < sizeof (_IMAGE)) return NULL;
+  if (header -> size < 0 || header -> slots < 0 ||
+      header -> slots > header -> size || header -> buckets < 1) return NULL;
+  if (header -> slots < header -> size && !header -> first) return NULL;
+  expected = sizeof (_IMAGE) + header -> buckets * sizeof (unsigned int) +
+    (header -> first ? (header -> slots + 1) * sizeof (int) : 0);
+  if (length != expected) return NULL;
+
+  mph = (C_MPH *) c_allocator_alloc (allocator, sizeof (C_MPH));
+  if (!mph) return NULL;
+  memset (mph, 0x00, sizeof (C_MPH));
+  mph -> allocator = allocator;
+  mph -> mapped = 1;
+  mph -> size = header -> size;
+  mph -> slots = header -> slots;
+  mph -> buckets = header -> buckets;
+  mph -> displacement = (unsigned int *) (header + 1);
+  if (header -> first) {
+    mph -> first = (int *) (mph -> displacement + mph -> buckets);
+    for (i = 0; i < mph -> slots; i ++)
+      if (mph -> first [i] < 0 || mph -> first [i] > mph -> first [i + 1])
+        break;
+    if (i < mph -> slots || mph -> first [0] != 0 ||
+        mph -> first [mph -> slots] != mph -> size) {
+      c_mph_free (mph);
+      mph = NULL;
+    }
+  }
+
+  return mph;
+}
@@ -0,0 +1,502 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_allocator.h"
+#include "c_rcu_map.h"
+#include "hash_func.h"
+
+#define C_RCU_MAP_INITIAL_TABLE_SIZE 16
+#define C_RCU_MAP_LOAD_FACTOR .75
+#define C_RCU_MAP_LINE 64 // readers are padded to a cache line
+
+/*
+ * Everything a reader can reach (tables and nodes) starts with a _RETIRED
+ * header. Once unlinked, the object goes on the map's retired list, stamped
+ * with the epoch at the time; it is freed when every reader is either idle
+ * or entered its section in a later epoch.
+ */
+#define _COLLECT_KEY 1
+#define _COLLECT_VALUE 2
+
+typedef struct _RETIRED _RETIRED;
+struct _RETIRED {
+  _RETIRED *next;
+  unsigned long stamp;
+  int collect; // _NODE: which of key and value go to C_MAP_GARBAGE
+};
+
+typedef struct _NODE _NODE;
+struct _NODE {
+  _RETIRED retired;
+  _NODE *_Atomic next;
+  unsigned int hash;
+  void *key;
+  void *value;
+};
+
+typedef struct _TABLE {
+  _RETIRED retired;
+  int size;
+  _NODE *_Atomic bucket [0];
+} _TABLE;
+
+/*
+ * each reader has a cache line of its own, so that one reader's read_lock
+ * does not invalidate the line another reader's active word is on; the
+ * allocator gives no alignment beyond malloc's, so a reader is carved out
+ * of a block one line larger, at the first line boundary in it
+ */
+struct C_RCU_READER {
+  _Atomic unsigned long active; // epoch at read_lock, or 0 when idle
+  C_RCU_MAP *map;
+  C_RCU_READER *next;
+  void *block;                  // what to free
+  char pad [C_RCU_MAP_LINE - sizeof (unsigned long) - 3 * sizeof (void *)];
+};
+
+struct C_RCU_MAP {
+  C_ALLOCATOR *allocator;
+  C_MAP_CALCULATOR calculator;
+  C_MAP_COMPARATOR comparator;
+  C_MAP_GARBAGE garbage;
+
+  _TABLE *_Atomic table;
+  _Atomic int size;
+  _Atomic unsigned long epoch;
+
+  /* writers only, under lock */
+  pthread_mutex_t lock;
+  C_RCU_READER *readers;
+  _RETIRED *retired;
+  int retired_count;
+};
+
+static _TABLE *
+_table_create (C_RCU_MAP *m, int size) {
+  _TABLE *t = (_TABLE *) c_allocator_calloc (m -> allocator, 1,
+    sizeof (_TABLE) + size * sizeof (_NODE *));
+  if (t) t -> size = size;
+  return t;
+}
+
+static _NODE *
+_node_create (C_RCU_MAP *m, unsigned int hash, void *key, void *value) {
+  _NODE *n = (_NODE *) c_allocator_calloc (m -> allocator, 1, sizeof (_NODE));
+  if (n) {
+    n -> hash = hash;
+    n -> key = key;
+    n -> value = value;
+  }
+  return n;
+}
+
+static void
+_retire (C_RCU_MAP *m, _RETIRED *r, int collect) {
+  r -> stamp = atomic_load_explicit (&m -> epoch, memory_order_relaxed);
+  r -> collect = collect;
+  r -> next = m -> retired;
+  m -> retired = r;
+  m -> retired_count += 1;
+}
+
+static void
+_release (C_RCU_MAP *m, _RETIRED *r) {
+  if (r -> collect && m -> garbage) {
+    _NODE *n = (_NODE *) r;
+    m -> garbage (r -> collect & _COLLECT_KEY ? n -> key : NULL,
+      r -> collect & _COLLECT_VALUE ? n -> value : NULL);
+  }
+  c_allocator_free (m -> allocator, r);
+}
+
+/*
+ * moves to a new epoch and frees whatever was retired before the oldest
+ * section still running; the fence pairs with the one in read_lock, so a
+ * reader either shows up as active here or sees the unlinking stores
+ */
+static int
+_reclaim (C_RCU_MAP *m) {
+  unsigned long oldest = atomic_fetch_add (&m -> epoch, 1) + 1;
+  _RETIRED **r = &m -> retired;
+  C_RCU_READER *reader;
+
+  atomic_thread_fence (memory_order_seq_cst);
+  for (reader = m -> readers; reader; reader = reader -> next) {
+    unsigned long active = atomic_load (&reader -> active);
+    if (active && active < oldest) oldest = active;
+  }
+
+  while (*r) {
+    if ((*r) -> stamp < oldest) {
+      _RETIRED *done = *r;
+      *r = done -> next;
+      _release (m, done);
+      m -> retired_count -= 1;
+    } else {
+      r = &(*r) -> next;
+    }
+  }
+
+  return m -> retired_count;
+}
+
+/*
+ * builds a table twice the size from copies of the current nodes, so that
+ * readers still walking the old chains are never disturbed; without memory
+ * the map just keeps its current table
+ */
+static void
+_grow (C_RCU_MAP *m, _TABLE *old) {
+  _TABLE *t = _table_create (m, old -> size * 2);
+  _NODE *copies = NULL;
+  int i;
+
+  if (!t) return;
+  for (i = 0; i < old -> size; i ++) {
+    _NODE *n = atomic_load_explicit (&old -> bucket [i], memory_order_relaxed);
+    for (; n; n = atomic_load_explicit (&n -> next, memory_order_relaxed)) {
+      _NODE *copy = _node_create (m, n -> hash, n -> key, n -> value);
+      int index = n -> hash & (t -> size - 1);
+      if (!copy) {
+        while (copies) {
+          _NODE *next = (_NODE *) copies -> retired.next;
+          c_allocator_free (m -> allocator, copies);
+          copies = next;
+        }
+        c_allocator_free (m -> allocator, t);
+        return;
+      }
+      copy -> retired.next = (_RETIRED *) copies; // for the unwind above
+      copies = copy;
+      atomic_store_explicit (&copy -> next,
+        atomic_load_explicit (&t -> bucket [index], memory_order_relaxed),
+        memory_order_relaxed);
+      atomic_store_explicit (&t -> bucket [index], copy, memory_order_relaxed);
+    }
+  }
+
+  atomic_store_explicit (&m -> table, t, memory_order_release);
+
+  for (i = 0; i < old -> size; i ++) {
+    _NODE *n = atomic_load_explicit (&old -> bucket [i], memory_order_relaxed);
+    while (n) {
+      _NODE *next = atomic_load_explicit (&n -> next, memory_order_relaxed);
+      _retire (m, &n -> retired, 0);
+      n = next;
+    }
+  }
+  _retire (m, &old -> retired, 0);
+}
+
+/*
+ * returns the link (bucket head or next field) that points at the node for
+ * key, or at the NULL ending its chain; the caller holds the writers' lock
+ */
+static _NODE *_Atomic *
+_link (C_RCU_MAP *m, _TABLE *t, unsigned int hash, void *key) {
+  _NODE *_Atomic *link = &t -> bucket [hash & (t -> size - 1)];
+  _NODE *n;
+
+  while ((n = atomic_load_explicit (link, memory_order_relaxed))) {
+    if (n -> hash == hash && 0 == m -> comparator (n -> key, key)) break;
+    link = &n -> next;
+  }
+
+  return link;
+}
+
+C_RCU_MAP *
+c_rcu_map_create (C_MAP_CALCULATOR cal, C_MAP_COMPARATOR com,
+    C_MAP_GARBAGE garbage) {
+
+  C_ALLOCATOR *allocator = c_allocator_get ();
+  C_RCU_MAP *m = (C_RCU_MAP *) c_allocator_alloc (allocator,
+    sizeof (C_RCU_MAP));
+  if (m) {
+    memset (m, 0x00, sizeof (C_RCU_MAP));
+    m -> allocator = allocator;
+    m -> calculator = cal;
+    m -> comparator = com;
+    m -> garbage = garbage;
+    atomic_init (&m -> epoch, 1);
+    atomic_init (&m -> size, 0);
+    _TABLE *t = _table_create (m, C_RCU_MAP_INITIAL_TABLE_SIZE);
+    if (!t) {
+      c_allocator_free (allocator, m);
+      return NULL;
+    }
+    atomic_init (&m -> table, t);
+    pthread_mutex_init (&m -> lock, NULL);
+  }
+
+  return m;
+}
+
+C_RCU_MAP *
+c_rcu_map_dict_create (C_MAP_GARBAGE garbage) {
+  return c_rcu_map_create (hash_string_calculator, hash_string_comparator,
+    garbage);
+}
+
+void
+c_rcu_map_free (C_RCU_MAP *m) {
+  C_RCU_READER *reader;
+
+  if (m) {
+    c_rcu_map_clear (m);
+    while ((reader = m -> readers)) {
+      m -> readers = reader -> next;
+      c_allocator_free (m -> allocator, reader -> block);
+    }
+    while (m -> retired) {
+      _RETIRED *r = m -> retired;
+      m -> retired = r -> next;
+      _release (m, r);
+    }
+    c_allocator_free (m -> allocator, atomic_load (&m -> table));
+    pthread_mutex_destroy (&m -> lock);
+    c_allocator_free (m -> allocator, m);
+  }
+}
+
+C_RCU_READER *
+c_rcu_map_reader_create (C_RCU_MAP *m) {
+  C_RCU_READER *reader = NULL;
+  void *block = c_allocator_alloc (m -> allocator,
+    sizeof (C_RCU_READER) + C_RCU_MAP_LINE - 1);
+  if (block) {
+    reader = (C_RCU_READER *) (((uintptr_t) block + C_RCU_MAP_LINE - 1) &
+      ~(uintptr_t) (C_RCU_MAP_LINE - 1));
+    memset (reader, 0x00, sizeof (C_RCU_READER));
+    reader -> block = block;
+    atomic_init (&reader -> active, 0);
+    reader -> map = m;
+    pthread_mutex_lock (&m -> lock);
+    reader -> next = m -> readers;
+    m -> readers = reader;
+    pthread_mutex_unlock (&m -> lock);
+  }
+  return reader;
+}
+
+void
+c_rcu_map_reader_free (C_RCU_READER *reader) {
+  C_RCU_MAP *m;
+  C_RCU_READER **r;
+
+  if (reader) {
+    m = reader -> map;
+    pthread_mutex_lock (&m -> lock);
+    for (r = &m -> readers; *r; r = &(*r) -> next) {
+      if (*r == reader) {
+        *r = reader -> next;
+        break;
+      }
+    }
+    pthread_mutex_unlock (&m -> lock);
+    c_allocator_free (m -> allocator, reader -> block);
+  }
+}
+
+void
+c_rcu_map_read_lock (C_RCU_READER *reader) {
+  atomic_store_explicit (&reader -> active,
+    atomic_load_explicit (&reader -> map -> epoch, memory_order_relaxed),
+    memory_order_relaxed);
+  atomic_thread_fence (memory_order_seq_cst);
+}
+
+void
+c_rcu_map_read_unlock (C_RCU_READER *reader) {
+  atomic_store_explicit (&reader -> active, 0, memory_order_release);
+}
+
+static _NODE *
+_find (C_RCU_MAP *m, void *key) {
+  unsigned int hash = m -> calculator (key);
+  _TABLE *t = atomic_load_explicit (&m -> table, memory_order_acquire);
+  _NODE *n = atomic_load_explicit (&t -> bucket [hash & (t -> size - 1)],
+    memory_order_acquire);
+
+  for (; n; n = atomic_load_explicit (&n -> next, memory_order_acquire)) {
+    if (n -> hash == hash && 0 == m -> comparator (n -> key, key)) break;
+  }
+
+  return n;
+}
+
+void *
+c_rcu_map_find (C_RCU_MAP *m, void *key) {
+  _NODE *n = _find (m, key);
+  return n ? n -> value : NULL;
+}
+
+int
+c_rcu_map_exists (C_RCU_MAP *m, void *key) {
+  return NULL != _find (m, key);
+}
+
+int
+c_rcu_map_foreach (C_RCU_MAP *m, C_RCU_MAP_VISITOR visit, void *context) {
+  _TABLE *t = atomic_load_explicit (&m -> table, memory_order_acquire);
+  int i, rc = 0;
+
+  for (i = 0; 0 == rc && i < t -> size; i ++) {
+    _NODE *n = atomic_load_explicit (&t -> bucket [i], memory_order_acquire);
+    for (; 0 == rc && n;
+        n = atomic_load_explicit (&n -> next, memory_order_acquire)) {
+      rc = visit (n -> key, n -> value, context);
+    }
+  }
+
+  return rc;
+}
+
+/*
+ * a new node is fully built before the release store that links it in, so
+ * a reader that finds it also finds its contents
+ */
+static int
+_add (C_RCU_MAP *m, void *key, void *value, int replace) {
+  unsigned int hash = m -> calculator (key);
+  int rc = 0;
+
+  pthread_mutex_lock (&m -> lock);
+  _TABLE *t = atomic_load_explicit (&m -> table, memory_order_relaxed);
+  _NODE *_Atomic *link = _link (m, t, hash, key);
+  _NODE *found = atomic_load_explicit (link, memory_order_relaxed);
+
+  if (found && !replace) {
+    rc = C_RCU_MAP_ERROR_DUPLICATE;
+  } else if (found) {
+
+    /* the old key stays, as in c_map_add; the old node goes to readers' past */
+    _NODE *n = _node_create (m, hash, found -> key, value);
+    if (!n) {
+      rc = C_RCU_MAP_ERROR_MEMORY;
+    } else {
+      if (m -> garbage && found -> key != key) m -> garbage (key, NULL);
+      atomic_store_explicit (&n -> next,
+        atomic_load_explicit (&found -> next, memory_order_relaxed),
+        memory_order_relaxed);
+      atomic_store_explicit (link, n, memory_order_release);
+      _retire (m, &found -> retired,
+        found -> value != value ? _COLLECT_VALUE : 0);
+    }
+  } else {
+    _NODE *n = _node_create (m, hash, key, value);
+    if (!n) {
+      rc = C_RCU_MAP_ERROR_MEMORY;
+    } else {
+      int size = atomic_load_explicit (&m -> size, memory_order_relaxed) + 1;
+      _NODE *_Atomic *head = &t -> bucket [hash & (t -> size - 1)];
+      atomic_store_explicit (&n -> next,
+        atomic_load_explicit (head, memory_order_relaxed),
+        memory_order_relaxed);
+      atomic_store_explicit (head, n, memory_order_release);
+      atomic_store_explicit (&m -> size, size, memory_order_relaxed);
+      if ((float) size / (float) t -> size > C_RCU_MAP_LOAD_FACTOR)
+        _grow (m, t);
+    }
+  }
+
+  if (m -> retired) _reclaim (m);
+  pthread_mutex_unlock (&m -> lock);
+
+  return rc;
+}
+
+int
+c_rcu_map_insert (C_RCU_MAP *m, void *key, void *value) {
+  return _add (m, key, value, 0);
+}
+
+int
+c_rcu_map_add (C_RCU_MAP *m, void *key, void *value) {
+  return _add (m, key, value, 1);
+}
+
+void
+c_rcu_map_remove (C_RCU_MAP *m, void *key) {
+  unsigned int hash = m -> calculator (key);
+
+  pthread_mutex_lock (&m -> lock);
+  _TABLE *t = atomic_load_explicit (&m -> table, memory_order_relaxed);
+  _NODE *_Atomic *link = _link (m, t, hash, key);
+  _NODE *found = atomic_load_explicit (link, memory_order_relaxed);
+
+  if (found) {
+    atomic_store_explicit (link,
+      atomic_load_explicit (&found -> next, memory_order_relaxed),
+      memory_order_release);
+    atomic_fetch_sub_explicit (&m -> size, 1, memory_order_relaxed);
+    _retire (m, &found -> retired, _COLLECT_KEY | _COLLECT_VALUE);
+  }
+
+  if (m -> retired) _reclaim (m);
+  pthread_mutex_unlock (&m -> lock);
+}
+
+/*
+ * readers move over to an empty table; the old one and all of its nodes are
+ * retired together
+ */
+void
+c_rcu_map_clear (C_RCU_MAP *m) {
+  int i;
+
+  pthread_mutex_lock (&m -> lock);
+  _TABLE *old = atomic_load_explicit (&m -> table, memory_order_relaxed);
+  _TABLE *t = _table_create (m, C_RCU_MAP_INITIAL_TABLE_SIZE);
+
+  if (t) {
+    atomic_store_explicit (&m -> table, t, memory_order_release);
+    atomic_store_explicit (&m -> size, 0, memory_order_relaxed);
+    for (i = 0; i < old -> size; i ++) {
+      _NODE *n = atomic_load_explicit (&old -> bucket [i],
+        memory_order_relaxed);
+      while (n) {
+        _NODE *next = atomic_load_explicit (&n -> next, memory_order_relaxed);
+        _retire (m, &n -> retired, _COLLECT_KEY | _COLLECT_VALUE);
+        n = next;
+      }
+    }
+    _retire (m, &old -> retired, 0);
+  } else {
+
+    /* no memory for a fresh table: unlink the nodes one bucket at a time */
+    for (i = 0; i < old -> size; i ++) {
+      _NODE *n = atomic_load_explicit (&old -> bucket [i],
+        memory_order_relaxed);
+      atomic_store_explicit (&old -> bucket [i], NULL, memory_order_release);
+      while (n) {
+        _NODE *next = atomic_load_explicit (&n -> next, memory_order_relaxed);
+        atomic_fetch_sub_explicit (&m -> size, 1, memory_order_relaxed);
+        _retire (m, &n -> retired, _COLLECT_KEY | _COLLECT_VALUE);
+        n = next;
+      }
+    }
+  }
+
+  if (m -> retired) _reclaim (m);
+  pthread_mutex_unlock (&m -> lock);
+}
+
+int
+c_rcu_map_reclaim (C_RCU_MAP *m) {
+  int pending;
+
+  pthread_mutex_lock (&m -> lock);
+  pending = _reclaim (m);
+  pthread_mutex_unlock (&m -> lock);
+
+  return pending;
+}
+
+int
+c_rcu_map_size (C_RCU_MAP *m) {
+  return atomic_load_explicit (&m -> size, memory_order_relaxed);
+}
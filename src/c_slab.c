@@ -0,0 +1,201 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "c_allocator.h"
+#include "c_slab.h"
+
+typedef struct _CHUNK _CHUNK;
+struct _CHUNK {
+  _CHUNK *next;
+  size_t length; // bytes of objects; also keeps them pointer-aligned
+  char objects [0];
+};
+
+typedef struct _FREE _FREE;
+struct _FREE {
+  _FREE *next;
+};
+
+struct C_SLAB {
+  C_ALLOCATOR *allocator;
+  size_t object_size;
+  _CHUNK *chunks;
+  int chunk_objects;  // capacity of the next chunk
+  char *next;         // unused space at the end of the newest chunk
+  char *end;
+  _FREE *free;
+  int size;
+};
+
+#define C_SLAB_FIRST_CHUNK_OBJECTS 8
+#define C_SLAB_MAX_CHUNK_OBJECTS 1024
+
+C_SLAB *
+c_slab_create (size_t object_size) {
+
+  C_ALLOCATOR *allocator = c_allocator_get ();
+  C_SLAB *s = (C_SLAB *) c_allocator_alloc (allocator, sizeof (C_SLAB));
+  if (s) {
+    memset (s, 0x00, sizeof (C_SLAB));
+    s -> allocator = allocator;
+    if (object_size < sizeof (_FREE)) object_size = sizeof (_FREE);
+    s -> object_size = (object_size + sizeof (void *) - 1) &
+      ~(sizeof (void *) - 1);
+    s -> chunk_objects = C_SLAB_FIRST_CHUNK_OBJECTS;
+  }
+
+  return s;
+}
+
+void
+c_slab_clear (C_SLAB *s) {
+  _CHUNK *chunk;
+
+  while ((chunk = s -> chunks)) {
+    s -> chunks = chunk -> next;
+    c_allocator_free (s -> allocator, chunk);
+  }
+  s -> chunk_objects = C_SLAB_FIRST_CHUNK_OBJECTS;
+  s -> next = s -> end = NULL;
+  s -> free = NULL;
+  s -> size = 0;
+}
+
+void
+c_slab_free (C_SLAB *s) {
+  if (s) {
+    c_slab_clear (s);
+    c_allocator_free (s -> allocator, s);
+  }
+}
+
+void *
+c_slab_alloc (C_SLAB *s) {
+  void *object;
+
+  if (s -> free) {
+    object = s -> free;
+    s -> free = s -> free -> next;
+  } else {
+    if (s -> next == s -> end) {
+      size_t length = s -> chunk_objects * s -> object_size;
+      _CHUNK *chunk = (_CHUNK *) c_allocator_alloc (s -> allocator,
+        sizeof (_CHUNK) + length);
+      if (!chunk) return NULL;
+      chunk -> next = s -> chunks;
+      chunk -> length = length;
+      s -> chunks = chunk;
+      s -> next = chunk -> objects;
+      s -> end = chunk -> objects + length;
+      if (s -> chunk_objects < C_SLAB_MAX_CHUNK_OBJECTS)
+        s -> chunk_objects *= 2;
+    }
+    object = s -> next;
+    s -> next += s -> object_size;
+  }
+
+  s -> size += 1;
+  return object;
+}
+
+void
+c_slab_release (C_SLAB *s, void *object) {
+  _FREE *f = (_FREE *) object;
+  f -> next = s -> free;
+  s -> free = f;
+  s -> size -= 1;
+}
+
+C_ALLOCATOR *
+c_slab_allocator (C_SLAB *s) {
+  return s -> allocator;
+}
+
+int
+c_slab_size (C_SLAB *s) {
+  return s -> size;
+}
+
+/*
+ * the chunks are sorted by address so that each free object finds its
+ * chunk with a binary search; a chunk whose objects are all free goes
+ */
+typedef struct _SPAN {
+  _CHUNK *chunk;
+  size_t handed;     // objects ever handed out from the chunk
+  size_t free;
+} _SPAN;
+
+static int
+_span_compare (const void *p1, const void *p2) {
+  const _SPAN *a = (const _SPAN *) p1;
+  const _SPAN *b = (const _SPAN *) p2;
+  if (a -> chunk == b -> chunk) return 0;
+  return (char *) a -> chunk < (char *) b -> chunk ? -1 : 1;
+}
+
+static _SPAN *
+_span_of (_SPAN *spans, int count, char *object) {
+  int low = 0, high = count - 1;
+
+  while (low < high) {
+    int middle = low + (high - low + 1) / 2;
+    if (object < spans [middle].chunk -> objects) {
+      high = middle - 1;
+    } else {
+      low = middle;
+    }
+  }
+
+  return spans + low;
+}
+
+int
+c_slab_trim (C_SLAB *s) {
+  _CHUNK *chunk, **link;
+  _FREE *f, **keep;
+  _SPAN *spans;
+  int count = 0, i;
+
+  for (chunk = s -> chunks; chunk; chunk = chunk -> next) count ++;
+  if (0 == count) return 0;
+
+  spans = (_SPAN *) c_allocator_alloc (s -> allocator, count * sizeof (_SPAN));
+  if (!spans) return 1;
+
+  for (i = 0, chunk = s -> chunks; chunk; chunk = chunk -> next, i ++) {
+    spans [i].chunk = chunk;
+    spans [i].handed = (chunk == s -> chunks ? (size_t) (s -> next -
+      chunk -> objects) : chunk -> length) / s -> object_size;
+    spans [i].free = 0;
+  }
+  qsort (spans, count, sizeof (_SPAN), _span_compare);
+
+  for (f = s -> free; f; f = f -> next)
+    _span_of (spans, count, (char *) f) -> free ++;
+
+  /* drop the free objects that live in chunks about to go */
+  for (keep = &s -> free; (f = *keep); ) {
+    _SPAN *span = _span_of (spans, count, (char *) f);
+    if (span -> free == span -> handed) {
+      *keep = f -> next;
+    } else {
+      keep = &f -> next;
+    }
+  }
+
+  for (link = &s -> chunks; (chunk = *link); ) {
+    _SPAN *span = _span_of (spans, count, chunk -> objects);
+    if (span -> free == span -> handed) {
+      if (chunk == s -> chunks) s -> next = s -> end = NULL;
+      *link = chunk -> next;
+      c_allocator_free (s -> allocator, chunk);
+    } else {
+      link = &chunk -> next;
+    }
+  }
+  if (!s -> chunks) s -> chunk_objects = C_SLAB_FIRST_CHUNK_OBJECTS;
+
+  c_allocator_free (s -> allocator, spans);
+  return 0;
+}
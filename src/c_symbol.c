@@ -1,35 +1,151 @@
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "c_allocator.h"
+#include "c_dict.h"
 #include "c_hash.h"
 #include "c_symbol.h"
 #include "hash_func.h"
 
+/*
+ * in C_SYMBOL_ARENA mode, symbols are packed one after another into blocks
+ * that are only freed all together
+ */
+typedef struct _BLOCK _BLOCK;
+struct _BLOCK {
+  _BLOCK *next;
+  void *align; // keeps the symbols that follow 8-byte aligned
+  char symbols [0];
+};
+
 struct C_SYMBOL {
+  C_ALLOCATOR *allocator;
   C_HASH *table;
+  int flags;
+  unsigned char seed [HASH_FUNC_KEY_SIZE];
+  _BLOCK *blocks;    // C_SYMBOL_ARENA
+  size_t block_size; // capacity of the next block
+  char *next;        // unused space at the end of the newest block
+  char *end;
+  char **ids;        // symbol by id, NULL once removed
+  int id_count;
+  int id_capacity;
 };
 
+#define C_SYMBOL_FIRST_BLOCK 4096
+#define C_SYMBOL_MAX_BLOCK (1024 * 1024)
+#define C_SYMBOL_ID_TEXT 12 // room for an id in decimal, see c_symbol_save
+
+/*
+ * the length is kept with the symbol, so that lookups never scan a stored
+ * symbol for its end and symbols of another length are rejected at once;
+ * a lookup's symbol need not be null-terminated
+ */
 typedef struct _C_SYMBOL {
   char *symbol;
+  size_t length;
+  unsigned long long hash; // calculated once per call, see _probe
 } _C_SYMBOL;
 
-static unsigned int
+/*
+ * every symbol's bytes are preceded by its hash, length, id and value, for
+ * c_symbol_hash, c_symbol_length, c_symbol_id and c_symbol_value; the length
+ * is 32 bits to keep the header at 24 bytes
+ */
+typedef struct _HEADER {
+  unsigned long long hash;
+  unsigned int length;
+  int id;
+  void *value;
+} _HEADER;
+
+#define _HEADER_OF(symbol) ((_HEADER *) (symbol) - 1)
+
+static void
+_probe (C_SYMBOL *table, _C_SYMBOL *s, const char *string, size_t length) {
+  s -> symbol = (char *) string;
+  s -> length = length;
+  if (table -> flags & C_SYMBOL_KEYED)
+    s -> hash = hash_func_siphash ((void *) string, length, table -> seed);
+  else
+    s -> hash = hash_func_calculate ((void *) string, length);
+}
+
+static unsigned long long
 _calc (void *item, void *context) {
   _C_SYMBOL *s = (_C_SYMBOL *) item;
-  return hash_string_calculator (s -> symbol);
+  return s -> hash;
 }
 
 static int
 _compare (void *item1, void *item2, void *context) {
   _C_SYMBOL *s1 = (_C_SYMBOL *) item1;
   _C_SYMBOL *s2 = (_C_SYMBOL *) item2;
-  return hash_string_comparator (s1 -> symbol, s2 -> symbol);
+  if (s1 -> length != s2 -> length) return s1 -> length < s2 -> length ? -1 : 1;
+  return memcmp (s1 -> symbol, s2 -> symbol, s1 -> length);
 }
 
 static void
 _garbage (void *item, void *context) {
+  C_SYMBOL *table = (C_SYMBOL *) context;
   _C_SYMBOL *s = (_C_SYMBOL *) item;
-  free (s -> symbol);
+  table -> ids [_HEADER_OF (s -> symbol) -> id] = NULL;
+  if (!(table -> flags & C_SYMBOL_ARENA))
+    c_allocator_free (table -> allocator, _HEADER_OF (s -> symbol));
+}
+
+/*
+ * a symbol too big for a fresh block gets a block of its own, linked behind
+ * the newest block so that the newest block's free space is kept
+ */
+static _HEADER *
+_arena_alloc (C_SYMBOL *s, size_t size) {
+  _BLOCK *block;
+  char *space;
+
+  size = (size + sizeof (void *) - 1) & ~(sizeof (void *) - 1);
+  if ((size_t) (s -> end - s -> next) < size) {
+    if (size > s -> block_size) {
+      block = (_BLOCK *) c_allocator_alloc (s -> allocator,
+        sizeof (_BLOCK) + size);
+      if (!block) return NULL;
+      if (s -> blocks) {
+        block -> next = s -> blocks -> next;
+        s -> blocks -> next = block;
+      } else {
+        block -> next = NULL;
+        s -> blocks = block;
+        s -> next = s -> end = block -> symbols + size;
+      }
+      return (_HEADER *) block -> symbols;
+    }
+
+    block = (_BLOCK *) c_allocator_alloc (s -> allocator,
+      sizeof (_BLOCK) + s -> block_size);
+    if (!block) return NULL;
+    block -> next = s -> blocks;
+    s -> blocks = block;
+    s -> next = block -> symbols;
+    s -> end = block -> symbols + s -> block_size;
+    if (s -> block_size < C_SYMBOL_MAX_BLOCK) s -> block_size *= 2;
+  }
+
+  space = s -> next;
+  s -> next += size;
+  return (_HEADER *) space;
+}
+
+static void
+_arena_clear (C_SYMBOL *s) {
+  _BLOCK *block;
+
+  while ((block = s -> blocks)) {
+    s -> blocks = block -> next;
+    c_allocator_free (s -> allocator, block);
+  }
+  s -> block_size = C_SYMBOL_FIRST_BLOCK;
+  s -> next = s -> end = NULL;
 }
 
 static void *
@@ -38,16 +154,21 @@ _extractor (void *item) {
   return s -> symbol;
 }
 
-C_SYMBOL *
-c_symbol_create (void) {
+static C_SYMBOL *
+_c_symbol_create (int expected, int flags) {
 
-  C_SYMBOL *s = (C_SYMBOL *) malloc (sizeof (C_SYMBOL));
+  C_ALLOCATOR *allocator = c_allocator_get ();
+  C_SYMBOL *s = (C_SYMBOL *) c_allocator_alloc (allocator, sizeof (C_SYMBOL));
   if (s) {
     memset (s, 0x00, sizeof (C_SYMBOL));
-    s -> table = c_hash_create (sizeof (_C_SYMBOL), _calc, _compare, _garbage,
-      NULL);
+    s -> allocator = allocator;
+    s -> flags = flags;
+    s -> block_size = C_SYMBOL_FIRST_BLOCK;
+    if (flags & C_SYMBOL_KEYED) hash_func_random_key (s -> seed);
+    s -> table = c_hash_create64 (sizeof (_C_SYMBOL), _calc, _compare,
+      _garbage, (void *) s, expected, C_HASH_CHAINED, NULL);
     if (!s -> table) {
-      free (s);
+      c_allocator_free (allocator, s);
       s = NULL;
     }
   }
@@ -55,46 +176,152 @@ c_symbol_create (void) {
   return s;
 }
 
+C_SYMBOL *
+c_symbol_create_size (int expected) {
+  return _c_symbol_create (expected, 0);
+}
+
+C_SYMBOL *
+c_symbol_create_keyed (int expected) {
+  return _c_symbol_create (expected, C_SYMBOL_KEYED);
+}
+
+C_SYMBOL *
+c_symbol_create_flags (int expected, int flags) {
+  return _c_symbol_create (expected, flags);
+}
+
+C_SYMBOL *
+c_symbol_create (void) {
+  return c_symbol_create_size (0);
+}
+
 void
 c_symbol_free (C_SYMBOL *s) {
   if (s) {
     c_hash_free (s -> table);
-    free (s);
+    _arena_clear (s);
+    c_allocator_free (s -> allocator, s -> ids);
+    c_allocator_free (s -> allocator, s);
   }
 }
 
 char *
-c_symbol_add (C_SYMBOL *s, char *string) {
-  _C_SYMBOL add = {string};
-  _C_SYMBOL *symbol = (_C_SYMBOL *) c_hash_find (s -> table, &add);
+c_symbol_add_n (C_SYMBOL *s, const char *string, size_t length) {
+  _C_SYMBOL add, *symbol;
+  _HEADER *header;
 
+  _probe (s, &add, string, length);
+  symbol = (_C_SYMBOL *) c_hash_find (s -> table, &add);
   if (symbol) return symbol -> symbol;
 
-  add.symbol = (char *) malloc (strlen (string) + 1);
-  if (add.symbol) {
-    strcpy (add.symbol, string);
-    c_hash_insert (s -> table, &add);
+  if ((unsigned int) length != length) return NULL;
+  if (s -> id_count == s -> id_capacity) {
+    int capacity = s -> id_capacity ? s -> id_capacity * 2 : 16;
+    char **ids = (char **) c_allocator_realloc (s -> allocator, s -> ids,
+      capacity * sizeof (char *));
+    if (!ids) return NULL;
+    s -> ids = ids;
+    s -> id_capacity = capacity;
+  }
+
+  if (s -> flags & C_SYMBOL_ARENA)
+    header = _arena_alloc (s, sizeof (_HEADER) + length + 1);
+  else
+    header = (_HEADER *) c_allocator_alloc (s -> allocator,
+      sizeof (_HEADER) + length + 1);
+  if (!header) return NULL;
+
+  header -> hash = add.hash;
+  header -> length = length;
+  header -> id = s -> id_count;
+  header -> value = NULL;
+  add.symbol = (char *) (header + 1);
+  memcpy (add.symbol, string, length);
+  add.symbol [length] = 0x00;
+  if (0 != c_hash_insert (s -> table, &add)) {
+    if (!(s -> flags & C_SYMBOL_ARENA))
+      c_allocator_free (s -> allocator, header);
+    return NULL;
   }
+  s -> ids [s -> id_count ++] = add.symbol;
 
   return add.symbol;
 }
 
 char *
-c_symbol_find (C_SYMBOL *s, char *string) {
-  _C_SYMBOL find = {string};
-  _C_SYMBOL *symbol = (_C_SYMBOL *) c_hash_find (s -> table, &find);
+c_symbol_add (C_SYMBOL *s, char *string) {
+  return c_symbol_add_n (s, string, strlen (string));
+}
+
+char *
+c_symbol_find_n (C_SYMBOL *s, const char *string, size_t length) {
+  _C_SYMBOL find, *symbol;
+
+  _probe (s, &find, string, length);
+  symbol = (_C_SYMBOL *) c_hash_find (s -> table, &find);
 
   return symbol ? symbol -> symbol : NULL;
 }
 
+char *
+c_symbol_find (C_SYMBOL *s, char *string) {
+  return c_symbol_find_n (s, string, strlen (string));
+}
+
+unsigned long long
+c_symbol_hash (const char *symbol) {
+  return _HEADER_OF (symbol) -> hash;
+}
+
+size_t
+c_symbol_length (const char *symbol) {
+  return _HEADER_OF (symbol) -> length;
+}
+
+int
+c_symbol_intern_id (C_SYMBOL *s, const char *string, size_t length) {
+  char *symbol = c_symbol_add_n (s, string, length);
+  return symbol ? _HEADER_OF (symbol) -> id : -1;
+}
+
+int
+c_symbol_id (const char *symbol) {
+  return _HEADER_OF (symbol) -> id;
+}
+
+void *
+c_symbol_value (const char *symbol) {
+  return _HEADER_OF (symbol) -> value;
+}
+
+void
+c_symbol_set_value (const char *symbol, void *value) {
+  _HEADER_OF (symbol) -> value = value;
+}
+
+char *
+c_symbol_by_id (C_SYMBOL *s, int id) {
+  return id >= 0 && id < s -> id_count ? s -> ids [id] : NULL;
+}
+
+int
+c_symbol_id_count (C_SYMBOL *s) {
+  return s -> id_count;
+}
+
 void
 c_symbol_clear (C_SYMBOL *s) {
   c_hash_clear (s -> table);
+  _arena_clear (s);
+  s -> id_count = 0;
 }
 
 void
 c_symbol_remove (C_SYMBOL *s, char *string) {
-  _C_SYMBOL remove = {string};
+  _C_SYMBOL remove;
+
+  _probe (s, &remove, string, strlen (string));
   c_hash_remove (s -> table, &remove);
 }
 
@@ -103,7 +330,74 @@ c_symbol_iterator (C_SYMBOL *s) {
   return c_hash_iterator (s -> table, _extractor);
 }
 
+int
+c_symbol_reserve (C_SYMBOL *s, int count) {
+  return c_hash_reserve (s -> table, count);
+}
+
+int
+c_symbol_shrink_to_fit (C_SYMBOL *s) {
+  return c_hash_shrink_to_fit (s -> table);
+}
+
 int
 c_symbol_size (C_SYMBOL *s) {
   return c_hash_size (s -> table);
 }
+
+typedef struct _COLLECT {
+  const char **symbols;
+  size_t *lengths;
+  const char **ids;
+  char *text; // C_SYMBOL_ID_TEXT bytes per symbol for its id
+  int count;
+} _COLLECT;
+
+static int
+_collect_symbol (void *item, void *context) {
+  _COLLECT *c = (_COLLECT *) context;
+  _C_SYMBOL *symbol = (_C_SYMBOL *) item;
+  char *id = c -> text + (size_t) c -> count * C_SYMBOL_ID_TEXT;
+  sprintf (id, "%d", c_symbol_id (symbol -> symbol));
+  c -> ids [c -> count] = id;
+  c -> symbols [c -> count] = symbol -> symbol;
+  c -> lengths [c -> count ++] = c_symbol_length (symbol -> symbol);
+  return 0;
+}
+
+/*
+ * saved as a C_FROZEN_DICT in which every symbol's value is its id
+ */
+int
+c_symbol_save (C_SYMBOL *s, const char *path) {
+  int count = c_symbol_size (s);
+  const char **symbols, **ids;
+  size_t *lengths;
+  char *text;
+  C_FROZEN_DICT *f = NULL;
+  int result;
+
+  symbols = (const char **) c_allocator_alloc (s -> allocator,
+    (count + 1) * sizeof (char *));
+  lengths = (size_t *) c_allocator_alloc (s -> allocator,
+    (count + 1) * sizeof (size_t));
+  ids = (const char **) c_allocator_alloc (s -> allocator,
+    (count + 1) * sizeof (char *));
+  text = (char *) c_allocator_alloc (s -> allocator,
+    (count + 1) * (size_t) C_SYMBOL_ID_TEXT);
+  if (symbols && lengths && ids && text) {
+    _COLLECT collect = { symbols, lengths, ids, text, 0 };
+    c_hash_walk (s -> table, _collect_symbol, &collect);
+    f = c_frozen_dict_create (symbols, lengths, ids, NULL, count,
+      s -> flags & C_SYMBOL_KEYED);
+  }
+  result = f ? c_frozen_dict_save (f, path) : -1;
+
+  c_frozen_dict_free (f);
+  c_allocator_free (s -> allocator, symbols);
+  c_allocator_free (s -> allocator, lengths);
+  c_allocator_free (s -> allocator, ids);
+  c_allocator_free (s -> allocator, text);
+
+  return result;
+}
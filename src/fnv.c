@@ -70,6 +70,12 @@
 #define FNV_32_PRIME ((Fnv32_t)0x01000193)
 
 
+/*
+ * 64 bit magic FNV-0 and FNV-1 prime
+ */
+#define FNV_64_PRIME ((Fnv64_t)0x100000001b3ULL)
+
+
 /*
  * fnv_32_buf - perform a 32 bit Fowler/Noll/Vo hash on a buffer
  *
@@ -146,3 +152,81 @@ fnv_32_str(char *str, Fnv32_t hval)
     /* return our new hash value */
     return hval;
 }
+
+
+/*
+ * fnv_64_buf - perform a 64 bit Fowler/Noll/Vo hash on a buffer
+ *
+ * input:
+ *	buf	- start of buffer to hash
+ *	len	- length of buffer in octets
+ *	hval	- previous hash value or 0 if first call
+ *
+ * returns:
+ *	64 bit hash as a static hash type
+ *
+ * NOTE: To use the 64 bit FNV-0 historic hash, use FNV0_64_INIT as the hval
+ *	 argument on the first call to either fnv_64_buf() or fnv_64_str().
+ *
+ * NOTE: To use the recommended 64 bit FNV-1 hash, use FNV1_64_INIT as the hval
+ *	 argument on the first call to either fnv_64_buf() or fnv_64_str().
+ */
+Fnv64_t
+fnv_64_buf(void *buf, size_t len, Fnv64_t hval)
+{
+    unsigned char *bp = (unsigned char *)buf;	/* start of buffer */
+    unsigned char *be = bp + len;		/* beyond end of buffer */
+
+    /*
+     * FNV-1 hash each octet of the buffer
+     */
+    while (bp < be) {
+
+	/* multiply by the 64 bit FNV magic prime mod 2^64 */
+	hval *= FNV_64_PRIME;
+
+	/* xor the bottom with the current octet */
+	hval ^= (Fnv64_t)*bp++;
+    }
+
+    /* return our new hash value */
+    return hval;
+}
+
+
+/*
+ * fnv_64_str - perform a 64 bit Fowler/Noll/Vo hash on a string
+ *
+ * input:
+ *	str	- string to hash
+ *	hval	- previous hash value or 0 if first call
+ *
+ * returns:
+ *	64 bit hash as a static hash type
+ *
+ * NOTE: To use the 64 bit FNV-0 historic hash, use FNV0_64_INIT as the hval
+ *	 argument on the first call to either fnv_64_buf() or fnv_64_str().
+ *
+ * NOTE: To use the recommended 64 bit FNV-1 hash, use FNV1_64_INIT as the hval
+ *	 argument on the first call to either fnv_64_buf() or fnv_64_str().
+ */
+Fnv64_t
+fnv_64_str(char *str, Fnv64_t hval)
+{
+    unsigned char *s = (unsigned char *)str;	/* unsigned string */
+
+    /*
+     * FNV-1 hash each octet of the string
+     */
+    while (*s) {
+
+	/* multiply by the 64 bit FNV magic prime mod 2^64 */
+	hval *= FNV_64_PRIME;
+
+	/* xor the bottom with the current octet */
+	hval ^= (Fnv64_t)*s++;
+    }
+
+    /* return our new hash value */
+    return hval;
+}
@@ -1,72 +1,398 @@
-#include <ctype.h>
+#include <fcntl.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 #include "hash_func.h"
 #include "fnv.h"
 
+#if defined (__AVX2__)
+#include <immintrin.h>
+#define _FOLD_WIDTH 32
+#elif defined (__SSE2__)
+#include <emmintrin.h>
+#define _FOLD_WIDTH 16
+#else
+#define _FOLD_WIDTH 8
+#endif
+
+static int _function = HASH_FUNC_FNV; // see hash_func_select
+
+/*
+ * ---------------------------------------------------------------------------
+ * wyhash: 64x64->128 bit multiplies folded back to 64 bits, over 8 to 48
+ * bytes per step
+ * ---------------------------------------------------------------------------
+ */
+
+static const unsigned long long _wysecret [4] = {
+  0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+  0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+static void
+_wymum (unsigned long long *a, unsigned long long *b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = (__uint128_t) *a * *b;
+  *a = (unsigned long long) r;
+  *b = (unsigned long long) (r >> 64);
+#else
+  unsigned long long ha = *a >> 32, hb = *b >> 32;
+  unsigned long long la = (unsigned int) *a, lb = (unsigned int) *b;
+  unsigned long long rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  unsigned long long t = rl + (rm0 << 32), c = t < rl, lo;
+  lo = t + (rm1 << 32);
+  c += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static unsigned long long
+_wymix (unsigned long long a, unsigned long long b) {
+  _wymum (&a, &b);
+  return a ^ b;
+}
+
+static unsigned long long
+_wyr8 (const unsigned char *p) {
+  unsigned long long v;
+  memcpy (&v, p, 8);
+  return v;
+}
+
+static unsigned long long
+_wyr4 (const unsigned char *p) {
+  unsigned int v;
+  memcpy (&v, p, 4);
+  return v;
+}
+
+static unsigned long long
+_wyr3 (const unsigned char *p, size_t k) {
+  return (((unsigned long long) p [0]) << 16) |
+    (((unsigned long long) p [k >> 1]) << 8) | p [k - 1];
+}
+
+unsigned long long
+hash_func_wyhash (void *value, size_t length, unsigned long long seed) {
+  const unsigned char *p = (const unsigned char *) value;
+  const unsigned long long *s = _wysecret;
+  unsigned long long a, b;
+  size_t i = length;
+
+  seed ^= _wymix (seed ^ s [0], s [1]);
+  if (length <= 16) {
+    if (length >= 4) {
+      a = (_wyr4 (p) << 32) | _wyr4 (p + ((length >> 3) << 2));
+      b = (_wyr4 (p + length - 4) << 32) |
+        _wyr4 (p + length - 4 - ((length >> 3) << 2));
+    } else if (length > 0) {
+      a = _wyr3 (p, length);
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    if (i > 48) {
+
+      /* three independent lanes keep the multipliers busy on long keys */
+      unsigned long long see1 = seed, see2 = seed;
+      do {
+        seed = _wymix (_wyr8 (p) ^ s [1], _wyr8 (p + 8) ^ seed);
+        see1 = _wymix (_wyr8 (p + 16) ^ s [2], _wyr8 (p + 24) ^ see1);
+        see2 = _wymix (_wyr8 (p + 32) ^ s [3], _wyr8 (p + 40) ^ see2);
+        p += 48;
+        i -= 48;
+      } while (i > 48);
+      seed ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      seed = _wymix (_wyr8 (p) ^ s [1], _wyr8 (p + 8) ^ seed);
+      p += 16;
+      i -= 16;
+    }
+    a = _wyr8 (p + i - 16);
+    b = _wyr8 (p + i - 8);
+  }
+
+  a ^= s [1];
+  b ^= seed;
+  _wymum (&a, &b);
+  return _wymix (a ^ s [0] ^ length, b ^ s [1]);
+}
+
+/*
+ * ---------------------------------------------------------------------------
+ * SipHash-2-4: a keyed hash; without the key, inputs that collide can't be
+ * found faster than by trying them
+ * ---------------------------------------------------------------------------
+ */
+
+#define _ROTL(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+
+#define _SIPROUND(v0, v1, v2, v3) do { \
+    v0 += v1; v1 = _ROTL (v1, 13); v1 ^= v0; v0 = _ROTL (v0, 32); \
+    v2 += v3; v3 = _ROTL (v3, 16); v3 ^= v2; \
+    v0 += v3; v3 = _ROTL (v3, 21); v3 ^= v0; \
+    v2 += v1; v1 = _ROTL (v1, 17); v1 ^= v2; v2 = _ROTL (v2, 32); \
+  } while (0)
+
+static unsigned long long
+_le64 (const unsigned char *p, size_t n) {
+  unsigned long long v = 0;
+  while (n --) v = (v << 8) | p [n];
+  return v;
+}
+
+unsigned long long
+hash_func_siphash (void *value, size_t length, const unsigned char *key) {
+  const unsigned char *p = (const unsigned char *) value;
+  const unsigned char *end = p + (length & ~(size_t) 7);
+  unsigned long long k0 = _le64 (key, 8), k1 = _le64 (key + 8, 8), m;
+  unsigned long long v0 = k0 ^ 0x736f6d6570736575ULL;
+  unsigned long long v1 = k1 ^ 0x646f72616e646f6dULL;
+  unsigned long long v2 = k0 ^ 0x6c7967656e657261ULL;
+  unsigned long long v3 = k1 ^ 0x7465646279746573ULL;
+
+  for (; p < end; p += 8) {
+    m = _le64 (p, 8);
+    v3 ^= m;
+    _SIPROUND (v0, v1, v2, v3);
+    _SIPROUND (v0, v1, v2, v3);
+    v0 ^= m;
+  }
+
+  m = ((unsigned long long) length << 56) | _le64 (p, length & 7);
+  v3 ^= m;
+  _SIPROUND (v0, v1, v2, v3);
+  _SIPROUND (v0, v1, v2, v3);
+  v0 ^= m;
+
+  v2 ^= 0xff;
+  _SIPROUND (v0, v1, v2, v3);
+  _SIPROUND (v0, v1, v2, v3);
+  _SIPROUND (v0, v1, v2, v3);
+  _SIPROUND (v0, v1, v2, v3);
+
+  return v0 ^ v1 ^ v2 ^ v3;
+}
+
+void
+hash_func_random_key (unsigned char *key) {
+  static unsigned long long counter;
+  unsigned long long mix [4];
+  size_t got = 0;
+  int fd = open ("/dev/urandom", O_RDONLY);
+
+  if (fd >= 0) {
+    while (got < HASH_FUNC_KEY_SIZE) {
+      ssize_t n = read (fd, key + got, HASH_FUNC_KEY_SIZE - got);
+      if (n <= 0) break;
+      got += (size_t) n;
+    }
+    close (fd);
+  }
+  if (HASH_FUNC_KEY_SIZE == got) return;
+
+  /* no /dev/urandom: the best we can do without one */
+  mix [0] = (unsigned long long) time (NULL);
+  mix [1] = (unsigned long long) clock () ^ ((unsigned long long) getpid () << 32);
+  mix [2] = (unsigned long long) (size_t) &mix ^ (unsigned long long) (size_t) key;
+  mix [3] = __atomic_add_fetch (&counter, 1, __ATOMIC_RELAXED);
+  mix [0] = hash_func_wyhash (mix, sizeof (mix), mix [3]);
+  mix [1] = hash_func_wyhash (mix, sizeof (mix), mix [0]);
+  memcpy (key, mix, HASH_FUNC_KEY_SIZE);
+}
+
+int
+hash_func_select (int function) {
+  int previous = _function;
+  _function = function;
+  return previous;
+}
+
 unsigned int
 hash_func_calculate (void *value, size_t length) {
+  if (HASH_FUNC_WYHASH == _function) {
+    unsigned long long hash = hash_func_wyhash (value, length, 0);
+    return (unsigned int) (hash ^ (hash >> 32));
+  }
   return (unsigned int) fnv_32_buf (value, length, FNV1_32_INIT);
 }
 
 unsigned int
 hash_func_accumulate (void *value, size_t length, unsigned int hash) {
+  if (HASH_FUNC_WYHASH == _function) {
+    unsigned long long wy = hash_func_wyhash (value, length, hash);
+    return (unsigned int) (wy ^ (wy >> 32));
+  }
   return (unsigned int) fnv_32_buf (value, length, (u_long) hash);
 }
 
+unsigned long long
+hash_func_calculate64 (void *value, size_t length) {
+  if (HASH_FUNC_WYHASH == _function)
+    return hash_func_wyhash (value, length, 0);
+  return fnv_64_buf (value, length, FNV1_64_INIT);
+}
+
+unsigned long long
+hash_func_accumulate64 (void *value, size_t length, unsigned long long hash) {
+  if (HASH_FUNC_WYHASH == _function)
+    return hash_func_wyhash (value, length, hash);
+  return fnv_64_buf (value, length, (Fnv64_t) hash);
+}
+
 int
 hash_string_comparator (void *s1, void *s2) {
   return strcmp ((char *) s1, (char *) s2);
 }
 
-int
-hash_nocase_string_comparator (void *s1, void *s2) {
-  int i = 0;
-  char *str1 = (char *) s1;
-  char *str2 = (char *) s2;
-  char c1;
-  char c2;
+unsigned int
+hash_string_calculator (void *string) {
+  return hash_func_calculate ((void *) string, strlen ((char *) string));
+}
 
-  for (i = 0;; i++) {
+unsigned long long
+hash_string_calculator64 (void *string) {
+  return hash_func_calculate64 ((void *) string, strlen ((char *) string));
+}
 
-    if (str1 [i] == 0x00 && str2 [i] == 0x00)
-      return 0;
+/*
+ * a HASH_STRING hashes like the same bytes under hash_string_calculator
+ */
+unsigned int
+hash_length_string_calculator (void *string) {
+  HASH_STRING *s = (HASH_STRING *) string;
+  if (0 == s -> hash)
+    s -> hash = hash_func_calculate ((void *) s -> string, s -> length);
+  return s -> hash;
+}
+
+int
+hash_length_string_comparator (void *s1, void *s2) {
+  HASH_STRING *a = (HASH_STRING *) s1;
+  HASH_STRING *b = (HASH_STRING *) s2;
+  if (a -> length != b -> length) return a -> length < b -> length ? -1 : 1;
+  return memcmp (a -> string, b -> string, a -> length);
+}
 
-    if (str2 [i] == 0x00)
-      return -1;
+unsigned long long
+hash_string_keyed_calculator (void *string, const unsigned char *key) {
+  return hash_func_siphash (string, strlen ((char *) string), key);
+}
 
-    if (str1 [i] == 0x00)
-      return 1;
+/*
+ * ---------------------------------------------------------------------------
+ * case-insensitive strings: ASCII upper case is folded to lower case a
+ * vector at a time (32 bytes with AVX2, 16 with SSE2, 8 otherwise); bytes
+ * outside A-Z, including every byte of a multi-byte character, are left as
+ * they are
+ * ---------------------------------------------------------------------------
+ */
 
-    c1 = tolower (str1 [i]);
-    c2 = tolower (str2 [i]);
+#define _LOWER(c) ((unsigned char) ((c) - 'A') < 26 ? (c) | 0x20 : (c))
+#define _NOCASE_CHUNK 64 // bytes folded into a buffer per hash step
 
-    if (c1 > c2)
-      return -1;
+#if defined (__AVX2__)
+static __m256i
+_fold_vector (__m256i v) {
+  __m256i upper = _mm256_and_si256 (
+    _mm256_cmpgt_epi8 (v, _mm256_set1_epi8 ('A' - 1)),
+    _mm256_cmpgt_epi8 (_mm256_set1_epi8 ('Z' + 1), v));
+  return _mm256_or_si256 (v, _mm256_and_si256 (upper, _mm256_set1_epi8 (0x20)));
+}
+#elif defined (__SSE2__)
+static __m128i
+_fold_vector (__m128i v) {
+  __m128i upper = _mm_and_si128 (
+    _mm_cmpgt_epi8 (v, _mm_set1_epi8 ('A' - 1)),
+    _mm_cmplt_epi8 (v, _mm_set1_epi8 ('Z' + 1)));
+  return _mm_or_si128 (v, _mm_and_si128 (upper, _mm_set1_epi8 (0x20)));
+}
+#endif
 
-    if (c1 < c2)
-      return 1;
+static void
+_fold (unsigned char *dst, const unsigned char *src) {
+#if defined (__AVX2__)
+  _mm256_storeu_si256 ((__m256i *) dst,
+    _fold_vector (_mm256_loadu_si256 ((__m256i *) src)));
+#elif defined (__SSE2__)
+  _mm_storeu_si128 ((__m128i *) dst,
+    _fold_vector (_mm_loadu_si128 ((__m128i *) src)));
+#else
+  int i;
+  for (i = 0; i < _FOLD_WIDTH; i ++) dst [i] = _LOWER (src [i]);
+#endif
+}
 
-  }
+/* non-zero if _FOLD_WIDTH bytes at a and b are equal but for case */
+static int
+_fold_equal (const unsigned char *a, const unsigned char *b) {
+#if defined (__AVX2__)
+  return -1 == _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (
+    _fold_vector (_mm256_loadu_si256 ((__m256i *) a)),
+    _fold_vector (_mm256_loadu_si256 ((__m256i *) b))));
+#elif defined (__SSE2__)
+  return 0xffff == _mm_movemask_epi8 (_mm_cmpeq_epi8 (
+    _fold_vector (_mm_loadu_si128 ((__m128i *) a)),
+    _fold_vector (_mm_loadu_si128 ((__m128i *) b))));
+#else
+  int i;
+  for (i = 0; i < _FOLD_WIDTH; i ++)
+    if (_LOWER (a [i]) != _LOWER (b [i])) return 0;
+  return 1;
+#endif
+}
 
-  return 0;
+/* folds length bytes (at most _NOCASE_CHUNK) from src into dst */
+static void
+_fold_chunk (unsigned char *dst, const unsigned char *src, size_t length) {
+  size_t i = 0;
+  for (; i + _FOLD_WIDTH <= length; i += _FOLD_WIDTH) _fold (dst + i, src + i);
+  for (; i < length; i ++) dst [i] = _LOWER (src [i]);
 }
 
-unsigned int
-hash_string_calculator (void *string) {
-  return hash_func_calculate ((void *) string, strlen ((char *) string));
+int
+hash_nocase_string_comparator (void *s1, void *s2) {
+  const unsigned char *a = (const unsigned char *) s1;
+  const unsigned char *b = (const unsigned char *) s2;
+  size_t la = strlen ((char *) a), lb = strlen ((char *) b);
+  size_t n = la < lb ? la : lb, i = 0;
+  unsigned char ca, cb;
+
+  /* skip the equal vectors; the first difference is found byte by byte */
+  for (; i + _FOLD_WIDTH <= n; i += _FOLD_WIDTH) {
+    if (!_fold_equal (a + i, b + i)) break;
+  }
+  for (; i < n; i ++) {
+    if (_LOWER (a [i]) != _LOWER (b [i])) break;
+  }
+
+  ca = i < la ? _LOWER (a [i]) : 0x00;
+  cb = i < lb ? _LOWER (b [i]) : 0x00;
+  if (ca == cb) return 0;
+  return ca > cb ? -1 : 1;
 }
 
+/*
+ * the hash of the folded string, so that strings equal but for case hash
+ * the same
+ */
 unsigned int
 hash_nocase_string_calculator (void *s) {
-  unsigned int hash = 0;
-  char *str = (char *) s;
-  char c;
-  int i;
-  int len = strlen (str);
+  const unsigned char *str = (const unsigned char *) s;
+  size_t length = strlen ((char *) str);
+  size_t n = length < _NOCASE_CHUNK ? length : _NOCASE_CHUNK;
+  unsigned char folded [_NOCASE_CHUNK];
+  unsigned int hash;
 
-  for (i = 0; i < len; i ++) {
-    c = tolower (str [i]);
-    hash = hash_func_calculate (&c, 1);
+  _fold_chunk (folded, str, n);
+  hash = hash_func_calculate (folded, n);
+  for (str += n, length -= n; length; str += n, length -= n) {
+    n = length < _NOCASE_CHUNK ? length : _NOCASE_CHUNK;
+    _fold_chunk (folded, str, n);
+    hash = hash_func_accumulate (folded, n, hash);
   }
 
   return hash;
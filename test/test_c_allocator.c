@@ -0,0 +1,154 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c_allocator.h"
+#include "c_array.h"
+#include "c_buffer.h"
+#include "c_dict.h"
+#include "c_keyedset.h"
+#include "c_list.h"
+#include "c_map.h"
+#include "hash_func.h"
+
+/*
+ * an allocator that counts the blocks it has handed out; each block carries
+ * its size in front so that realloc can be checked as well
+ */
+typedef struct COUNTER {
+  int blocks;
+  int calls;
+} COUNTER;
+
+static void *
+_alloc (size_t size, void *context) {
+  COUNTER *c = (COUNTER *) context;
+  size_t *p = (size_t *) malloc (sizeof (size_t) * 2 + size);
+  if (!p) return NULL;
+  *p = size;
+  c -> blocks += 1;
+  c -> calls += 1;
+  return p + 2;
+}
+
+static void *
+_realloc (void *ptr, size_t size, void *context) {
+  COUNTER *c = (COUNTER *) context;
+  size_t *p;
+  if (!ptr) return _alloc (size, context);
+  p = (size_t *) realloc ((size_t *) ptr - 2, sizeof (size_t) * 2 + size);
+  if (!p) return NULL;
+  *p = size;
+  c -> calls += 1;
+  return p + 2;
+}
+
+static void
+_free (void *ptr, void *context) {
+  COUNTER *c = (COUNTER *) context;
+  c -> blocks -= 1;
+  free ((size_t *) ptr - 2);
+}
+
+static COUNTER counter;
+static C_ALLOCATOR counting = {_alloc, _realloc, _free, &counter};
+
+int main (void) {
+  C_ALLOCATOR *previous;
+  C_ITERATOR *i;
+  char key [16];
+  int n, calls;
+
+  assert (c_allocator_default () == c_allocator_get ());
+  assert (c_allocator_default () == c_allocator_set (&counting));
+  assert (&counting == c_allocator_get ());
+  assert (&counting == c_allocator_set (NULL));
+  assert (c_allocator_default () == c_allocator_get ());
+
+  /* map */
+  previous = c_allocator_set (&counting);
+  C_MAP *m = c_map_dict_create (NULL);
+  c_allocator_set (previous);
+  assert (m);
+  assert (counter.blocks > 0);
+
+  for (n = 0; n < 1000; n ++) {
+    sprintf (key, "key%d", n);
+    c_map_add (m, strdup (key), NULL);
+  }
+  calls = counter.calls;
+  for (i = c_map_key_iterator (m), n = 0; c_iterator_has_next (i); n ++) {
+    free (c_iterator_next (i));
+  }
+  assert (1000 == n);
+  assert (calls < counter.calls); // iterator came from the map's allocator
+  n = counter.blocks;
+  c_map_clear (m);
+  assert (n - counter.blocks < 50); // slab chunks, not a block per bucket
+  c_map_free (m);
+  assert (0 == counter.blocks);
+
+  /* the allocator is captured when the collection is created */
+  previous = c_allocator_set (&counting);
+  C_DICT *d = c_dict_create ();
+  c_allocator_set (previous);
+  calls = counter.calls;
+  for (n = 0; n < 100; n ++) {
+    sprintf (key, "key%d", n);
+    assert (0 == c_dict_add (d, key, key));
+  }
+  assert (calls < counter.calls);
+  assert (0 == strcmp ("key42", c_dict_find (d, "key42")));
+  for (i = c_dict_iterator (d); c_iterator_next (i); );
+  c_dict_free (d);
+  assert (0 == counter.blocks);
+
+  /* array, buffer, list, keyedset and a sized map */
+  previous = c_allocator_set (&counting);
+  C_MAP *sized = c_map_dict_create_size (NULL, 500);
+  C_ARRAY *a = c_array_create (sizeof (int));
+  C_BUFFER *b = c_buffer_create ();
+  C_LIST *l = c_list_create ();
+  C_KEYEDSET *k = c_keyedset_create ();
+  c_allocator_set (previous);
+  assert (sized && a && b && l && k);
+
+  for (n = 0; n < 1000; n ++) {
+    assert (0 == c_array_append (a, &n));
+    assert (0 == c_buffer_append_int (b, n));
+    assert (0 == c_list_add (l, NULL));
+  }
+  for (i = c_array_iterator (a); c_iterator_next (i); );
+  for (i = c_list_iterator (l); c_iterator_next (i); );
+  c_map_free (sized);
+  c_array_free (a);
+  c_buffer_free (b);
+  c_list_free (l);
+  c_keyedset_free (k);
+  assert (0 == counter.blocks);
+
+  /* shrinking a map gives its emptied slab chunks back */
+  previous = c_allocator_set (&counting);
+  m = c_map_create (hash_uint_calculator, hash_uint_comparator, NULL);
+  c_allocator_set (previous);
+  calls = counter.blocks;
+  unsigned int numbers [1000];
+  for (n = 0; n < 1000; n ++) {
+    numbers [n] = n;
+    assert (0 == c_map_add (m, &numbers [n], NULL));
+  }
+  for (n = 0; n < 1000; n ++) c_map_remove (m, &numbers [n]);
+  assert (0 == c_map_shrink_to_fit (m));
+  assert (counter.blocks <= calls + 1); // just the (initial size) table
+  c_map_free (m);
+  assert (0 == counter.blocks);
+
+  /* collections created with the default allocator don't use it */
+  calls = counter.calls;
+  m = c_map_dict_create (NULL);
+  c_map_add (m, "a", "b");
+  c_map_free (m);
+  assert (calls == counter.calls);
+
+  return 0;
+}
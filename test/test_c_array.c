@@ -1,4 +1,6 @@
 #include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "c_array.h"
@@ -16,6 +18,31 @@ typedef struct TEST_ARRAY {
     char *buffer;
 } TEST_ARRAY;
 
+static int
+is_odd (void *element, void *context) {
+    (* (int *) context) ++;
+    return * (int *) element % 2;
+}
+
+typedef struct RECORD {
+    int id;
+    double score;
+} RECORD;
+
+static int
+compare_int (const void *e1, const void *e2) {
+    int i1 = * (const int *) e1, i2 = * (const int *) e2;
+    return i1 < i2 ? -1 : i1 > i2;
+}
+
+/* by score only, so records with the same score are equal */
+static int
+compare_score (const void *e1, const void *e2) {
+    double s1 = ((const RECORD *) e1) -> score;
+    double s2 = ((const RECORD *) e2) -> score;
+    return s1 < s2 ? -1 : s1 > s2;
+}
+
 int main (int argc, char **argv) {
     C_ARRAY *a = c_array_create (sizeof(int));
     assert (a);
@@ -131,6 +158,151 @@ int main (int argc, char **argv) {
     assert (3 == ((TEST_ARRAY *) a) -> buffer_length);
     assert (data[2] == * ((int *) c_array_get (a, 2)));
     assert (3 == c_array_length (a));
+    c_array_free (a);
+
+    /* bulk append, insert and erase */
+    a = c_array_create (sizeof(int));
+    int many[100];
+    for (i = 0; i < 100; i++) many[i] = i;
+    assert (0 == c_array_append_n (a, many, 100));
+    assert (100 == c_array_length (a));
+    assert (0 == c_array_append_n (a, many, 0));
+    for (i = 0; i < 100; i++) assert (i == * (int *) c_array_get (a, i));
+    assert (0 == c_array_erase_range (a, 10, 80)); // 0..9, 90..99
+    assert (20 == c_array_length (a));
+    assert (9 == * (int *) c_array_get (a, 9));
+    assert (90 == * (int *) c_array_get (a, 10));
+    assert (0 == c_array_insert_at (a, 10, many + 10, 80));
+    assert (100 == c_array_length (a));
+    for (i = 0; i < 100; i++) assert (i == * (int *) c_array_get (a, i));
+    assert (0 == c_array_insert_at (a, 100, data, 1)); // append
+    assert (1 == * (int *) c_array_get (a, -1));
+    assert (0 == c_array_insert_at (a, -1, data + 1, 1)); // before last
+    assert (2 == * (int *) c_array_get (a, -2));
+    assert (0 == c_array_erase_range (a, -2, 2));
+    assert (0 == c_array_insert_at (a, 0, data, 2));
+    assert (1 == * (int *) c_array_get (a, 0));
+    assert (2 == * (int *) c_array_get (a, 1));
+    assert (0 == * (int *) c_array_get (a, 2));
+    assert (0 == c_array_erase_range (a, 0, 2));
+    assert (0 != c_array_insert_at (a, 101, data, 1));
+    assert (0 != c_array_erase_range (a, 90, 11));
+    assert (0 != c_array_erase_range (a, -101, 1));
+    assert (100 == c_array_length (a));
+
+    /* remove_if keeps the order of what is left */
+    int calls = 0;
+    assert (50 == c_array_remove_if (a, is_odd, &calls));
+    assert (100 == calls);
+    assert (50 == c_array_length (a));
+    for (i = 0; i < 50; i++) assert (2 * i == * (int *) c_array_get (a, i));
+    assert (0 == c_array_remove_if (a, is_odd, &calls));
+    c_array_clear (a);
+    int mixed[] = {1, 3, 4, 6, 7, 8, 9};
+    c_array_append_n (a, mixed, 7);
+    assert (4 == c_array_remove_if (a, is_odd, &calls));
+    assert (3 == c_array_length (a));
+    assert (4 == * (int *) c_array_get (a, 0));
+    assert (6 == * (int *) c_array_get (a, 1));
+    assert (8 == * (int *) c_array_get (a, 2));
+    c_array_free (a);
+
+    /* comparator sorts and searches */
+    a = c_array_create (sizeof(int));
+    srand (7);
+    for (i = 0; i < 10000; i++) {
+        int r = rand () % 5000;
+        c_array_append (a, &r);
+    }
+    C_ARRAY *b = c_array_create (sizeof(int));
+    c_array_append_n (b, c_array_get (a, 0), c_array_length (a));
+    c_array_sort (a, compare_int);
+    for (i = 1; i < 10000; i++)
+        assert (* (int *) c_array_get (a, i - 1) <= * (int *) c_array_get (a, i));
+    int median = * (int *) c_array_get (a, 5000);
+    int first = * (int *) c_array_get (a, 0);
+    assert (0 == c_array_nth_element (b, 5000, compare_int));
+    assert (median == * (int *) c_array_get (b, 5000));
+    for (i = 0; i < 5000; i++) assert (* (int *) c_array_get (b, i) <= median);
+    for (i = 5001; i < 10000; i++) assert (* (int *) c_array_get (b, i) >= median);
+    assert (0 != c_array_nth_element (b, 10000, compare_int));
+    assert (0 == c_array_partial_sort (b, 100, compare_int));
+    for (i = 0; i < 100; i++)
+        assert (* (int *) c_array_get (a, i) == * (int *) c_array_get (b, i));
+    assert (0 == c_array_stable_sort (b, compare_int));
+    assert (0 == memcmp (c_array_get (a, 0), c_array_get (b, 0), 10000 * sizeof(int)));
+
+    int low = c_array_lower_bound (a, &median, compare_int);
+    int high = c_array_upper_bound (a, &median, compare_int);
+    assert (low < high);
+    assert (low == 0 || * (int *) c_array_get (a, low - 1) < median);
+    for (i = low; i < high; i++) assert (median == * (int *) c_array_get (a, i));
+    assert (high == 10000 || * (int *) c_array_get (a, high) > median);
+    i = c_array_bsearch (a, &median, compare_int);
+    assert (i >= low && i < high);
+    int absent = -1;
+    assert (-1 == c_array_bsearch (a, &absent, compare_int));
+    assert (0 == c_array_lower_bound (a, &absent, compare_int));
+    absent = 5000;
+    assert (10000 == c_array_lower_bound (a, &absent, compare_int));
+    assert (0 == c_array_lower_bound (a, &first, compare_int));
+
+    /* key sorts agree with the comparator sorts */
+    for (int n = 10; n <= 10000; n *= 1000) {
+        c_array_clear (b);
+        for (i = 0; i < n; i++) {
+            int r = rand () % 20001 - 10000;
+            c_array_append (b, &r);
+        }
+        c_array_clear (a);
+        c_array_append_n (a, c_array_get (b, 0), n);
+        c_array_sort (a, compare_int);
+        assert (0 == c_array_sort_key (b, C_ARRAY_KEY_INT32, 0));
+        assert (0 == memcmp (c_array_get (a, 0), c_array_get (b, 0), n * sizeof(int)));
+    }
+    int zero = 0;
+    low = c_array_lower_bound_key (b, C_ARRAY_KEY_INT32, 0, &zero);
+    assert (low == c_array_lower_bound (b, &zero, compare_int));
+    assert (c_array_upper_bound_key (b, C_ARRAY_KEY_INT32, 0, &zero) ==
+        c_array_upper_bound (b, &zero, compare_int));
+    assert (0 != c_array_sort_key (b, C_ARRAY_KEY_INT64, 0)); // too wide
+    assert (0 != c_array_sort_key (b, 0, 0));
+    assert (-1 == c_array_lower_bound_key (b, C_ARRAY_KEY_INT32, 1, &zero));
+    c_array_free (a);
+    c_array_free (b);
+
+    /* records: stable by score, both ways */
+    a = c_array_create (sizeof(RECORD));
+    b = c_array_create (sizeof(RECORD));
+    double scores[] = {2.5, -1.0, -0.0, 0.0, 1e300, -3.25, 2.5, -1.0};
+    for (int n = 8; n <= 8000; n *= 1000) {
+        c_array_clear (a);
+        for (i = 0; i < n; i++) {
+            RECORD r = {i, i < 8 ? scores[i] : (rand () % 2001 - 1000) / 8.0};
+            c_array_append (a, &r);
+        }
+        c_array_clear (b);
+        c_array_append_n (b, c_array_get (a, 0), n);
+        assert (0 == c_array_stable_sort (a, compare_score));
+        assert (0 == c_array_sort_key (b, C_ARRAY_KEY_DOUBLE,
+            offsetof (RECORD, score)));
+        for (i = 0; i < n; i++) {
+            RECORD *r1 = (RECORD *) c_array_get (a, i);
+            RECORD *r2 = (RECORD *) c_array_get (b, i);
+            assert (r1 -> id == r2 -> id);
+            if (i > 0 && r1 -> score == (r1 - 1) -> score)
+                assert (r1 -> id > (r1 - 1) -> id); // stable
+        }
+    }
+    double value = 0.0;
+    low = c_array_lower_bound_key (b, C_ARRAY_KEY_DOUBLE, offsetof (RECORD, score), &value);
+    high = c_array_upper_bound_key (b, C_ARRAY_KEY_DOUBLE, offsetof (RECORD, score), &value);
+    for (i = low; i < high; i++)
+        assert (0.0 == ((RECORD *) c_array_get (b, i)) -> score);
+    assert (0.0 < ((RECORD *) c_array_get (b, high)) -> score);
+    assert (0.0 >= ((RECORD *) c_array_get (b, low - 1)) -> score); // -0.0 sorts first
+    c_array_free (a);
+    c_array_free (b);
 
   return 0;
 }
@@ -0,0 +1,132 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c_concurrent_map.h"
+#include "hash_func.h"
+
+#define THREADS 8
+#define KEYS 5000
+
+static C_CONCURRENT_MAP *cm;
+
+static void
+_garbage (void *key, void *value) {
+  free (key);
+}
+
+/* counts the keys hashed */
+static int hashed;
+
+static unsigned int
+_counting_calculator (void *key) {
+  hashed += 1;
+  return hash_string_calculator (key);
+}
+
+static int
+_count (void *key, void *value, void *context) {
+  int *count = (int *) context;
+  *count += 1;
+  return 0;
+}
+
+static int
+_stop (void *key, void *value, void *context) {
+  return 0 == strcmp ((char *) key, (char *) context) ? 42 : 0;
+}
+
+/*
+ * each thread adds its own keys, checks them, removes every other one and
+ * reads the shared keys the whole time
+ */
+static void *
+_worker (void *arg) {
+  int t = (int) (size_t) arg;
+  char key [32];
+  int i;
+
+  for (i = 0; i < KEYS; i ++) {
+    sprintf (key, "t%d-%d", t, i);
+    assert (0 == c_concurrent_map_insert (cm, strdup (key), (void *) arg));
+    assert (c_concurrent_map_exists (cm, "shared-7"));
+  }
+  for (i = 0; i < KEYS; i ++) {
+    sprintf (key, "t%d-%d", t, i);
+    assert ((void *) arg == c_concurrent_map_find (cm, key));
+    if (i % 2) c_concurrent_map_remove (cm, key);
+  }
+  for (i = 0; i < KEYS; i ++) {
+    sprintf (key, "t%d-%d", t, i);
+    assert ((i % 2 ? 0 : 1) == c_concurrent_map_exists (cm, key));
+  }
+
+  return NULL;
+}
+
+int main (void) {
+  pthread_t thread [THREADS];
+  static char keys [1000][8];
+  char key [32];
+  int i, count;
+
+  cm = c_concurrent_map_dict_create (_garbage, 10);
+  assert (cm);
+  assert (16 == c_concurrent_map_shards (cm));
+  assert (0 == c_concurrent_map_size (cm));
+
+  for (i = 0; i < 100; i ++) {
+    sprintf (key, "shared-%d", i);
+    assert (0 == c_concurrent_map_insert (cm, strdup (key), NULL));
+  }
+  assert (C_CONCURRENT_MAP_ERROR_DUPLICATE ==
+    c_concurrent_map_insert (cm, "shared-7", NULL));
+  assert (0 == c_concurrent_map_add (cm, strdup ("shared-7"), "seven"));
+  assert (0 == strcmp ("seven", c_concurrent_map_find (cm, "shared-7")));
+  assert (100 == c_concurrent_map_size (cm));
+
+  for (i = 0; i < THREADS; i ++) {
+    assert (0 == pthread_create (&thread [i], NULL, _worker,
+      (void *) (size_t) (i + 1)));
+  }
+  for (i = 0; i < THREADS; i ++) pthread_join (thread [i], NULL);
+
+  assert (100 + THREADS * KEYS / 2 == c_concurrent_map_size (cm));
+  count = 0;
+  assert (0 == c_concurrent_map_foreach (cm, _count, &count));
+  assert (100 + THREADS * KEYS / 2 == count);
+  assert (42 == c_concurrent_map_foreach (cm, _stop, "t3-42"));
+
+  c_concurrent_map_clear (cm);
+  assert (0 == c_concurrent_map_size (cm));
+  assert (NULL == c_concurrent_map_find (cm, "shared-7"));
+  c_concurrent_map_free (cm);
+
+  /* every call hashes its key once, duplicate or not */
+  cm = c_concurrent_map_create (_counting_calculator, hash_string_comparator,
+    NULL, 0);
+  for (i = 0; i < 1000; i ++) {
+    sprintf (keys [i], "k%d", i);
+    assert (0 == c_concurrent_map_insert (cm, keys [i], keys [i]));
+  }
+  hashed = 0;
+  assert (C_CONCURRENT_MAP_ERROR_DUPLICATE ==
+    c_concurrent_map_insert (cm, keys [5], NULL));
+  assert (keys [5] == c_concurrent_map_find (cm, "k5"));
+  assert (c_concurrent_map_exists (cm, "k5"));
+  assert (0 == c_concurrent_map_add (cm, keys [5], NULL));
+  assert (0 == c_concurrent_map_add (cm, "new", NULL));
+  c_concurrent_map_remove (cm, "k5");
+  assert (6 == hashed);
+  assert (!c_concurrent_map_exists (cm, "k5"));
+  c_concurrent_map_free (cm);
+
+  cm = c_concurrent_map_dict_create (NULL, 1);
+  assert (1 == c_concurrent_map_shards (cm));
+  assert (0 == c_concurrent_map_add (cm, "a", "b"));
+  assert (0 == strcmp ("b", c_concurrent_map_find (cm, "a")));
+  c_concurrent_map_free (cm);
+
+  return 0;
+}
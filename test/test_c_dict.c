@@ -1,6 +1,23 @@
 #include <assert.h>
+#include <stdio.h>
 #include <string.h>
 #include "c_dict.h"
+#include "c_hash.h"
+
+/*
+ * linked with -Wl,--wrap=c_hash_find, so every table lookup made by the
+ * library goes through here and is counted
+ */
+static int lookups;
+
+void *__real_c_hash_find (C_HASH *, void *item);
+void *__wrap_c_hash_find (C_HASH *, void *item);
+
+void *
+__wrap_c_hash_find (C_HASH *h, void *item) {
+  lookups += 1;
+  return __real_c_hash_find (h, item);
+}
 
 int main (void) {
   C_ITERATOR *i;
@@ -41,9 +58,106 @@ int main (void) {
   assert (3 == c_dict_size (d));
   assert (0 == c_dict_find (d, "three"));
 
+  /* a find is one lookup, hit or miss, and none given the interned key */
+  lookups = 0;
+  assert (0 == strcmp ("eleven", c_dict_find (d, "one")));
+  assert (1 == lookups);
+  assert (NULL == c_dict_find (d, "eleven"));
+  assert (NULL == c_dict_find (d, "nine"));
+  assert (3 == lookups);
+  assert (0 == strcmp ("fourteen",
+    c_dict_find_symbol (d, c_dict_key (d, "four", 4))));
+  assert (4 == lookups);
+
   c_dict_clear (d);
   assert (0 == c_dict_size (d));
+  assert (NULL == c_dict_find (d, "one"));
+
+  c_dict_free (d);
+
+  d = c_dict_create_size (1000);
+  assert (d);
+  assert (0 == c_dict_reserve (d, 5000));
+  assert (0 == c_dict_add (d, "one", "eleven"));
+  assert (0 == c_dict_shrink_to_fit (d));
+  assert (0 == strcmp (c_dict_find (d, "one"), "eleven"));
+  c_dict_free (d);
 
+  d = c_dict_create ();
+  char *header = "Host: example.com\r\n";
+  assert (0 == c_dict_add_n (d, header, 4, header + 6, 11));
+  assert (0 == strcmp (c_dict_find (d, "Host"), "example.com"));
+  assert (0 == strcmp (c_dict_find_n (d, header, 4), "example.com"));
+  assert (NULL == c_dict_find_n (d, header, 3));
+  assert (-3 == c_dict_add_n (d, header, 0, header, 4));
+  assert (-3 == c_dict_add (d, "", "empty"));
   c_dict_free (d);
+
+  d = c_dict_create_keyed (0);
+  assert (0 == c_dict_add (d, "one", "eleven"));
+  assert (0 == c_dict_add (d, "two", "twelve"));
+  assert (0 == strcmp (c_dict_find (d, "two"), "twelve"));
+  c_dict_remove (d, "two");
+  assert (NULL == c_dict_find (d, "two"));
+  assert (1 == c_dict_size (d));
+  c_dict_free (d);
+
+  d = c_dict_create ();
+  assert (0 == c_dict_add (d, "one", "eleven"));
+  const char *key = c_dict_key (d, "one!", 3);
+  assert (key);
+  assert (0 == strcmp (c_dict_find_symbol (d, key), "eleven"));
+  assert (NULL == c_dict_key (d, "two", 3));
+  c_dict_remove (d, "two");
+  c_dict_remove (d, "one");
+  assert (NULL == c_dict_find_symbol (d, key));
+  assert (0 == c_dict_size (d));
+  c_dict_free (d);
+
+  d = c_dict_create_keyed (0);
+  assert (0 == c_dict_add (d, "one", "eleven"));
+  assert (0 == c_dict_add (d, "two", "twelve"));
+  assert (0 == c_dict_add (d, "three", "eleven"));
+  C_FROZEN_DICT *f = c_dict_freeze (d);
+  assert (f);
+  assert (3 == c_frozen_dict_size (f));
+  assert (0 == strcmp (c_frozen_dict_find (f, "one"), "eleven"));
+  assert (0 == strcmp (c_frozen_dict_find (f, "three"), "eleven"));
+  assert (0 == strcmp (c_frozen_dict_find_n (f, "twofold", 3), "twelve"));
+  assert (NULL == c_frozen_dict_find (f, "four"));
+  assert (NULL == c_frozen_dict_find_n (f, "thre", 4));
+  C_DICTITEM pair = c_frozen_dict_item (f, 2);
+  assert (pair.key && c_frozen_dict_find (f, pair.key) == pair.value);
+  assert (NULL == c_frozen_dict_item (f, 3).key);
+  c_frozen_dict_free (f);
+
+  d = c_dict_create ();
+  char name [16], value [16];
+  int n;
+  for (n = 0; n < 10000; n ++) {
+    sprintf (name, "key%d", n);
+    sprintf (value, "value%d", n % 100);
+    assert (0 == c_dict_add (d, name, value));
+  }
+  assert (0 == c_dict_save (d, "test_c_dict.dat"));
+  c_dict_free (d);
+  f = c_frozen_dict_load ("test_c_dict.dat");
+  assert (f);
+  assert (10000 == c_frozen_dict_size (f));
+  for (n = 0; n < 10000; n ++) {
+    sprintf (name, "key%d", n);
+    sprintf (value, "value%d", n % 100);
+    assert (0 == strcmp (c_frozen_dict_find (f, name), value));
+  }
+  assert (NULL == c_frozen_dict_find (f, "key10000"));
+  c_frozen_dict_free (f);
+
+  FILE *file = fopen ("test_c_dict.dat", "r+b"); // damage the header
+  fseek (file, 32, SEEK_SET);
+  fputc (0xff, file);
+  fclose (file);
+  assert (NULL == c_frozen_dict_load ("test_c_dict.dat"));
+  remove ("test_c_dict.dat");
+  assert (NULL == c_frozen_dict_load ("test_c_dict.dat"));
   return 0;
 }
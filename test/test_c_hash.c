@@ -1,5 +1,9 @@
 #include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 #include "c_hash.h"
 #include "hash_func.h"
 
@@ -22,6 +26,25 @@ _compare (void *item1, void *item2, void *context) {
   return hash_string_comparator (s1 -> value, s2 -> value);
 }
 
+/*
+ * a 64-bit hash whose low 32 bits take only 256 values, so that only the
+ * high bits tell most items apart
+ */
+static int compares;
+
+static unsigned long long
+_calc64 (void *item, void *context) {
+  STRING *s = (STRING *) item;
+  unsigned long long hash = hash_string_calculator64 (s -> value);
+  return (hash & 0xffffffff00000000ULL) | (hash & 0xff);
+}
+
+static int
+_compare_count (void *item1, void *item2, void *context) {
+  compares += 1;
+  return _compare (item1, item2, context);
+}
+
 static void
 _garbage (void *item, void *context) {
   STRING *s = (STRING *) item;
@@ -34,6 +57,31 @@ _extractor (void *item) {
   return s -> value;
 }
 
+static int
+_visit_count (void *item, void *context) {
+  (* (int *) context) ++;
+  return 0;
+}
+
+/*
+ * concurrent readers: finds leave the table alone, so threads can share it
+ */
+static C_HASH *shared;
+static char (*shared_keys) [8];
+#define SHARED_KEYS 800
+
+static void *
+_reader (void *arg) {
+  STRING s;
+  int i;
+  for (i = 0; i < SHARED_KEYS; i ++) {
+    s.value = shared_keys [i];
+    assert (c_hash_find (shared, &s));
+    assert (shared_keys [i] == ((STRING *) c_hash_find (shared, &s)) -> value);
+  }
+  return NULL;
+}
+
 int main (void) {
   STRING s;
 
@@ -156,5 +204,486 @@ int main (void) {
   assert (0 == c_hash_replace (h, &s)); // orphans previous "foobar"
   c_hash_free (h); // valgrind will tell you if everything was freed
 
+  /* open addressing */
+  char *number [] = {"1", "2", "3", "4", "5", "6", "7", "8", "9", "10", "11",
+    "12", "13", "14", "15", "16", "17", "18", "19", "20"};
+  h = c_hash_create_base (sizeof (STRING), _calc, _compare, 0, 0, 0,
+    C_HASH_OPEN);
+  for (count = 0; count < 12; count ++) {
+    s.value = number [count];
+    assert (0 == c_hash_insert (h, &s));
+  }
+  assert (C_HASH_ERROR_DUPLICATE == c_hash_insert (h, &s));
+  assert (12 == c_hash_size (h));
+  assert (16 == c_hash_table_size (h));
+  s.value = "13";
+  assert (0 == c_hash_insert (h, &s));
+  assert (32 == c_hash_table_size (h));
+  assert (0 == strcmp ("13", ((STRING *) c_hash_find (h, &s)) -> value));
+
+  s.value = "5";
+  c_hash_remove (h, &s);
+  assert (NULL == c_hash_find (h, &s));
+  assert (12 == c_hash_size (h));
+  s.value = "6";
+  assert (c_hash_find (h, &s)); // still reachable past the deleted slot
+  s.value = "5";
+  assert (0 == c_hash_insert (h, &s));
+  assert (13 == c_hash_size (h));
+
+  count = 0;
+  it = c_hash_iterator (h, _extractor);
+  while (c_iterator_has_next (it)) {
+    char *item = (char *) c_iterator_next (it);
+    if (0 == strcmp ("10", item)) c_iterator_remove (it);
+    count += 1;
+  }
+  assert (13 == count);
+  assert (12 == c_hash_size (h));
+  s.value = "10";
+  assert (NULL == c_hash_find (h, &s));
+
+  /* churn: deleted slots are swept out without the table growing */
+  char churn [16];
+  for (count = 0; count < 1000; count ++) {
+    sprintf (churn, "churn%d", count);
+    s.value = churn;
+    assert (0 == c_hash_insert (h, &s));
+    c_hash_remove (h, &s);
+  }
+  assert (12 == c_hash_size (h));
+  assert (32 == c_hash_table_size (h));
+
+  c_hash_clear (h);
+  assert (0 == c_hash_size (h));
+  s.value = "1";
+  assert (NULL == c_hash_find (h, &s));
+  c_hash_free (h);
+
+  h = c_hash_create_base (sizeof (STRING), _calc, _compare, _garbage, 0, 100,
+    C_HASH_OPEN);
+  assert (256 == c_hash_table_size (h));
+  s.value = (char *) malloc (7);
+  strcpy (s.value, "foobar");
+  assert (0 == c_hash_insert (h, &s));
+  s.value = (char *) malloc (7);
+  strcpy (s.value, "foobar");
+  assert (0 == c_hash_replace (h, &s));
+  c_hash_free (h);
+
+  /* group probing */
+  static char keys [1000][8];
+  h = c_hash_create_base (sizeof (STRING), _calc, _compare, 0, 0, 0,
+    C_HASH_GROUP);
+  for (count = 0; count < 1000; count ++) {
+    sprintf (keys [count], "%d", count);
+    s.value = keys [count];
+    assert (0 == c_hash_insert (h, &s));
+  }
+  assert (C_HASH_ERROR_DUPLICATE == c_hash_insert (h, &s));
+  assert (1000 == c_hash_size (h));
+  for (count = 0; count < 1000; count += 2) {
+    s.value = keys [count];
+    c_hash_remove (h, &s);
+  }
+  assert (500 == c_hash_size (h));
+  for (count = 0; count < 1000; count ++) {
+    s.value = keys [count];
+    STRING *found = (STRING *) c_hash_find (h, &s);
+    if (count % 2) {
+      assert (found && found -> value == keys [count]);
+    } else {
+      assert (NULL == found);
+    }
+  }
+  s.value = "not there";
+  assert (NULL == c_hash_find (h, &s));
+
+  count = 0;
+  it = c_hash_iterator (h, _extractor);
+  while (c_iterator_has_next (it)) {
+    char *item = (char *) c_iterator_next (it);
+    if (0 == strcmp ("999", item)) c_iterator_remove (it);
+    count += 1;
+  }
+  assert (500 == count);
+  assert (499 == c_hash_size (h));
+  s.value = "999";
+  assert (NULL == c_hash_find (h, &s));
+  assert (0 == c_hash_insert (h, &s));
+
+  c_hash_clear (h);
+  assert (0 == c_hash_size (h));
+  s.value = "1";
+  assert (NULL == c_hash_find (h, &s));
+  for (count = 0; count < 1000; count ++) {
+    sprintf (churn, "churn%d", count);
+    s.value = churn;
+    assert (0 == c_hash_insert (h, &s));
+    c_hash_remove (h, &s);
+  }
+  assert (0 == c_hash_size (h));
+  c_hash_free (h);
+
+  /* robin hood: no deleted slots, so churn and 0.9 load never grow the table */
+  h = c_hash_create_base (sizeof (STRING), _calc, _compare, 0, 0, 0,
+    C_HASH_ROBIN_HOOD);
+  for (count = 0; count < 1000; count ++) {
+    s.value = keys [count];
+    assert (0 == c_hash_insert (h, &s));
+  }
+  assert (C_HASH_ERROR_DUPLICATE == c_hash_insert (h, &s));
+  assert (1000 == c_hash_size (h));
+  assert (2048 == c_hash_table_size (h));
+  for (count = 0; count < 1000; count += 2) {
+    s.value = keys [count];
+    c_hash_remove (h, &s);
+  }
+  assert (500 == c_hash_size (h));
+  for (count = 0; count < 1000; count ++) {
+    s.value = keys [count];
+    STRING *found = (STRING *) c_hash_find (h, &s);
+    if (count % 2) {
+      assert (found && found -> value == keys [count]);
+    } else {
+      assert (NULL == found);
+    }
+  }
+  s.value = "not there";
+  assert (NULL == c_hash_find (h, &s));
+  for (count = 0; count < 1000; count ++) {
+    sprintf (churn, "churn%d", count);
+    s.value = churn;
+    assert (0 == c_hash_insert (h, &s));
+    c_hash_remove (h, &s);
+  }
+  assert (500 == c_hash_size (h));
+  assert (2048 == c_hash_table_size (h));
+
+  count = 0;
+  it = c_hash_iterator (h, _extractor);
+  while (c_iterator_has_next (it)) {
+    char *item = (char *) c_iterator_next (it);
+    if ('1' == item [0]) c_iterator_remove (it); // shifts the next items back
+    count += 1;
+  }
+  assert (500 == count);
+  for (count = 1; count < 1000; count += 2) {
+    s.value = keys [count];
+    assert (('1' == keys [count][0] ? 0 : 1) == (c_hash_find (h, &s) ? 1 : 0));
+  }
+  assert (444 == c_hash_size (h)); // 56 odd keys start with 1
+  c_hash_clear (h);
+  assert (0 == c_hash_size (h));
+  c_hash_free (h);
+
+  h = c_hash_create_base (sizeof (STRING), _calc, _compare, 0, 0, 0,
+    C_HASH_ROBIN_HOOD);
+  for (count = 0; count < 115; count ++) {
+    s.value = keys [count];
+    assert (0 == c_hash_insert (h, &s));
+  }
+  assert (128 == c_hash_table_size (h)); // 115 / 128 is under 0.9
+  count = 0;
+  it = c_hash_iterator (h, _extractor);
+  while (c_iterator_has_next (it)) {
+    c_iterator_next (it);
+    c_iterator_remove (it);
+    count += 1;
+  }
+  assert (115 == count);
+  assert (0 == c_hash_size (h));
+  c_hash_free (h);
+
+  /* incremental rehash */
+  h = c_hash_create_base (sizeof (STRING), _calc, _compare, 0, 0, 0,
+    C_HASH_CHAINED | C_HASH_INCREMENTAL);
+  for (count = 0; count < 1000; count ++) {
+    s.value = keys [count];
+    assert (0 == c_hash_insert (h, &s));
+    s.value = keys [count / 2];
+    assert (c_hash_find (h, &s)); // found in either table mid-migration
+  }
+  assert (1000 == c_hash_size (h));
+  assert (2048 == c_hash_table_size (h));
+  for (count = 0; count < 1000; count += 2) {
+    s.value = keys [count];
+    c_hash_remove (h, &s);
+  }
+  assert (500 == c_hash_size (h));
+  for (count = 0; count < 1000; count ++) {
+    s.value = keys [count];
+    assert ((count % 2 ? 1 : 0) == (c_hash_find (h, &s) ? 1 : 0));
+  }
+  s.value = keys [999];
+  assert (0 == c_hash_replace (h, &s));
+
+  count = 0;
+  it = c_hash_iterator (h, _extractor);
+  while (c_iterator_has_next (it)) {
+    c_iterator_next (it);
+    count += 1;
+  }
+  assert (500 == count);
+  c_hash_clear (h);
+  assert (0 == c_hash_size (h));
+  c_hash_free (h);
+
+  /* reserve and shrink */
+  int type;
+  for (type = C_HASH_CHAINED; type <= C_HASH_ROBIN_HOOD; type ++) {
+    h = c_hash_create_base (sizeof (STRING), _calc, _compare, 0, 0, 0, type);
+    assert (0 == c_hash_reserve (h, 1000));
+    assert (2048 == c_hash_table_size (h));
+    for (count = 0; count < 1000; count ++) {
+      s.value = keys [count];
+      assert (0 == c_hash_insert (h, &s));
+    }
+    assert (2048 == c_hash_table_size (h)); // no rehash on the way
+    assert (0 == c_hash_reserve (h, 10)); // never shrinks
+    assert (2048 == c_hash_table_size (h));
+    assert (C_HASH_ERROR_MEMORY == c_hash_reserve (h, INT_MAX)); // too many
+    assert (2048 == c_hash_table_size (h));
+    assert (NULL == c_hash_create_base (sizeof (STRING), _calc, _compare, 0,
+      0, INT_MAX, type));
+    for (count = 10; count < 1000; count ++) {
+      s.value = keys [count];
+      c_hash_remove (h, &s);
+    }
+    assert (0 == c_hash_shrink_to_fit (h));
+    assert (10 == c_hash_size (h));
+    assert (c_hash_table_size (h) <= 32);
+    for (count = 0; count < 1000; count ++) {
+      s.value = keys [count];
+      assert ((count < 10 ? 1 : 0) == (c_hash_find (h, &s) ? 1 : 0));
+    }
+    c_hash_free (h);
+  }
+
+  /* sizing options */
+  C_HASH_OPTIONS options = { 0, 0, 0, C_HASH_SIZE_PRIME };
+  h = c_hash_create_options (sizeof (STRING), _calc, _compare, 0, 0, 0,
+    C_HASH_CHAINED | C_HASH_INCREMENTAL, &options);
+  assert (17 == c_hash_table_size (h));
+  for (count = 0; count < 1000; count ++) {
+    s.value = keys [count];
+    assert (0 == c_hash_insert (h, &s));
+  }
+  assert (1543 == c_hash_table_size (h)); // 17, 37, 97, 193, 389, 769
+  for (count = 0; count < 1000; count ++) {
+    s.value = keys [count];
+    assert (c_hash_find (h, &s));
+  }
+  assert (C_HASH_ERROR_MEMORY == c_hash_reserve (h, INT_MAX)); // no prime
+  assert (1543 == c_hash_table_size (h));
+  c_hash_free (h);
+
+  options.sizing = C_HASH_SIZE_POWER2;
+  options.max_load = 4;
+  options.growth = 4;
+  h = c_hash_create_options (sizeof (STRING), _calc, _compare, 0, 0, 0,
+    C_HASH_CHAINED, &options);
+  for (count = 0; count < 1000; count ++) {
+    s.value = keys [count];
+    assert (0 == c_hash_insert (h, &s));
+  }
+  assert (256 == c_hash_table_size (h)); // 16, 64, 256
+  c_hash_free (h);
+
+  options.max_load = .5;
+  options.min_load = .2;
+  options.growth = 0;
+  h = c_hash_create_options (sizeof (STRING), _calc, _compare, 0, 0, 0,
+    C_HASH_GROUP, &options);
+  for (count = 0; count < 1000; count ++) {
+    s.value = keys [count];
+    assert (0 == c_hash_insert (h, &s));
+  }
+  assert (2048 == c_hash_table_size (h));
+  for (count = 10; count < 1000; count ++) {
+    s.value = keys [count];
+    c_hash_remove (h, &s);
+  }
+  assert (c_hash_table_size (h) <= 32);
+  for (count = 0; count < 1000; count ++) {
+    s.value = keys [count];
+    assert ((count < 10 ? 1 : 0) == (c_hash_find (h, &s) ? 1 : 0));
+  }
+  c_hash_free (h);
+
+  /* a low max_load grows open tables rather than sweeping them in place */
+  options.max_load = .3;
+  options.min_load = 0;
+  for (type = C_HASH_OPEN; type <= C_HASH_ROBIN_HOOD; type ++) {
+    h = c_hash_create_options (sizeof (STRING), _calc, _compare, 0, 0, 0,
+      type, &options);
+    for (count = 0; count < 1000; count ++) {
+      s.value = keys [count];
+      assert (0 == c_hash_insert (h, &s));
+      assert (c_hash_size (h) <= c_hash_table_size (h) * .3 + 1);
+    }
+    assert (4096 == c_hash_table_size (h));
+    for (count = 0; count < 1000; count ++) {
+      s.value = keys [count];
+      assert (c_hash_find (h, &s));
+    }
+    c_hash_free (h);
+  }
+
+  options.max_load = 1; // open tables need an empty slot
+  options.min_load = .2;
+  assert (NULL == c_hash_create_options (sizeof (STRING), _calc, _compare,
+    0, 0, 0, C_HASH_OPEN, &options));
+  options.max_load = .5;
+  options.min_load = .25; // would shrink straight after growing
+  assert (NULL == c_hash_create_options (sizeof (STRING), _calc, _compare,
+    0, 0, 0, C_HASH_OPEN, &options));
+  options.min_load = 0;
+  options.growth = 1;
+  assert (NULL == c_hash_create_options (sizeof (STRING), _calc, _compare,
+    0, 0, 0, C_HASH_OPEN, &options));
+
+  /* 64-bit hashes: absent keys are filtered out by the stored hash */
+  assert (0x340d8765a4dda9c2ULL == hash_string_calculator64 ("foobar"));
+  for (type = C_HASH_CHAINED; type <= C_HASH_ROBIN_HOOD; type ++) {
+    h = c_hash_create64 (sizeof (STRING), _calc64, _compare_count, 0, 0, 0,
+      type, NULL);
+    for (count = 0; count < 1000; count += 2) {
+      s.value = keys [count];
+      assert (0 == c_hash_insert (h, &s));
+    }
+    compares = 0;
+    for (count = 0; count < 1000; count ++) {
+      s.value = keys [count];
+      assert ((count % 2 ? 0 : 1) == (c_hash_find (h, &s) ? 1 : 0));
+    }
+    assert (500 == compares);
+    for (count = 0; count < 1000; count += 4) {
+      s.value = keys [count];
+      c_hash_remove (h, &s);
+    }
+    assert (250 == c_hash_size (h));
+    c_hash_free (h);
+  }
+
+  /* batched find: every other key is present, in batches of uneven size */
+  STRING batch [37];
+  void *items [37], *results [37];
+  for (count = 0; count < 37; count ++) {
+    batch [count].value = keys [count];
+    items [count] = &batch [count];
+  }
+  for (type = C_HASH_CHAINED; type <= C_HASH_ROBIN_HOOD + 1; type ++) {
+    h = c_hash_create_base (sizeof (STRING), _calc, _compare, 0, 0, 0,
+      type > C_HASH_ROBIN_HOOD ? C_HASH_CHAINED | C_HASH_INCREMENTAL : type);
+    for (count = 0; count < 1000; count += 2) {
+      s.value = keys [count];
+      assert (0 == c_hash_insert (h, &s));
+    }
+    assert (19 == c_hash_find_many (h, items, 37, results));
+    for (count = 0; count < 37; count ++) {
+      if (count % 2) {
+        assert (NULL == results [count]);
+      } else {
+        assert (results [count] == c_hash_find (h, items [count]));
+        assert (keys [count] == ((STRING *) results [count]) -> value);
+      }
+    }
+    assert (0 == c_hash_find_many (h, items, 0, results));
+    c_hash_free (h);
+  }
+
+  /* concurrent finds, with a chained table caught mid-migration */
+  pthread_t reader [4];
+  shared_keys = keys;
+  for (type = C_HASH_CHAINED; type <= C_HASH_ROBIN_HOOD; type ++) {
+    shared = c_hash_create_base (sizeof (STRING), _calc, _compare, 0, 0, 0,
+      type | C_HASH_INCREMENTAL);
+    for (count = 0; count < SHARED_KEYS; count ++) {
+      s.value = keys [count];
+      assert (0 == c_hash_insert (shared, &s));
+    }
+    for (count = 0; count < 4; count ++)
+      assert (0 == pthread_create (&reader [count], NULL, _reader, NULL));
+    for (count = 0; count < 4; count ++) pthread_join (reader [count], NULL);
+    c_hash_free (shared);
+  }
+
+  /* snapshot and restore, through a C_BUFFER and through a file */
+  C_BUFFER *buffer = c_buffer_create ();
+  int round;
+  for (type = C_HASH_CHAINED; type <= C_HASH_ROBIN_HOOD; type ++) {
+    h = c_hash_create_base (sizeof (STRING), _calc, _compare, 0, 0, 0, type);
+    for (count = 0; count < 1000; count ++) {
+      s.value = keys [count];
+      assert (0 == c_hash_insert (h, &s));
+    }
+    assert (0 == c_hash_snapshot (h, buffer));
+    assert (0 == c_hash_snapshot (h, buffer));
+    FILE *file = tmpfile ();
+    assert (0 == c_hash_snapshot_fd (h, fileno (file)));
+    c_hash_free (h);
+
+    for (round = 0; round < 3; round ++) {
+      h = c_hash_create_base (sizeof (STRING), _calc, _compare, 0, 0, 0, type);
+      if (round < 2) {
+        assert (0 == c_hash_restore (h, buffer));
+      } else {
+        lseek (fileno (file), 0, SEEK_SET);
+        assert (0 == c_hash_restore_fd (h, fileno (file)));
+      }
+      assert (1000 == c_hash_size (h));
+      for (count = 0; count < 1000; count ++) {
+        s.value = keys [count];
+        assert (keys [count] == ((STRING *) c_hash_find (h, &s)) -> value);
+      }
+      assert (C_HASH_ERROR_DUPLICATE == c_hash_restore_fd (h, fileno (file)));
+      c_hash_free (h);
+    }
+    assert (0 == c_buffer_length (buffer));
+    fclose (file);
+  }
+
+  h = c_hash_create_base (sizeof (STRING), _calc, _compare, 0, 0, 0, 0);
+  s.value = keys [0];
+  assert (0 == c_hash_insert (h, &s));
+  assert (0 == c_hash_snapshot (h, buffer));
+  c_hash_free (h);
+  c_buffer_shift (buffer, 1); // not a snapshot any more
+  h = c_hash_create_base (sizeof (STRING), _calc, _compare, 0, 0, 0, 0);
+  assert (C_HASH_ERROR_FORMAT == c_hash_restore (h, buffer));
+  c_hash_free (h);
+  h = c_hash_create_base (sizeof (int), _calc, _compare, 0, 0, 0, 0);
+  c_buffer_clear (buffer);
+  assert (0 == c_hash_snapshot (h, buffer));
+  c_buffer_append (buffer, "x", 1);
+  c_hash_free (h);
+  h = c_hash_create_base (sizeof (STRING), _calc, _compare, 0, 0, 0, 0);
+  assert (C_HASH_ERROR_FORMAT == c_hash_restore (h, buffer)); // item size
+  c_hash_free (h);
+  c_buffer_free (buffer);
+
+  /* walks visit every item, mid-migration too, and leave the iterator be */
+  for (type = C_HASH_CHAINED; type <= C_HASH_ROBIN_HOOD + 1; type ++) {
+    int walked = 0;
+    h = c_hash_create_base (sizeof (STRING), _calc, _compare, 0, 0, 0,
+      type > C_HASH_ROBIN_HOOD ? C_HASH_CHAINED | C_HASH_INCREMENTAL : type);
+    for (count = 0; count < 1000; count ++) {
+      s.value = keys [count];
+      assert (0 == c_hash_insert (h, &s));
+    }
+    assert (0 == c_hash_walk (h, _visit_count, &walked));
+    assert (1000 == walked);
+    it = c_hash_iterator (h, _extractor); // finishes any migration
+    char *first = (char *) c_iterator_next (it);
+    walked = 0;
+    assert (0 == c_hash_walk (h, _visit_count, &walked));
+    assert (1000 == walked);
+    for (count = 1; c_iterator_has_next (it); count ++)
+      assert (first != c_iterator_next (it));
+    assert (1000 == count);
+    c_hash_free (h);
+  }
+
   return 0;
 }
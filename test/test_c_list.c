@@ -84,6 +84,65 @@ int main (void) {
   c_list_add (l, data [13]);
   assert (14 == c_list_size (l));
 
+  c_list_free (l);
+
+  /* lists sharing one C_SLAB */
+  C_SLAB *slab = c_list_slab_create ();
+  C_LIST *l1 = c_list_create_slab (slab);
+  C_LIST *l2 = c_list_create_slab (slab);
+  assert (0 == c_list_add (l1, data [1]));
+  assert (0 == c_list_add (l2, data [2]));
+  assert (0 == c_list_add_first (l1, data [0]));
+  assert (3 == c_slab_size (slab));
+  assert (0 == strcmp ("zero", c_list_take (l1)));
+  assert (2 == c_slab_size (slab));
+  i = c_list_iterator (l2);
+  assert (0 == strcmp ("two", c_iterator_next (i)));
+  c_iterator_remove (i);
+  assert (0 == c_list_size (l2));
+  assert (1 == c_slab_size (slab));
+  c_list_free (l1);
+  assert (0 == c_slab_size (slab));
+  c_list_free (l2);
+
+  /* lists that come from a C_SLAB too, dropped by clearing the slabs */
+  C_SLAB *lists = c_list_header_slab_create ();
+  l1 = c_list_create_slabs (slab, lists);
+  l2 = c_list_create_slabs (slab, lists);
+  assert (0 == c_list_add (l1, data [0]));
+  assert (0 == c_list_add (l2, data [1]));
+  assert (2 == c_slab_size (lists));
+  c_list_free (l1);
+  assert (1 == c_slab_size (lists));
+  assert (1 == c_slab_size (slab));
+  c_slab_clear (slab);
+  c_slab_clear (lists);
+  assert (0 == c_slab_size (lists));
+  c_slab_free (lists);
+  c_slab_free (slab);
+
+  /* positions */
+  C_LIST_POSITION *p;
+  l = c_list_create ();
+  assert (NULL == c_list_first (l));
+  c_list_add (l, data [0]);
+  c_list_add (l, data [1]);
+  c_list_add (l, data [2]);
+  p = c_list_next (c_list_first (l));
+  assert (0 == strcmp ("one", c_list_value (p)));
+  c_list_remove (l, p);
+  assert (2 == c_list_size (l));
+  p = c_list_first (l);
+  assert (0 == strcmp ("zero", c_list_value (p)));
+  p = c_list_next (p);
+  assert (0 == strcmp ("two", c_list_value (p)));
+  assert (NULL == c_list_next (p));
+  c_list_remove (l, p);
+  c_list_remove (l, c_list_first (l));
+  assert (0 == c_list_size (l));
+  assert (NULL == c_list_first (l));
+  assert (0 == c_list_add (l, data [3]));
+  assert (0 == strcmp ("three", c_list_take_last (l)));
   c_list_free (l);
   return 0;
 }
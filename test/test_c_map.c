@@ -1,8 +1,53 @@
 #include <assert.h>
+#include <stdlib.h>
 #include <string.h>
+#include "c_hash.h"
 #include "c_map.h"
+#include "c_symbol.h"
 #include "hash_func.h"
 
+/* keys and values are strings, written with their terminators */
+static int
+_write_pair (C_BUFFER *b, void *key, void *value) {
+  return c_buffer_append (b, (char *) key, strlen ((char *) key) + 1) ||
+    c_buffer_append (b, (char *) value, strlen ((char *) value) + 1);
+}
+
+static char *
+_read_string (char *data, int length, int *used) {
+  char *end = memchr (data, 0x00, length);
+  char *copy;
+  if (!end) return NULL;
+  *used = end - data + 1;
+  copy = malloc (*used);
+  if (copy) memcpy (copy, data, *used);
+  return copy;
+}
+
+static int
+_read_pair (char *data, int length, void **key, void **value) {
+  int used_key, used_value;
+  if (!(*key = _read_string (data, length, &used_key))) return -1;
+  *value = _read_string (data + used_key, length - used_key, &used_value);
+  if (!*value) {
+    free (*key);
+    return -1;
+  }
+  return used_key + used_value;
+}
+
+static int
+_count_pair (void *key, void *value, void *context) {
+  (* (int *) context) ++;
+  return 0 == strcmp ((char *) key, "three"); // stops the walk
+}
+
+static void
+_free_pair (void *key, void *value) {
+  free (key);
+  free (value);
+}
+
 int main (void) {
   C_ITERATOR *i;
   int count;
@@ -50,5 +95,180 @@ int main (void) {
   assert (0 == c_map_size (m));
 
   c_map_free (m);
+
+  m = c_map_dict_create_size (0, 100);
+  assert (256 == c_map_table_size (m));
+  assert (0 == c_map_reserve (m, 1000));
+  assert (2048 == c_map_table_size (m));
+  assert (0 == c_map_add (m, name [0], value [0]));
+  assert (0 == c_map_shrink_to_fit (m));
+  assert (16 == c_map_table_size (m));
+  assert (0 == strcmp (c_map_find (m, "one"), "eleven"));
+
+  /* batched find */
+  void *keys [] = {"one", "five", "two", "one"};
+  void *values [4];
+  assert (0 == c_map_add (m, name [1], value [1]));
+  assert (3 == c_map_find_many (m, keys, 4, values));
+  assert (0 == strcmp (values [0], "eleven"));
+  assert (NULL == values [1]);
+  assert (0 == strcmp (values [2], "twelve"));
+  assert (values [0] == values [3]);
+  c_map_free (m);
+
+  /* counted keys, looked up straight out of a buffer */
+  char *buffer = "GET /index.html HTTP/1.1";
+  HASH_STRING method = {"GET", 3, 0}, path = {"/index.html", 11, 0};
+  HASH_STRING probe = {buffer, 3, 0};
+  m = c_map_length_dict_create (0, 0);
+  assert (0 == c_map_add (m, &method, "method"));
+  assert (0 == c_map_add (m, &path, "path"));
+  assert (0 == strcmp (c_map_find (m, &probe), "method"));
+  probe.string = buffer + 4;
+  probe.length = 11;
+  probe.hash = 0;
+  assert (0 == strcmp (c_map_find (m, &probe), "path"));
+  probe.length = 10;
+  probe.hash = 0;
+  assert (NULL == c_map_find (m, &probe));
+  c_map_free (m);
+
+  m = c_map_nocase_dict_create (0);
+  assert (0 == c_map_add (m, "Content-Type", "text/plain"));
+  assert (0 == c_map_add (m, "Content-Length", "42"));
+  assert (0 == strcmp (c_map_find (m, "content-type"), "text/plain"));
+  assert (0 == strcmp (c_map_find (m, "CONTENT-LENGTH"), "42"));
+  assert (NULL == c_map_find (m, "content-typ"));
+  c_map_free (m);
+
+  m = c_map_dict_create_keyed (0, 0);
+  for (count = 0; count < 4; count ++)
+    assert (0 == c_map_add (m, name [count], value [count]));
+  assert (0 == strcmp (c_map_find (m, "four"), "fourteen"));
+  c_map_remove (m, "four");
+  assert (NULL == c_map_find (m, "four"));
+  assert (3 == c_map_size (m));
+  c_map_free (m);
+
+  m = c_map_dict_create64 (0, 0);
+  for (count = 0; count < 4; count ++)
+    assert (0 == c_map_add (m, name [count], value [count]));
+  assert (4 == c_map_size (m));
+  assert (0 == strcmp (c_map_find (m, "three"), "thirteen"));
+  c_map_remove (m, "three");
+  assert (NULL == c_map_find (m, "three"));
+  assert (3 == c_map_find_many (m, (void **) name, 4, values));
+  assert (NULL == values [2]);
+  c_map_free (m);
+
+  C_SYMBOL *s = c_symbol_create ();
+  m = c_map_symbol_create (0, 0);
+  for (count = 0; count < 4; count ++)
+    assert (0 == c_map_add (m, c_symbol_add (s, name [count]),
+      value [count]));
+  assert (0 == strcmp (c_map_find (m, c_symbol_find (s, "two")), "twelve"));
+  assert (NULL == c_map_find (m, c_symbol_add (s, "five")));
+  c_map_remove (m, c_symbol_find (s, "two"));
+  assert (3 == c_map_size (m));
+  c_map_free (m);
+  c_symbol_free (s);
+
+  m = c_map_dict_create (0);
+  for (count = 0; count < 4; count ++)
+    assert (0 == c_map_add (m, name [count], value [count]));
+  C_FROZEN_MAP *f = c_map_freeze (m);
+  assert (f);
+  assert (4 == c_frozen_map_size (f));
+  for (count = 0; count < 4; count ++) {
+    assert (value [count] == c_frozen_map_find (f, name [count]));
+    assert (name [count] == c_frozen_map_find_key (f, name [count]));
+  }
+  assert (NULL == c_frozen_map_find (f, "five"));
+  for (count = 0; count < 4; count ++) {
+    C_MAPITEM *item = c_frozen_map_item (f, count);
+    assert (item -> value == c_frozen_map_find (f, item -> key));
+  }
+  assert (NULL == c_frozen_map_item (f, 4));
+  c_frozen_map_free (f);
+
+  /* freezing reads the pairs, not what the map's iterator extracts */
+  m = c_map_dict_create (0);
+  for (count = 0; count < 4; count ++)
+    assert (0 == c_map_add (m, name [count], value [count]));
+  i = c_map_key_iterator (m);
+  count = 0;
+  assert (1 == c_map_walk (m, _count_pair, &count));
+  assert (count >= 1 && count <= 4);
+  f = c_map_freeze (m);
+  assert (f);
+  for (count = 0; count < 4; count ++)
+    assert (value [count] == c_frozen_map_find (f, name [count]));
+  c_frozen_map_free (f);
+
+  m = c_map_create (hash_uint_calculator, hash_uint_comparator, 0);
+  unsigned int numbers [5000];
+  for (count = 0; count < 5000; count ++) {
+    numbers [count] = count * 3;
+    assert (0 == c_map_add (m, &numbers [count], &numbers [count]));
+  }
+  f = c_map_freeze (m);
+  for (count = 0; count < 5000; count ++)
+    assert (&numbers [count] == c_frozen_map_find (f, &numbers [count]));
+  unsigned int missing = 1;
+  assert (NULL == c_frozen_map_find (f, &missing));
+  c_frozen_map_free (f);
+  m = c_map_dict_create (0);
+  for (count = 0; count < 4; count ++)
+    assert (0 == c_map_add (m, name [count], value [count]));
+  C_BUFFER *b = c_buffer_create ();
+  assert (0 == c_map_snapshot (m, b, _write_pair));
+  c_map_free (m);
+  m = c_map_create (hash_string_calculator, hash_string_comparator,
+    _free_pair);
+  assert (0 == c_map_restore (m, b, _read_pair));
+  assert (0 == c_buffer_length (b));
+  assert (4 == c_map_size (m));
+  for (count = 0; count < 4; count ++)
+    assert (0 == strcmp (c_map_find (m, name [count]), value [count]));
+  assert (0 == c_map_snapshot (m, b, _write_pair));
+  assert (C_HASH_ERROR_DUPLICATE == c_map_restore (m, b, _read_pair));
+  c_map_free (m);
+  m = c_map_create (hash_string_calculator, hash_string_comparator,
+    _free_pair);
+  C_BUFFER *cut = c_buffer_create (); // without the last terminator
+  c_buffer_append (cut, c_buffer_get (b), c_buffer_length (b) - 1);
+  assert (C_HASH_ERROR_FORMAT == c_map_restore (m, cut, _read_pair));
+  c_map_free (m);
+  c_buffer_free (cut);
+
+  /* a snapshot leaves the map's iterator, and its extractor, alone */
+  m = c_map_dict_create (0);
+  for (count = 0; count < 4; count ++)
+    assert (0 == c_map_add (m, name [count], value [count]));
+  i = c_map_key_iterator (m);
+  char *key = (char *) c_iterator_next (i);
+  assert (0 == c_map_snapshot (m, b, _write_pair));
+  for (count = 1; c_iterator_has_next (i); count ++) {
+    key = (char *) c_iterator_next (i);
+    assert (c_map_find (m, key)); // still keys, not C_MAPITEMs
+  }
+  assert (4 == count);
+  c_map_free (m);
+  m = c_map_create (hash_string_calculator, hash_string_comparator,
+    _free_pair);
+  assert (0 == c_map_restore (m, b, _read_pair));
+  assert (4 == c_map_size (m));
+  c_map_free (m);
+
+  m = c_map_dict_create (0);
+  for (count = 0; count < 4; count ++)
+    assert (0 == c_map_add (m, name [count], value [count]));
+  assert (0 == c_map_snapshot (m, b, _write_pair));
+  i = c_map_key_iterator (m);
+  for (count = 0; c_iterator_has_next (i); count ++)
+    assert (c_map_find (m, c_iterator_next (i)));
+  assert (4 == count);
+  c_map_free (m);
+  c_buffer_free (b);
   return 0;
 }
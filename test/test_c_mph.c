@@ -0,0 +1,59 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c_mph.h"
+
+#define COUNT 100000
+
+static unsigned long long hashes [COUNT];
+static int order [COUNT];
+static char seen [COUNT];
+
+int main (void) {
+  C_MPH *mph;
+  int i, n, position;
+
+  /* distinct values: each finds the one position it was stored at */
+  for (i = 0; i < COUNT; i ++) hashes [i] = (unsigned long long) i * 7919;
+  mph = c_mph_create (hashes, COUNT, order);
+  assert (mph);
+  assert (COUNT == c_mph_size (mph));
+  for (i = 0; i < COUNT; i ++) {
+    assert (0 == seen [order [i]]);
+    seen [order [i]] = 1;
+  }
+  for (i = 0; i < COUNT; i ++) {
+    position = c_mph_find (mph, hashes [order [i]], &n);
+    assert (i == position);
+    assert (1 == n);
+  }
+  position = c_mph_find (mph, 12345, &n); // not in the set
+  assert (position >= 0 && position < COUNT);
+  c_mph_free (mph);
+
+  /* shared values: entries with the same value are stored together */
+  for (i = 0; i < 1000; i ++) hashes [i] = i % 300;
+  mph = c_mph_create (hashes, 1000, order);
+  assert (mph);
+  for (i = 0; i < 1000; i ++) {
+    int j;
+    position = c_mph_find (mph, hashes [i], &n);
+    assert (n == (i % 300 < 100 ? 4 : 3));
+    for (j = position; j < position + n; j ++)
+      assert (hashes [order [j]] == hashes [i]);
+  }
+  c_mph_free (mph);
+
+  mph = c_mph_create (hashes, 0, order);
+  assert (mph);
+  assert (0 == c_mph_size (mph));
+  c_mph_find (mph, 1, &n);
+  assert (0 == n);
+  c_mph_free (mph);
+
+  hashes [0] = 42;
+  mph = c_mph_create (hashes, 1, order);
+  assert (0 == c_mph_find (mph, 42, &n) && 1 == n && 0 == order [0]);
+  c_mph_free (mph);
+  return 0;
+}
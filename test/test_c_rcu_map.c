@@ -0,0 +1,166 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c_allocator.h"
+#include "c_rcu_map.h"
+
+#define READERS 4
+#define KEYS 200
+#define ROUNDS 20000
+
+static C_RCU_MAP *m;
+static char keys [KEYS][8];
+static _Atomic int done;
+static int collected;
+
+/* values are malloced ints holding the index of their key */
+static void
+_garbage (void *key, void *value) {
+  if (value) {
+    free (value);
+    collected += 1;
+  }
+}
+
+/* hands out blocks 16 bytes past a cache line, so no block is ever line
+   aligned, and checks every pointer freed is one it handed out */
+static void *
+_alloc (size_t size, void *context) {
+  char *p = (char *) aligned_alloc (64, (size + 16 + 63) & ~(size_t) 63);
+  return p ? p + 16 : NULL;
+}
+
+static void *
+_realloc (void *ptr, size_t size, void *context) {
+  assert (0);
+  return NULL;
+}
+
+static void
+_free (void *ptr, void *context) {
+  if (ptr) {
+    assert (16 == (uintptr_t) ptr % 64);
+    free ((char *) ptr - 16);
+  }
+}
+
+static C_ALLOCATOR offset = {_alloc, _realloc, _free, NULL};
+
+static void *
+_value (int i) {
+  int *v = (int *) malloc (sizeof (int));
+  *v = i;
+  return v;
+}
+
+static int
+_count (void *key, void *value, void *context) {
+  *(int *) context += 1;
+  return 0;
+}
+
+/*
+ * readers check that every value they find is intact while the writer
+ * replaces and removes values underneath them (ASan catches a value freed
+ * too early)
+ */
+static void *
+_reader (void *arg) {
+  C_RCU_READER *reader = c_rcu_map_reader_create (m);
+  int i = 0;
+
+  assert (reader);
+  while (!done) {
+    c_rcu_map_read_lock (reader);
+    int *v = (int *) c_rcu_map_find (m, keys [i]);
+    if (v) assert (i == *v);
+    assert (c_rcu_map_exists (m, keys [0]));
+    c_rcu_map_read_unlock (reader);
+    i = (i + 1) % KEYS;
+  }
+  c_rcu_map_reader_free (reader);
+
+  return NULL;
+}
+
+int main (void) {
+  pthread_t thread [READERS];
+  C_RCU_READER *reader;
+  int i, count;
+
+  for (i = 0; i < KEYS; i ++) sprintf (keys [i], "%d", i);
+
+  m = c_rcu_map_dict_create (_garbage);
+  assert (m);
+  reader = c_rcu_map_reader_create (m);
+  assert (0 == (size_t) reader % 64); // a cache line of its own
+  C_RCU_READER *other = c_rcu_map_reader_create (m);
+  assert (0 == (size_t) other % 64 && other != reader);
+  c_rcu_map_reader_free (other);
+  assert (0 == c_rcu_map_size (m));
+  assert (0 == c_rcu_map_insert (m, keys [0], _value (0)));
+  assert (C_RCU_MAP_ERROR_DUPLICATE == c_rcu_map_insert (m, keys [0], NULL));
+  assert (1 == c_rcu_map_size (m));
+
+  /* a value replaced inside a read section survives until it ends */
+  c_rcu_map_read_lock (reader);
+  int *v = (int *) c_rcu_map_find (m, "0");
+  assert (0 == c_rcu_map_add (m, keys [0], _value (0)));
+  assert (0 == collected);
+  assert (0 == *v);
+  assert (v != c_rcu_map_find (m, "0"));
+  assert (1 == c_rcu_map_reclaim (m));
+  c_rcu_map_read_unlock (reader);
+  assert (0 == c_rcu_map_reclaim (m));
+  assert (1 == collected);
+
+  /* growth, removal, foreach */
+  for (i = 1; i < KEYS; i ++) assert (0 == c_rcu_map_add (m, keys [i], _value (i)));
+  assert (KEYS == c_rcu_map_size (m));
+  c_rcu_map_read_lock (reader);
+  for (i = 0; i < KEYS; i ++) assert (i == *(int *) c_rcu_map_find (m, keys [i]));
+  count = 0;
+  assert (0 == c_rcu_map_foreach (m, _count, &count));
+  assert (KEYS == count);
+  c_rcu_map_read_unlock (reader);
+  c_rcu_map_remove (m, "1");
+  assert (KEYS - 1 == c_rcu_map_size (m));
+  c_rcu_map_read_lock (reader);
+  assert (!c_rcu_map_exists (m, "1"));
+  c_rcu_map_read_unlock (reader);
+  c_rcu_map_reader_free (reader);
+
+  /* one writer, several lock-free readers */
+  for (i = 0; i < READERS; i ++)
+    assert (0 == pthread_create (&thread [i], NULL, _reader, NULL));
+  for (i = 0; i < ROUNDS; i ++) {
+    int k = 1 + i % (KEYS - 1);
+    if (i % 3) {
+      assert (0 == c_rcu_map_add (m, keys [k], _value (k)));
+    } else {
+      c_rcu_map_remove (m, keys [k]);
+    }
+  }
+  c_rcu_map_clear (m);
+  assert (0 == c_rcu_map_add (m, keys [0], _value (0)));
+  done = 1;
+  for (i = 0; i < READERS; i ++) pthread_join (thread [i], NULL);
+
+  assert (0 == c_rcu_map_reclaim (m));
+  assert (1 == c_rcu_map_size (m));
+  c_rcu_map_free (m);
+
+  /* readers still on the map are freed with it, through the block each
+     was carved from */
+  c_allocator_set (&offset);
+  m = c_rcu_map_dict_create (_garbage);
+  c_allocator_set (NULL);
+  for (i = 0; i < 3; i ++) assert (c_rcu_map_reader_create (m));
+  assert (0 == c_rcu_map_add (m, keys [0], _value (0)));
+  c_rcu_map_free (m);
+
+  return 0;
+}
@@ -0,0 +1,99 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "c_slab.h"
+
+typedef struct ITEM {
+  int key;
+  char name [13];
+} ITEM;
+
+/* counts the blocks (the C_SLAB and its chunks) it has handed out */
+static int blocks;
+
+static void *
+_alloc (size_t size, void *context) {
+  blocks += 1;
+  return malloc (size);
+}
+
+static void *
+_realloc (void *ptr, size_t size, void *context) {
+  return realloc (ptr, size);
+}
+
+static void
+_free (void *ptr, void *context) {
+  blocks -= 1;
+  free (ptr);
+}
+
+static C_ALLOCATOR counting = {_alloc, _realloc, _free, NULL};
+
+int main (void) {
+  ITEM *item [100];
+  int i;
+
+  C_SLAB *s = c_slab_create (sizeof (ITEM));
+  assert (s);
+  assert (0 == c_slab_size (s));
+
+  for (i = 0; i < 100; i ++) {
+    item [i] = (ITEM *) c_slab_alloc (s);
+    assert (item [i]);
+    assert (0 == ((size_t) item [i] % sizeof (void *)));
+    item [i] -> key = i;
+    strcpy (item [i] -> name, "abcdefghijkl");
+  }
+  assert (100 == c_slab_size (s));
+  for (i = 0; i < 100; i ++) {
+    assert (i == item [i] -> key);
+    assert (0 == strcmp ("abcdefghijkl", item [i] -> name));
+  }
+
+  /* released objects are handed out again */
+  c_slab_release (s, item [10]);
+  c_slab_release (s, item [20]);
+  assert (98 == c_slab_size (s));
+  assert (item [20] == c_slab_alloc (s));
+  assert (item [10] == c_slab_alloc (s));
+  assert (100 == c_slab_size (s));
+  assert (99 == item [99] -> key);
+
+  c_slab_clear (s);
+  assert (0 == c_slab_size (s));
+  assert (c_slab_alloc (s));
+  assert (1 == c_slab_size (s));
+
+  c_slab_free (s);
+
+  /* trim gives back the chunks with nothing left in use */
+  C_ALLOCATOR *previous = c_allocator_set (&counting);
+  s = c_slab_create (sizeof (ITEM));
+  c_allocator_set (previous);
+  for (i = 0; i < 100; i ++) item [i] = (ITEM *) c_slab_alloc (s);
+  assert (5 == blocks); // chunks of 8, 16, 32 and 64 objects
+  for (i = 8; i < 100; i ++) c_slab_release (s, item [i]);
+  assert (0 == c_slab_trim (s));
+  assert (2 == blocks); // the first chunk holds items 0 to 7
+  for (i = 8; i < 100; i ++) {
+    item [i] = (ITEM *) c_slab_alloc (s);
+    item [i] -> key = i;
+  }
+  assert (100 == c_slab_size (s));
+  for (i = 0; i < 100; i ++) c_slab_release (s, item [i]);
+  assert (0 == c_slab_trim (s));
+  assert (1 == blocks);
+  assert (0 == c_slab_trim (s));
+  assert (c_slab_alloc (s));
+  c_slab_free (s);
+  assert (0 == blocks);
+
+  s = c_slab_create (1); // rounded up to hold a free list link
+  void *a = c_slab_alloc (s);
+  void *b = c_slab_alloc (s);
+  assert ((char *) b - (char *) a >= sizeof (void *));
+  c_slab_free (s);
+
+  return 0;
+}
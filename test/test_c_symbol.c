@@ -1,8 +1,11 @@
 #include <assert.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "c_iterator.h"
+#include "c_dict.h"
 #include "c_symbol.h"
+#include "hash_func.h"
 
 int main (int argc, char **argv) {
   C_SYMBOL *s = c_symbol_create ();
@@ -40,5 +43,96 @@ int main (int argc, char **argv) {
   assert (0 == c_symbol_size (s));
 
   c_symbol_free (s);
+
+  s = c_symbol_create_size (1000);
+  assert (s);
+  assert (0 == c_symbol_reserve (s, 2000));
+  symbol = c_symbol_add (s, "akk");
+  assert (0 == c_symbol_shrink_to_fit (s));
+  assert (symbol == c_symbol_find (s, "akk"));
+  c_symbol_free (s);
+
+  s = c_symbol_create_keyed (0);
+  assert (c_symbol_add_n (s, "akkbkk", 3) == c_symbol_find (s, "akk"));
+  assert (NULL == c_symbol_find_n (s, "akkbkk", 6));
+  symbol = c_symbol_add (s, "akk");
+  assert (symbol == c_symbol_add (s, "akk"));
+  assert (symbol == c_symbol_find (s, "akk"));
+  assert (NULL == c_symbol_find (s, "bkk"));
+  assert (3 == c_symbol_length (symbol));
+  c_symbol_free (s);
+
+  s = c_symbol_create ();
+  symbol = c_symbol_add_n (s, "akkbkk", 6);
+  assert (6 == c_symbol_length (symbol));
+  assert (hash_func_calculate ("akkbkk", 6) == c_symbol_hash (symbol));
+  c_symbol_free (s);
+
+  s = c_symbol_create_flags (0, C_SYMBOL_ARENA | C_SYMBOL_KEYED);
+  char name [16], *symbols [10000], big [10000];
+  int i;
+  for (i = 0; i < 10000; i ++) {
+    sprintf (name, "s%d", i);
+    symbols [i] = c_symbol_add (s, name);
+    assert (symbols [i]);
+  }
+  memset (big, 'b', sizeof (big) - 1);
+  big [sizeof (big) - 1] = 0x00;
+  symbol = c_symbol_add (s, big);
+  assert (sizeof (big) - 1 == c_symbol_length (symbol));
+  assert (symbols [9999] == c_symbol_find (s, "s9999"));
+  assert (symbols [9999] == c_symbol_add (s, "s9999"));
+  assert (symbol == c_symbol_find (s, big));
+  for (i = 0; i < 10000; i ++) {
+    sprintf (name, "s%d", i);
+    assert (symbols [i] == c_symbol_find (s, name));
+    assert (0 == strcmp (symbols [i], name));
+  }
+  assert (10001 == c_symbol_id_count (s));
+  assert (10000 == c_symbol_id (symbol));
+  assert (1234 == c_symbol_intern_id (s, "s1234", 5));
+  assert (symbols [1234] == c_symbol_by_id (s, 1234));
+  assert (NULL == c_symbol_value (symbols [1234]));
+  c_symbol_set_value (symbols [1234], symbols [5]);
+  assert (symbols [5] == c_symbol_value (c_symbol_find (s, "s1234")));
+  assert (0 == strcmp ("s1234", symbols [1234]));
+  c_symbol_remove (s, "s0");
+  assert (NULL == c_symbol_find (s, "s0"));
+  assert (NULL == c_symbol_by_id (s, 0));
+  assert (NULL == c_symbol_by_id (s, 10001));
+  assert (0 == strcmp (symbols [0], "s0"));
+  assert (10000 == c_symbol_size (s));
+  c_symbol_clear (s);
+  assert (0 == c_symbol_size (s));
+  assert (0 == c_symbol_id_count (s));
+  assert (0 == c_symbol_intern_id (s, "s0", 2));
+  c_symbol_free (s);
+
+  s = c_symbol_create ();
+  assert (0 == c_symbol_intern_id (s, "zero", 4));
+  assert (1 == c_symbol_intern_id (s, "one", 3));
+  assert (0 == c_symbol_intern_id (s, "zero", 4));
+  c_symbol_remove (s, "zero");
+  assert (NULL == c_symbol_by_id (s, 0));
+  assert (2 == c_symbol_intern_id (s, "zero", 4));
+  assert (0 == strcmp (c_symbol_by_id (s, 2), "zero"));
+  it = c_symbol_iterator (s); // saving leaves it where it is
+  const char *first = (const char *) c_iterator_next (it);
+  assert (0 == c_symbol_save (s, "test_c_symbol.dat"));
+  assert (c_iterator_has_next (it));
+  assert (first != c_iterator_next (it));
+  assert (!c_iterator_has_next (it));
+  c_symbol_free (s);
+
+  C_FROZEN_DICT *f = c_frozen_dict_load ("test_c_symbol.dat");
+  assert (f);
+  assert (2 == c_frozen_dict_size (f));
+  symbol = c_frozen_dict_find (f, "zero"); // the ids are the values
+  assert (0 == strcmp (symbol, "2"));
+  assert (symbol == c_frozen_dict_find_n (f, "zeroes", 4));
+  assert (0 == strcmp ("1", c_frozen_dict_find (f, "one")));
+  assert (NULL == c_frozen_dict_find (f, "two"));
+  c_frozen_dict_free (f);
+  remove ("test_c_symbol.dat");
   return 0;
 }
@@ -5,16 +5,90 @@
 
 int main (void) {
 
-  u_long hash;
+  unsigned int hash;
   char *string;
+  char long_key [101];
 
   string = "5690748";
-  hash = hash_calculate (string, strlen (string));
+  hash = hash_func_calculate (string, strlen (string));
   assert (hash == 2810351874u);
   
   string = "4513559";
-  hash = hash_calculate (string, strlen (string));
+  hash = hash_func_calculate (string, strlen (string));
   assert (hash == 921738403u);
-  
+
+  assert (0x340d8765a4dda9c2ULL == hash_func_calculate64 ("foobar", 6));
+
+  /* wyhash, at every length class: empty, 1-3, 4-16, 17-48, over 48 */
+  memset (long_key, 'x', 100);
+  long_key [100] = 0x00;
+  assert (0x93228a4de0eec5a2ULL == hash_func_wyhash ("", 0, 0));
+  assert (0x989b4a209c1011c9ULL == hash_func_wyhash ("abc", 3, 0));
+  assert (0x3ab768b7140588a1ULL == hash_func_wyhash ("foobar", 6, 0));
+  assert (0x6d35345a7d959e03ULL ==
+    hash_func_wyhash ("0123456789abcdef0", 17, 0));
+  assert (0x39d3b1617320fdbfULL == hash_func_wyhash (long_key, 100, 0));
+  assert (hash_func_wyhash ("abc", 3, 0) != hash_func_wyhash ("abc", 3, 1));
+
+  /* SipHash-2-4 reference vectors: key 00..0f, message 00..n-1 */
+  unsigned char key [HASH_FUNC_KEY_SIZE], other [HASH_FUNC_KEY_SIZE];
+  unsigned char message [64];
+  int n;
+  for (n = 0; n < 64; n ++) message [n] = n;
+  memcpy (key, message, HASH_FUNC_KEY_SIZE);
+  assert (0x726fdb47dd0e0e31ULL == hash_func_siphash (message, 0, key));
+  assert (0x74f839c593dc67fdULL == hash_func_siphash (message, 1, key));
+  assert (0x93f5f5799a932462ULL == hash_func_siphash (message, 8, key));
+  assert (0xa129ca6149be45e5ULL == hash_func_siphash (message, 15, key));
+  assert (0x958a324ceb064572ULL == hash_func_siphash (message, 63, key));
+  assert (hash_func_siphash ("foobar", 6, key) ==
+    hash_string_keyed_calculator ("foobar", key));
+
+  hash_func_random_key (key);
+  hash_func_random_key (other);
+  assert (0 != memcmp (key, other, HASH_FUNC_KEY_SIZE));
+  assert (hash_string_keyed_calculator ("foobar", key) !=
+    hash_string_keyed_calculator ("foobar", other));
+
+  /* counted strings hash like the same bytes null-terminated */
+  HASH_STRING hs1 = {"foobarbaz", 6, 0}, hs2 = {"foobar", 6, 0};
+  HASH_STRING hs3 = {"fooba", 5, 0};
+  assert (hash_string_calculator ("foobar") ==
+    hash_length_string_calculator (&hs1));
+  assert (hs1.hash == hash_string_calculator ("foobar")); // cached
+  assert (0 == hash_length_string_comparator (&hs1, &hs2));
+  assert (0 < hash_length_string_comparator (&hs1, &hs3));
+
+  /* case-insensitive: equal strings hash alike, and the hash covers them all */
+  char upper [80], lower [80];
+  for (n = 0; n < 79; n ++) {
+    upper [n] = 'A' + n % 26;
+    lower [n] = 'a' + n % 26;
+  }
+  upper [79] = lower [79] = 0x00;
+  assert (0 == hash_nocase_string_comparator (upper, lower));
+  assert (hash_nocase_string_calculator (upper) ==
+    hash_nocase_string_calculator (lower));
+  assert (hash_nocase_string_calculator (lower) ==
+    hash_func_calculate (lower, 79));
+  assert (hash_nocase_string_calculator ("Content-Type") !=
+    hash_nocase_string_calculator ("X-Type"));
+  lower [70] = 'z';
+  assert (-1 == hash_nocase_string_comparator (lower, upper));
+  assert (1 == hash_nocase_string_comparator (upper, lower));
+  lower [70] = 0x00;
+  assert (1 == hash_nocase_string_comparator (lower, upper));
+  assert (-1 == hash_nocase_string_comparator (upper, lower));
+  assert (0 != hash_nocase_string_comparator ("@", "`")); // not letters
+  assert (0 != hash_nocase_string_comparator ("[", "{"));
+  assert (0 == hash_nocase_string_comparator ("", ""));
+
+  assert (HASH_FUNC_FNV == hash_func_select (HASH_FUNC_WYHASH));
+  assert (0x3ab768b7140588a1ULL == hash_string_calculator64 ("foobar"));
+  assert ((unsigned int) (0x3ab768b7140588a1ULL ^ 0x3ab768b7ULL) ==
+    hash_string_calculator ("foobar"));
+  assert (HASH_FUNC_WYHASH == hash_func_select (HASH_FUNC_FNV));
+  assert (0x340d8765a4dda9c2ULL == hash_string_calculator64 ("foobar"));
+
   return 0;
 }